@@ -0,0 +1,212 @@
+#!/usr/bin/env php
+<?php
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * 基准测试：每个操作在 32、64 位位图和 sparse、dense、clustered、runs 四种数据分布下各跑一遍，结果以 json 输出
+ *
+ * php benchmarks/run.php [--size=100000] [--repeat=5] [--bit=32|64] [--distribution=name] [--filter=op] [--output=file]
+ *
+ * 每个用例先预热一次，再重复 repeat 次，取耗时的中位数和最小值，per_op_ns 是中位数除以用例内的操作次数
+ */
+
+declare(strict_types=1);
+
+require __DIR__ . '/../vendor/autoload.php';
+
+use Roaring\Bitmap;
+use Roaring\Library;
+
+$options = getopt('', ['size:', 'repeat:', 'bit:', 'distribution:', 'filter:', 'output:']);
+$size = (int)($options['size'] ?? 100000);
+$repeat = max(1, (int)($options['repeat'] ?? 5));
+$bits = isset($options['bit']) ? [(int)$options['bit']] : [Library::BIT_32, Library::BIT_64];
+
+/**
+ * 生成 size 个有序不重复的值，64 位时整体加上 2^40，让值落在高 32 位不为 0 的桶里
+ * @return array<string, callable(int $size): int[]>
+ */
+function distributions(): array
+{
+    return [
+        // 均匀撒在整个 32 位空间，几乎每个容器都是很小的数组容器
+        'sparse' => function (int $size): array {
+            $values = [];
+            while (count($values) < $size) {
+                $values[mt_rand(0, 0xFFFFFFFF)] = true;
+            }
+            return array_keys($values);
+        },
+        // 集中在 2 * size 的范围内，容器都是位图容器
+        'dense' => function (int $size): array {
+            $values = [];
+            while (count($values) < $size) {
+                $values[mt_rand(0, 2 * $size)] = true;
+            }
+            return array_keys($values);
+        },
+        // 每簇 1000 个随机值落在 4096 的窗口内，簇之间隔开很远
+        'clustered' => function (int $size): array {
+            $values = [];
+            $base = 0;
+            while (count($values) < $size) {
+                $base += mt_rand(1 << 16, 1 << 22);
+                for ($i = 0; $i < 1000 && count($values) < $size; $i++) {
+                    $values[$base + mt_rand(0, 4095)] = true;
+                }
+            }
+            return array_keys($values);
+        },
+        // 长度 500 到 5000 的连续区间，runOptimize 后都是游程容器
+        'runs' => function (int $size): array {
+            $values = [];
+            $start = 0;
+            while (count($values) < $size) {
+                $start += mt_rand(100, 20000);
+                $length = min(mt_rand(500, 5000), $size - count($values));
+                for ($i = 0; $i < $length; $i++) {
+                    $values[] = $start + $i;
+                }
+                $start += $length;
+            }
+            return $values;
+        },
+    ];
+}
+
+/**
+ * @param int $bit
+ * @param int[] $values
+ * @param bool $optimize
+ * @return Bitmap
+ */
+function newBitmap(int $bit, array $values, bool $optimize): Bitmap
+{
+    $bitmap = new Bitmap($bit);
+    foreach (array_chunk($values, 65536) as $chunk) {
+        $bitmap->addMany($chunk);
+    }
+    if ($optimize) {
+        $bitmap->runOptimize();
+    }
+    return $bitmap;
+}
+
+/**
+ * 用例，每个用例返回 [操作次数, 闭包]
+ * @param int $bit
+ * @param int[] $values
+ * @param int[] $others 第二个位图的值，用于集合运算
+ * @param bool $optimize
+ * @return array<string, array{int, callable}>
+ */
+function cases(int $bit, array $values, array $others, bool $optimize): array
+{
+    $a = newBitmap($bit, $values, $optimize);
+    $b = newBitmap($bit, $others, $optimize);
+    $bytes = $a->toBytes();
+    $probes = $values;
+    shuffle($probes);
+    $probes = array_slice($probes, 0, 10000);
+    $count = count($values);
+    return [
+        'add' => [$count, function () use ($bit, $values) {
+            $bitmap = new Bitmap($bit);
+            foreach ($values as $v) {
+                $bitmap->add($v);
+            }
+        }],
+        'addMany' => [$count, function () use ($bit, $values, $optimize) {
+            newBitmap($bit, $values, $optimize);
+        }],
+        'contains' => [count($probes), function () use ($a, $probes) {
+            foreach ($probes as $v) {
+                $a->contains($v);
+            }
+        }],
+        'and' => [1, fn() => $a->and($b)],
+        'or' => [1, fn() => $a->or($b)],
+        'xOr' => [1, fn() => $a->xOr($b)],
+        'andNot' => [1, fn() => $a->andNot($b)],
+        'andCardinality' => [1, fn() => $a->andCardinality($b)],
+        'orCardinality' => [1, fn() => $a->orCardinality($b)],
+        'getCardinality' => [1, fn() => $a->getCardinality()],
+        'toBytes' => [1, fn() => $a->toBytes()],
+        'fromBytes' => [1, fn() => new Bitmap($bit, $bytes)],
+        'iterate' => [$count, function () use ($a) {
+            foreach ($a->iterate(1000) as $chunk) {
+            }
+        }],
+        'toArray' => [$count, fn() => $a->toArray()],
+    ];
+}
+
+$results = [];
+foreach ($bits as $bit) {
+    foreach (distributions() as $distribution => $generate) {
+        if (isset($options['distribution']) && $options['distribution'] !== $distribution) {
+            continue;
+        }
+        mt_srand(crc32("$bit-$distribution"));
+        $offset = $bit === Library::BIT_64 ? 1 << 40 : 0;
+        $values = array_map(fn($v) => $v + $offset, $generate($size));
+        sort($values);
+        $others = array_map(fn($v) => $v + $offset, $generate($size));
+        foreach (cases($bit, $values, $others, $distribution === 'runs') as $op => [$operations, $fn]) {
+            if (isset($options['filter']) && !str_contains($op, $options['filter'])) {
+                continue;
+            }
+            $fn();
+            $times = [];
+            for ($i = 0; $i < $repeat; $i++) {
+                $start = hrtime(true);
+                $fn();
+                $times[] = hrtime(true) - $start;
+            }
+            sort($times);
+            $median = $times[intdiv($repeat, 2)];
+            $results[] = [
+                'bit' => $bit,
+                'distribution' => $distribution,
+                'op' => $op,
+                'operations' => $operations,
+                'median_ns' => $median,
+                'min_ns' => $times[0],
+                'per_op_ns' => $median / $operations,
+            ];
+            fprintf(STDERR, "%2d %-10s %-15s %14.1f ns/op\n", $bit, $distribution, $op, $median / $operations);
+        }
+    }
+}
+
+$report = json_encode([
+    'meta' => [
+        'php' => PHP_VERSION,
+        'os' => PHP_OS_FAMILY,
+        'arch' => php_uname('m'),
+        'hardware' => Library::hardwareSupport(),
+        'size' => $size,
+        'repeat' => $repeat,
+        'time' => date(DATE_ATOM),
+    ],
+    'results' => $results,
+], JSON_PRETTY_PRINT) . "\n";
+if (isset($options['output'])) {
+    file_put_contents($options['output'], $report);
+} else {
+    echo $report;
+}
@@ -0,0 +1,353 @@
+<?php
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+declare(strict_types=1);
+
+namespace Roaring;
+
+use FFI;
+use RuntimeException;
+
+/**
+ * 位切片索引（Bit-Sliced Index），为位图中的每个元素（列）保存一个非负整数属性，例如年龄、消费金额
+ * 由 N 个切片位图和一个存在位图组成，第 i 个切片保存值的第 i 位为 1 的列，存在位图保存有值的列
+ * 比较、区间、求和、top-K 都在原生库中以位图运算完成，耗时与切片个数成正比，与不同值的个数无关
+ * 所有查询都可以传入 foundSet，只在其中的列上计算，例如“消费大于 100 且在分群 X 中”
+ */
+class BitSlicedIndex
+{
+    protected const EQ = 0;
+    protected const NE = 1;
+    protected const LT = 2;
+    protected const LE = 3;
+    protected const GT = 4;
+    protected const GE = 5;
+
+    /**
+     * 表示是32 位 还是 64 位
+     * @var int 32 or 64
+     */
+    protected int $bit = 0;
+
+    /**
+     * 存在位图
+     * @var Bitmap
+     */
+    protected Bitmap $ebm;
+
+    /**
+     * 切片位图，下标 i 的切片保存值的第 i 位为 1 的列
+     * @var array|Bitmap[]
+     */
+    protected array $slices = [];
+
+    /**
+     * 创建一个空的位切片索引
+     * @param int $bit 32 or 64，列的位数
+     */
+    public function __construct(int $bit = Library::BIT_32)
+    {
+        $this->bit = $bit;
+        $this->ebm = new Bitmap($bit);
+    }
+
+    /**
+     * 用已有的存在位图和切片位图创建位切片索引，不会复制位图，索引修改时这些位图也会被修改
+     * @param Bitmap $existence 存在位图
+     * @param array|Bitmap[] $slices 切片位图，从最低位开始
+     * @return BitSlicedIndex
+     */
+    public static function fromSlices(Bitmap $existence, array $slices): BitSlicedIndex
+    {
+        $bsi = new self($existence->getBit());
+        $bsi->ebm = $existence;
+        foreach ($slices as $slice) {
+            if ($slice->getBit() !== $bsi->bit) {
+                throw new RuntimeException("bitmap bit not equal");
+            }
+            $bsi->slices[] = $slice;
+        }
+        return $bsi;
+    }
+
+    /**
+     * 获取列的位数
+     * @return int 32 or 64
+     */
+    public function getBit(): int
+    {
+        return $this->bit;
+    }
+
+    /**
+     * 获取切片个数
+     * @return int
+     */
+    public function getBitDepth(): int
+    {
+        return count($this->slices);
+    }
+
+    /**
+     * 获取存在位图
+     * @return Bitmap
+     */
+    public function getExistenceBitmap(): Bitmap
+    {
+        return $this->ebm;
+    }
+
+    /**
+     * 获取切片位图，从最低位开始
+     * @return array|Bitmap[]
+     */
+    public function getSlices(): array
+    {
+        return $this->slices;
+    }
+
+    /**
+     * 获取有值的列的个数
+     * @return int
+     */
+    public function getCardinality(): int
+    {
+        return $this->ebm->getCardinality();
+    }
+
+    /**
+     * 设置一个列的值
+     * @param int $column
+     * @param int $value 非负整数
+     * @return $this
+     */
+    public function setValue(int $column, int $value): self
+    {
+        return $this->setValues([$column => $value]);
+    }
+
+    /**
+     * 批量设置列的值，在原生库中对每个切片做一次批量添加和一次批量删除
+     * @param array|int[] $values 键为列，值为非负整数
+     * @return $this
+     */
+    public function setValues(array $values): self
+    {
+        $n = count($values);
+        if ($n === 0) {
+            return $this;
+        }
+        $columns = Library::getFFI()->new("uint64_t[$n]");
+        $buff = Library::getFFI()->new("uint64_t[$n]");
+        $max = 0;
+        $i = 0;
+        foreach ($values as $column => $value) {
+            if ($column < 0 || $value < 0) {
+                throw new RuntimeException("bit sliced index column and value must not be negative");
+            }
+            $columns[$i] = $column;
+            $buff[$i++] = $value;
+            $max |= $value;
+        }
+        //切片不够时先补齐，原生库要求每个值都能用现有的切片表示
+        while ($max >> count($this->slices) !== 0) {
+            $this->slices[] = new Bitmap($this->bit);
+        }
+        $slices = Bitmap::newBitmapPtrs($this->slices, $this->bit);
+        $ok = Library::getInstance($this->bit)->bsi_set_many(FFI::addr($slices[0]), count($this->slices), $this->ptr($this->ebm), FFI::addr($columns[0]), FFI::addr($buff[0]), $n);
+        if (!$ok) {
+            throw new RuntimeException("bit sliced index set values failed");
+        }
+        return $this;
+    }
+
+    /**
+     * 获取一个列的值，没有值时返回 null
+     * @param int $column
+     * @return int|null
+     */
+    public function getValue(int $column): ?int
+    {
+        if ($column < 0) {
+            return null;
+        }
+        $value = Library::getFFI()->new('uint64_t');
+        $slices = Bitmap::newBitmapPtrs($this->slices, $this->bit);
+        if (!Library::getInstance($this->bit)->bsi_get(FFI::addr($slices[0]), count($this->slices), $this->ptr($this->ebm), $column, FFI::addr($value))) {
+            return null;
+        }
+        return $value->cdata;
+    }
+
+    /**
+     * 获取值等于 value 的列
+     * @param int $value
+     * @param Bitmap|null $foundSet 只在其中的列上计算
+     * @return Bitmap
+     */
+    public function equal(int $value, ?Bitmap $foundSet = null): Bitmap
+    {
+        return $this->compare(self::EQ, $value, $foundSet);
+    }
+
+    /**
+     * 获取值不等于 value 的列
+     * @param int $value
+     * @param Bitmap|null $foundSet 只在其中的列上计算
+     * @return Bitmap
+     */
+    public function notEqual(int $value, ?Bitmap $foundSet = null): Bitmap
+    {
+        return $this->compare(self::NE, $value, $foundSet);
+    }
+
+    /**
+     * 获取值小于 value 的列
+     * @param int $value
+     * @param Bitmap|null $foundSet 只在其中的列上计算
+     * @return Bitmap
+     */
+    public function lessThan(int $value, ?Bitmap $foundSet = null): Bitmap
+    {
+        return $this->compare(self::LT, $value, $foundSet);
+    }
+
+    /**
+     * 获取值小于等于 value 的列
+     * @param int $value
+     * @param Bitmap|null $foundSet 只在其中的列上计算
+     * @return Bitmap
+     */
+    public function lessThanOrEqual(int $value, ?Bitmap $foundSet = null): Bitmap
+    {
+        return $this->compare(self::LE, $value, $foundSet);
+    }
+
+    /**
+     * 获取值大于 value 的列
+     * @param int $value
+     * @param Bitmap|null $foundSet 只在其中的列上计算
+     * @return Bitmap
+     */
+    public function greaterThan(int $value, ?Bitmap $foundSet = null): Bitmap
+    {
+        return $this->compare(self::GT, $value, $foundSet);
+    }
+
+    /**
+     * 获取值大于等于 value 的列
+     * @param int $value
+     * @param Bitmap|null $foundSet 只在其中的列上计算
+     * @return Bitmap
+     */
+    public function greaterThanOrEqual(int $value, ?Bitmap $foundSet = null): Bitmap
+    {
+        return $this->compare(self::GE, $value, $foundSet);
+    }
+
+    /**
+     * 获取值在闭区间 [min, max] 内的列
+     * @param int $min
+     * @param int $max
+     * @param Bitmap|null $foundSet 只在其中的列上计算
+     * @return Bitmap
+     */
+    public function between(int $min, int $max, ?Bitmap $foundSet = null): Bitmap
+    {
+        if ($max < 0 || $min > $max) {
+            return new Bitmap($this->bit);
+        }
+        $slices = Bitmap::newBitmapPtrs($this->slices, $this->bit);
+        $ptr = Library::getInstance($this->bit)->bsi_between(FFI::addr($slices[0]), count($this->slices), $this->ptr($this->ebm), $this->ptr($foundSet), max($min, 0), $max);
+        if (is_null($ptr)) {
+            throw new RuntimeException("bit sliced index between failed");
+        }
+        return Bitmap::fromPointer($this->bit, $ptr);
+    }
+
+    /**
+     * 计算列的值的和，每个切片只做一次交集基数计算，不生成中间位图
+     * @param Bitmap|null $foundSet 只在其中的列上计算
+     * @return int
+     */
+    public function sum(?Bitmap $foundSet = null): int
+    {
+        $sum = Library::getFFI()->new('int64_t');
+        $count = Library::getFFI()->new('uint64_t');
+        $slices = Bitmap::newBitmapPtrs($this->slices, $this->bit);
+        if (!Library::getInstance($this->bit)->bsi_sum(FFI::addr($slices[0]), count($this->slices), $this->ptr($this->ebm), $this->ptr($foundSet), FFI::addr($sum), FFI::addr($count))) {
+            throw new RuntimeException("bit sliced index sum overflow");
+        }
+        return $sum->cdata;
+    }
+
+    /**
+     * 获取值最大的 k 个列，不足 k 个时返回全部，值相同时取较小的列
+     * @param int $k
+     * @param Bitmap|null $foundSet 只在其中的列上计算
+     * @return Bitmap
+     */
+    public function topK(int $k, ?Bitmap $foundSet = null): Bitmap
+    {
+        if ($k < 0) {
+            throw new RuntimeException("k must not be negative");
+        }
+        $slices = Bitmap::newBitmapPtrs($this->slices, $this->bit);
+        $ptr = Library::getInstance($this->bit)->bsi_top_k(FFI::addr($slices[0]), count($this->slices), $this->ptr($this->ebm), $this->ptr($foundSet), $k);
+        if (is_null($ptr)) {
+            throw new RuntimeException("bit sliced index top k failed");
+        }
+        return Bitmap::fromPointer($this->bit, $ptr);
+    }
+
+    /**
+     * @param int $op
+     * @param int $value
+     * @param Bitmap|null $foundSet
+     * @return Bitmap
+     */
+    protected function compare(int $op, int $value, ?Bitmap $foundSet): Bitmap
+    {
+        if ($value < 0) {
+            //所有的值都是非负数
+            if ($op === self::EQ || $op === self::LT || $op === self::LE) {
+                return new Bitmap($this->bit);
+            }
+            $op = self::GE;
+            $value = 0;
+        }
+        $slices = Bitmap::newBitmapPtrs($this->slices, $this->bit);
+        $ptr = Library::getInstance($this->bit)->bsi_compare(FFI::addr($slices[0]), count($this->slices), $this->ptr($this->ebm), $this->ptr($foundSet), $op, $value);
+        if (is_null($ptr)) {
+            throw new RuntimeException("bit sliced index compare failed");
+        }
+        return Bitmap::fromPointer($this->bit, $ptr);
+    }
+
+    /**
+     * 获取位图的底层指针，null 时返回 null
+     * @param Bitmap|null $bitmap
+     * @return FFI\CData|null
+     */
+    protected function ptr(?Bitmap $bitmap): ?FFI\CData
+    {
+        if (is_null($bitmap)) {
+            return null;
+        }
+        return Bitmap::newBitmapPtrs([$bitmap], $this->bit)[0];
+    }
+}
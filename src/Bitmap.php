@@ -53,9 +53,10 @@ class Bitmap
     /**
      * 构造函数
      * @param int $bit 32 or 64
-     * @param string|null $bitmapBytes
+     * @param string|null $bitmapBytes toBytes 输出的字节码，自动识别 portable、native、frozen 格式
+     * @param int $threads 大于 1 时反序列化 portable 格式的 bitmapBytes 的各个容器分给最多 threads 个线程并行解码，适合很大的位图
      */
-    final public function __construct(int $bit = Library::BIT_32, string|null $bitmapBytes = null)
+    final public function __construct(int $bit = Library::BIT_32, string|null $bitmapBytes = null, int $threads = 1)
     {
         $this->bit = $bit;
         if ($bitmapBytes === null) {
@@ -69,9 +70,27 @@ class Bitmap
             FFI::memcpy($buf, $bitmapBytes, $length);
             $buf[$length] = "\0";
             $ptr = FFI::addr($buf[0]);
-            $this->bitmap = Library::getInstance($this->bit)->portable_deserialize($ptr, $length);
+            //旧的预编译库没有格式识别，只能按 portable 格式反序列化
+            $format = 0;
+            if (Library::supports("bp{$this->bit}_detect_format")) {
+                $format = Library::getInstance($this->bit)->detect_format($ptr, $length);
+            }
+            if ($format === 1) {
+                $this->bitmap = Library::getInstance($this->bit)->deserialize($ptr, $length);
+            } elseif ($format === 2) {
+                $this->bitmap = Library::getInstance($this->bit)->frozen_deserialize($ptr, $length);
+            } elseif ($threads > 1) {
+                $this->bitmap = Library::getInstance($this->bit)->portable_deserialize_parallel($ptr, $length, $threads);
+            } else {
+                $this->bitmap = Library::getInstance($this->bit)->portable_deserialize($ptr, $length);
+            }
             if (is_null($this->bitmap)) {
-                throw new RuntimeException("bitmap portable_deserialize failed");
+                $name = match ($format) {
+                    1 => 'deserialize',
+                    2 => 'frozen_deserialize',
+                    default => 'portable_deserialize',
+                };
+                throw new RuntimeException("bitmap $name failed");
             }
         }
     }
@@ -88,18 +107,238 @@ class Bitmap
     }
 
     /**
-     * 转为字节码
+     * 用底层bitmap指针创建位图对象，位图对象负责释放该指针，仅供本库内部使用
+     * @internal
+     * @param int $bit 32 or 64
+     * @param FFI\CData $ptr
+     * @return Bitmap
+     */
+    public static function fromPointer(int $bit, FFI\CData $ptr): Bitmap
+    {
+        $bp = unserialize(self::$unSerializeTpl[$bit]);
+        $bp->bitmap = $ptr;
+        return $bp;
+    }
+
+    /**
+     * 获取位图的位数
+     * @return int 32 or 64
+     */
+    public function getBit(): int
+    {
+        return $this->bit;
+    }
+
+    /**
+     * 转为 64 位位图，在原生库中按容器复制，不经过 php 数组
+     * @param bool $move 为 true 时直接把容器移动到新位图，不复制，this 变为空位图
+     * @return Bitmap
+     */
+    public function to64(bool $move = false): Bitmap
+    {
+        if ($this->bit === Library::BIT_64) {
+            return clone $this;
+        }
+        Library::ensureSupported($move ? 'bp_move_32_to_64' : 'bp_convert_32_to_64');
+        if ($move) {
+            $ptr = Library::getFFI()->bp_move_32_to_64($this->bitmap);
+        } else {
+            $ptr = Library::getFFI()->bp_convert_32_to_64($this->bitmap);
+        }
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap to64 failed");
+        }
+        return self::fromPointer(Library::BIT_64, $ptr);
+    }
+
+    /**
+     * 转为 32 位位图，在原生库中按容器复制，有大于 4294967295 的元素时抛出异常
+     * @return Bitmap
+     */
+    public function to32(): Bitmap
+    {
+        if ($this->bit === Library::BIT_32) {
+            return clone $this;
+        }
+        //大于 PHP_INT_MAX 的无符号整数在 php 中是负数
+        $max = $this->isEmpty() ? 0 : $this->maximum();
+        if ($max > 0xFFFFFFFF || $max < 0) {
+            throw new RuntimeException("bitmap value out of 32-bit range");
+        }
+        Library::ensureSupported('bp_convert_64_to_32');
+        $ptr = Library::getFFI()->bp_convert_64_to_32($this->bitmap);
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap to32 failed");
+        }
+        return self::fromPointer(Library::BIT_32, $ptr);
+    }
+
+    /**
+     * 转为字节码，构造函数可以自动识别以下任意一种格式
+     * portable：与其它语言的 Roaring 实现兼容的格式
+     * native：CRoaring 的 roaring_bitmap_serialize 格式，仅支持 32 位位图，稀疏位图直接存储 uint32 数组，比 portable 格式更小
+     * frozen：容器在内存中的布局，反序列化最快，体积通常最大，与机器字节序相关，32 位位图的共享容器保持共享，64 位位图会先收缩内存（frozen 格式的要求，元素不变）
+     * auto：比较 native 与 portable 格式的字节数，选择更小的一个，64 位位图没有 native 格式，总是选择 portable 格式
+     * @param int $threads 大于 1 时 portable 格式的各个容器分给最多 threads 个线程直接写入最终位置，结果与单线程一致，适合很大的位图
+     * @param string $format auto、portable、native 或 frozen
      * @return string
      */
-    final public function toBytes(): string
+    final public function toBytes(int $threads = 1, string $format = 'portable'): string
     {
+        if ($format === 'auto') {
+            $format = 'portable';
+            if ($this->bit === Library::BIT_32 && Library::getInstance($this->bit)->size_in_bytes($this->bitmap) < Library::getInstance($this->bit)->portable_size_in_bytes($this->bitmap)) {
+                $format = 'native';
+            }
+        }
+        if ($format === 'native') {
+            if ($this->bit !== Library::BIT_32) {
+                throw new RuntimeException("bitmap native format is not supported by 64-bit bitmaps");
+            }
+            $size = Library::getInstance($this->bit)->size_in_bytes($this->bitmap);
+            $buf = Library::getFFI()->new("char[$size]");
+            $size = Library::getInstance($this->bit)->serialize($this->bitmap, FFI::addr($buf[0]));
+            return FFI::string($buf, $size);
+        }
+        if ($format === 'frozen') {
+            $size = Library::getInstance($this->bit)->frozen_size_in_bytes($this->bitmap);
+            if ($size === 0) {
+                throw new RuntimeException("bitmap frozen_serialize failed");
+            }
+            $buf = Library::getFFI()->new("char[$size]");
+            $size = Library::getInstance($this->bit)->frozen_serialize($this->bitmap, FFI::addr($buf[0]));
+            if ($size === 0) {
+                throw new RuntimeException("bitmap frozen_serialize failed");
+            }
+            return FFI::string($buf, $size);
+        }
+        if ($format !== 'portable') {
+            throw new RuntimeException("bitmap format must be auto, portable, native or frozen");
+        }
         $size = Library::getInstance($this->bit)->portable_size_in_bytes($this->bitmap);
         $buf = Library::getFFI()->new("char[$size]");
         $ptr = FFI::addr($buf[0]);
-        $size = Library::getInstance($this->bit)->portable_serialize($this->bitmap, $ptr);
+        if ($threads > 1) {
+            $size = Library::getInstance($this->bit)->portable_serialize_parallel($this->bitmap, $ptr, $threads);
+            if ($size === 0) {
+                throw new RuntimeException("bitmap portable_serialize_parallel failed");
+            }
+        } else {
+            $size = Library::getInstance($this->bit)->portable_serialize($this->bitmap, $ptr);
+        }
         return FFI::string($buf, $size);
     }
 
+    /**
+     * 把字节码写入文件，文件已存在时覆盖
+     * 容器逐个序列化到一块有限大小的缓冲区后通过 write(2) 写入，不会在内存中生成完整的字节码
+     * @param string $path
+     * @return void
+     */
+    public function writeTo(string $path): void
+    {
+        if (!Library::getInstance($this->bit)->portable_write_file($this->bitmap, $path)) {
+            throw new RuntimeException("bitmap write to $path failed");
+        }
+    }
+
+    /**
+     * 把字节码写入流，写入的内容与 toBytes() 一致
+     * 每次最多生成 bufferSize 个字节写入流，不会在内存中生成完整的字节码，写入期间不能修改位图
+     * @param resource $resource 可写的流，例如 fopen 的返回值
+     * @param int $bufferSize 缓冲区字节数
+     * @return void
+     */
+    public function writeToStream($resource, int $bufferSize = 65536): void
+    {
+        if (!is_resource($resource)) {
+            throw new RuntimeException("resource is invalid");
+        }
+        if ($bufferSize < 1) {
+            throw new RuntimeException("buffer size must be greater than 0");
+        }
+        $writer = Library::getInstance($this->bit)->portable_writer_create($this->bitmap);
+        if (is_null($writer)) {
+            throw new RuntimeException("bitmap portable_writer_create failed");
+        }
+        try {
+            $buf = Library::getFFI()->new("char[$bufferSize]");
+            $ptr = FFI::addr($buf[0]);
+            while (($size = Library::getInstance($this->bit)->portable_writer_next($writer, $ptr, $bufferSize)) > 0) {
+                $bytes = FFI::string($buf, $size);
+                while ($bytes !== '') {
+                    $written = fwrite($resource, $bytes);
+                    if ($written === false || $written === 0) {
+                        throw new RuntimeException("bitmap write to stream failed");
+                    }
+                    $bytes = substr($bytes, $written);
+                }
+            }
+        } finally {
+            Library::getInstance($this->bit)->portable_writer_free($writer);
+        }
+    }
+
+    /**
+     * 从文件读取位图，文件内容是 toBytes()、writeTo() 或 writeToStream() 写入的字节码
+     * 容器逐个从文件读取并解码，不会把整个文件读入 php 字符串
+     * @param string $path
+     * @param int $bit 32 or 64
+     * @return Bitmap
+     */
+    public static function readFrom(string $path, int $bit = Library::BIT_32): Bitmap
+    {
+        $ptr = Library::getInstance($bit)->portable_read_file($path);
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap read from $path failed");
+        }
+        $bp = unserialize(self::$unSerializeTpl[$bit]);
+        $bp->bitmap = $ptr;
+        return $bp;
+    }
+
+    /**
+     * 转为稠密位串，第 i 位表示元素 i，长度是 最大值 / 8 + 1 个字节，空位图返回空字符串
+     * @param bool $msbFirst 为 false 时从每个字节的最低位开始编号，与 bitset_t 一致；为 true 时从最高位开始编号，与 redis 的 SETBIT 一致
+     * @return string
+     */
+    public function toDenseBitset(bool $msbFirst = false): string
+    {
+        $size = Library::getInstance($this->bit)->dense_size_in_bytes($this->bitmap);
+        if ($size < 0) {
+            throw new RuntimeException("bitmap dense bitset is too large");
+        }
+        if ($size === 0) {
+            return '';
+        }
+        $buf = Library::getFFI()->new("char[$size]");
+        if (!Library::getInstance($this->bit)->to_dense($this->bitmap, FFI::addr($buf[0]), $size, $msbFirst)) {
+            throw new RuntimeException("bitmap to_dense failed");
+        }
+        return FFI::string($buf, $size);
+    }
+
+    /**
+     * 用稠密位串创建位图，例如 redis 对 SETBIT 的键执行 GETRANGE 的结果
+     * 在原生库中每 8KB 直接生成一个容器，稀疏时是数组或游程容器，开启线程池（Library::setThreads）后并行解码
+     * @param string $bits 第 i 位表示元素 offset + i
+     * @param int $offset 第 0 位表示的元素
+     * @param int $bit 32 or 64
+     * @param bool $msbFirst 为 false 时从每个字节的最低位开始编号，与 bitset_t 一致；为 true 时从最高位开始编号，与 redis 的 SETBIT 一致
+     * @return Bitmap
+     */
+    public static function fromDenseBitset(string $bits, int $offset = 0, int $bit = Library::BIT_32, bool $msbFirst = false): Bitmap
+    {
+        if ($offset < 0) {
+            throw new RuntimeException("offset must not be negative");
+        }
+        $ptr = Library::getInstance($bit)->from_dense($bits, strlen($bits), $offset, $msbFirst);
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap from dense bitset failed, the values may not fit in $bit bits");
+        }
+        return self::fromPointer($bit, $ptr);
+    }
+
     /**
      * 序列化
      * @return array
@@ -135,7 +374,7 @@ class Bitmap
     }
 
     /**
-     * 克隆位图
+     * 克隆位图，开启写时复制时克隆出的位图与原位图共享容器
      * @return void
      */
     final public function __clone()
@@ -143,6 +382,29 @@ class Bitmap
         $this->bitmap = Library::getInstance($this->bit)->copy($this->bitmap);
     }
 
+    /**
+     * 设置写时复制，开启后克隆、复制出的位图与原位图共享容器，直到某一方修改该容器时才真正复制，适合克隆后只做少量修改的场景
+     * 克隆出的位图继承该设置，64 位位图不支持开启
+     * @param bool $enable
+     * @return $this
+     */
+    public function setCopyOnWrite(bool $enable = true): self
+    {
+        if (!Library::getInstance($this->bit)->set_copy_on_write($this->bitmap, $enable)) {
+            throw new RuntimeException("bitmap copy on write is not supported by 64-bit bitmaps");
+        }
+        return $this;
+    }
+
+    /**
+     * 是否开启了写时复制
+     * @return bool
+     */
+    public function isCopyOnWrite(): bool
+    {
+        return Library::getInstance($this->bit)->get_copy_on_write($this->bitmap);
+    }
+
     /**
      * 创建一个指定长度的缓冲区
      * @param int $size
@@ -405,6 +667,70 @@ class Bitmap
         return Library::getInstance($this->bit)->intersect($this->bitmap, $bitmap->bitmap);
     }
 
+    /**
+     * 检查当前位图的所有元素是否都在 bitmap 中
+     * @param Bitmap $bitmap
+     * @return bool
+     */
+    public function isSubset(Bitmap $bitmap): bool
+    {
+        if ($this->bit !== $bitmap->bit) {
+            throw new RuntimeException("bitmap bit not equal");
+        }
+        return Library::getInstance($this->bit)->is_subset($this->bitmap, $bitmap->bitmap);
+    }
+
+    /**
+     * 计算两个位图的 Jaccard 相似度，即交集元素个数除以并集元素个数，两个位图都为空时返回 NAN
+     * @param Bitmap $bitmap
+     * @return float
+     */
+    public function jaccardIndex(Bitmap $bitmap): float
+    {
+        if ($this->bit !== $bitmap->bit) {
+            throw new RuntimeException("bitmap bit not equal");
+        }
+        return Library::getInstance($this->bit)->jaccard_index($this->bitmap, $bitmap->bitmap);
+    }
+
+    /**
+     * 在 candidates 中找出与当前位图最相似的 k 个位图，例如找出与种子人群最相似的人群包
+     * 在原生库中先用精确的元素个数给每个候选算出相似度的上界，按上界从大到小分批计算交集，上界达不到第 k 名时直接结束
+     * 开启线程池（Library::setThreads）后每一批的交集并行计算
+     * @param array|Bitmap[] $candidates
+     * @param int $k
+     * @param string $metric jaccard：交集元素个数除以并集元素个数；overlap：交集元素个数除以两者中较小的元素个数。无法定义时（位图为空）相似度为 0
+     * @return array|float[] 键为 candidates 的键，值为相似度，按相似度从大到小排列，相似度相同时在 candidates 中靠前的在前
+     */
+    public function mostSimilar(array $candidates, int $k, string $metric = 'jaccard'): array
+    {
+        $metric = match ($metric) {
+            'jaccard' => 0,
+            'overlap' => 1,
+            default => throw new RuntimeException("similarity metric must be jaccard or overlap"),
+        };
+        if ($k < 0) {
+            throw new RuntimeException("k must not be negative");
+        }
+        $n = min($k, count($candidates));
+        if ($n === 0) {
+            return [];
+        }
+        $keys = array_keys($candidates);
+        $ptrs = self::newBitmapPtrs($candidates, $this->bit);
+        $indices = Library::getFFI()->new("uint64_t[$n]");
+        $scores = Library::getFFI()->new("double[$n]");
+        $size = Library::getInstance($this->bit)->most_similar($this->bitmap, FFI::addr($ptrs[0]), count($candidates), $n, $metric, FFI::addr($indices[0]), FFI::addr($scores[0]));
+        if ($size < 0 || $size > $n) {
+            throw new RuntimeException("bitmap most_similar failed");
+        }
+        $ret = [];
+        for ($i = 0; $i < $size; $i++) {
+            $ret[$keys[$indices[$i]]] = $scores[$i];
+        }
+        return $ret;
+    }
+
     /**
      * 检查位图是否为空（基数为零）
      * @return bool
@@ -416,22 +742,26 @@ class Bitmap
 
     /**
      * 计算两个位图的并集，返回新位图
+     * 一个是 32 位、一个是 64 位时按容器合并，不转换任何一方，结果是 64 位位图
      * @param Bitmap|string $bitmap 位图对象或位图字节码
+     * @param int $threads 大于 1 时按容器key分片，最多用 threads 个线程并行计算，适合容器很多的大位图
      * @return Bitmap
      */
-    public function or(Bitmap|string $bitmap): Bitmap
+    public function or(Bitmap|string $bitmap, int $threads = 1): Bitmap
     {
         if (is_string($bitmap)) {
             if ($bitmap === '') {
                 return clone $this;
             }
             $bitmap = new self($this->bit, $bitmap);
+        } elseif ($this->bit !== $bitmap->bit) {
+            return $this->mixedOp($bitmap, 'or');
+        }
+        if ($threads > 1) {
+            $ptr = Library::getInstance($this->bit)->or_parallel($this->bitmap, $bitmap->bitmap, $threads);
         } else {
-            if ($this->bit !== $bitmap->bit) {
-                throw new RuntimeException("bitmap bit not equal");
-            }
+            $ptr = Library::getInstance($this->bit)->or($this->bitmap, $bitmap->bitmap);
         }
-        $ptr = Library::getInstance($this->bit)->or($this->bitmap, $bitmap->bitmap);
         if (is_null($ptr)) {
             throw new RuntimeException("bitmap or failed");
         }
@@ -443,9 +773,10 @@ class Bitmap
     /**
      * 原地计算并集，计算结果保存到this中
      * @param Bitmap|string $bitmap 位图对象或位图字节码
+     * @param int $threads 大于 1 时按容器key分片，最多用 threads 个线程并行计算，适合容器很多的大位图
      * @return Bitmap
      */
-    public function orInPlace(Bitmap|string $bitmap): self
+    public function orInPlace(Bitmap|string $bitmap, int $threads = 1): self
     {
         if (is_string($bitmap)) {
             if ($bitmap === '') {
@@ -457,6 +788,12 @@ class Bitmap
                 throw new RuntimeException("bitmap bit not equal");
             }
         }
+        if ($threads > 1) {
+            if (!Library::getInstance($this->bit)->or_inplace_parallel($this->bitmap, $bitmap->bitmap, $threads)) {
+                throw new RuntimeException("bitmap or_inplace_parallel failed");
+            }
+            return $this;
+        }
         Library::getInstance($this->bit)->or_inplace($this->bitmap, $bitmap->bitmap);
         return $this;
     }
@@ -483,6 +820,7 @@ class Bitmap
 
     /**
      * 计算两个位图的对称差集（异或），返回新位图
+     * 一个是 32 位、一个是 64 位时按容器合并，不转换任何一方，结果是 64 位位图
      * @param Bitmap|string $bitmap 位图对象或位图字节码
      * @return Bitmap
      */
@@ -493,10 +831,8 @@ class Bitmap
                 return clone $this;
             }
             $bitmap = new self($this->bit, $bitmap);
-        } else {
-            if ($this->bit !== $bitmap->bit) {
-                throw new RuntimeException("bitmap bit not equal");
-            }
+        } elseif ($this->bit !== $bitmap->bit) {
+            return $this->mixedOp($bitmap, 'xOr');
         }
         $ptr = Library::getInstance($this->bit)->xor($this->bitmap, $bitmap->bitmap);
         if (is_null($ptr)) {
@@ -550,6 +886,7 @@ class Bitmap
 
     /**
      * 计算两个位图的交集，返回新位图
+     * 一个是 32 位、一个是 64 位时按容器合并，不转换任何一方，结果与 this 的位数相同
      * @param Bitmap|string $bitmap 位图对象或位图字节码
      * @return Bitmap
      */
@@ -560,10 +897,8 @@ class Bitmap
                 return new self($this->bit);
             }
             $bitmap = new self($this->bit, $bitmap);
-        } else {
-            if ($this->bit !== $bitmap->bit) {
-                throw new RuntimeException("bitmap bit not equal");
-            }
+        } elseif ($this->bit !== $bitmap->bit) {
+            return $this->mixedOp($bitmap, 'and');
         }
         $ptr = Library::getInstance($this->bit)->and($this->bitmap, $bitmap->bitmap);
         if (is_null($ptr)) {
@@ -617,6 +952,7 @@ class Bitmap
 
     /**
      * 计算两个位图的差集，返回新位图
+     * 一个是 32 位、一个是 64 位时按容器合并，不转换任何一方，结果与 this 的位数相同
      * @param Bitmap|string $bitmap 位图对象或位图字节码
      * @return Bitmap
      */
@@ -627,10 +963,8 @@ class Bitmap
                 return clone $this;
             }
             $bitmap = new self($this->bit, $bitmap);
-        } else {
-            if ($this->bit !== $bitmap->bit) {
-                throw new RuntimeException("bitmap bit not equal");
-            }
+        } elseif ($this->bit !== $bitmap->bit) {
+            return $this->mixedOp($bitmap, 'andNot');
         }
         $ptr = Library::getInstance($this->bit)->andnot($this->bitmap, $bitmap->bitmap);
         if (is_null($ptr)) {
@@ -682,6 +1016,386 @@ class Bitmap
         return Library::getInstance($this->bit)->andnot_cardinality($this->bitmap, $bitmap->bitmap);
     }
 
+    /**
+     * 计算位图与范围 [min, max) 的交集，返回新位图
+     * 不需要先用 addRange 构建范围位图，只复制范围内的容器，范围两端的容器在原生库中裁剪
+     * @param int $min
+     * @param int $max
+     * @return Bitmap
+     */
+    public function andRange(int $min, int $max): Bitmap
+    {
+        $ptr = Library::getInstance($this->bit)->and_range($this->bitmap, $min, $max);
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap and_range failed");
+        }
+        $bp = unserialize(self::$unSerializeTpl[$this->bit]);
+        $bp->bitmap = $ptr;
+        return $bp;
+    }
+
+    /**
+     * 计算位图与范围 [min, max) 的差集，返回新位图
+     * 不需要先用 addRange 构建范围位图，范围内的容器直接跳过，范围两端的容器在原生库中裁剪
+     * @param int $min
+     * @param int $max
+     * @return Bitmap
+     */
+    public function andNotRange(int $min, int $max): Bitmap
+    {
+        $ptr = Library::getInstance($this->bit)->andnot_range($this->bitmap, $min, $max);
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap andnot_range failed");
+        }
+        $bp = unserialize(self::$unSerializeTpl[$this->bit]);
+        $bp->bitmap = $ptr;
+        return $bp;
+    }
+
+    /**
+     * 计算位图与范围 [min, max) 的并集，返回新位图
+     * 不需要先用 addRange 构建范围位图，范围内的key直接生成满的游程容器
+     * @param int $min
+     * @param int $max
+     * @return Bitmap
+     */
+    public function orRange(int $min, int $max): Bitmap
+    {
+        $ptr = Library::getInstance($this->bit)->or_range($this->bitmap, $min, $max);
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap or_range failed");
+        }
+        $bp = unserialize(self::$unSerializeTpl[$this->bit]);
+        $bp->bitmap = $ptr;
+        return $bp;
+    }
+
+    /**
+     * 计算位图在范围 [min, max) 内的补集，范围外的值保持不变，返回新位图
+     * 例如在全集 [0, n) 内求补集：$bitmap->flip(0, n)
+     * @param int $min
+     * @param int $max
+     * @return Bitmap
+     */
+    public function flip(int $min, int $max): Bitmap
+    {
+        $ptr = Library::getInstance($this->bit)->flip($this->bitmap, $min, $max);
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap flip failed");
+        }
+        $bp = unserialize(self::$unSerializeTpl[$this->bit]);
+        $bp->bitmap = $ptr;
+        return $bp;
+    }
+
+    /**
+     * 原地翻转范围 [min, max) 内的值，范围外的值保持不变
+     * @param int $min
+     * @param int $max
+     * @return $this
+     */
+    public function flipInPlace(int $min, int $max): self
+    {
+        Library::getInstance($this->bit)->flip_inplace($this->bitmap, $min, $max);
+        return $this;
+    }
+
+    /**
+     * 检查位图与范围 [min, max) 是否有交集
+     * @param int $min
+     * @param int $max
+     * @return bool
+     */
+    public function intersectWithRange(int $min, int $max): bool
+    {
+        return Library::getInstance($this->bit)->intersect_with_range($this->bitmap, $min, $max);
+    }
+
+    /**
+     * 给所有元素加上 offset，返回新位图，用于把一段 id 平移到新的起点，超出位图取值范围的元素被丢弃
+     * offset 是 65536 的倍数时直接把整个容器移动到新的key，否则在容器内平移
+     * @param int $offset 可以是负数
+     * @return Bitmap
+     */
+    public function shift(int $offset): Bitmap
+    {
+        $ptr = Library::getInstance($this->bit)->add_offset($this->bitmap, $offset);
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap add_offset failed");
+        }
+        $bp = unserialize(self::$unSerializeTpl[$this->bit]);
+        $bp->bitmap = $ptr;
+        return $bp;
+    }
+
+    /**
+     * 一个 32 位位图与一个 64 位位图的交集、并集、差集、对称差集，在原生库中按容器合并
+     * 交集、差集的结果与 this 的位数相同，并集、对称差集的结果是 64 位位图
+     * @param Bitmap $bitmap 位数与 this 不同的位图
+     * @param string $op and or andNot xOr
+     * @return Bitmap
+     */
+    protected function mixedOp(Bitmap $bitmap, string $op): Bitmap
+    {
+        $code = match ($op) {
+            'and' => 0,
+            'or' => 1,
+            'andNot' => 2,
+            'xOr' => 3,
+        };
+        Library::ensureSupported('bp_mixed_op');
+        $ptr = Library::getFFI()->bp_mixed_op($this->bitmap, $this->bit, $bitmap->bitmap, $bitmap->bit, $code);
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap $op failed");
+        }
+        return self::fromPointer($code === 0 || $code === 2 ? $this->bit : Library::BIT_64, $ptr);
+    }
+
+    /**
+     * 把一组位图的指针写入 void* 数组，要求所有位图的位数一致，仅供本库内部使用
+     * @internal
+     * @param array|Bitmap[] $bitmaps
+     * @param int $bit
+     * @return FFI\CData
+     */
+    public static function newBitmapPtrs(array $bitmaps, int $bit): FFI\CData
+    {
+        $ptrs = Library::getFFI()->new(sprintf('void *[%d]', max(count($bitmaps), 1)));
+        $i = 0;
+        foreach ($bitmaps as $bitmap) {
+            if ($bitmap->bit !== $bit) {
+                throw new RuntimeException("bitmap bit not equal");
+            }
+            $ptrs[$i++] = $bitmap->bitmap;
+        }
+        return $ptrs;
+    }
+
+    /**
+     * 计算多个位图的并集，返回新位图
+     * 开启线程池（Library::setThreads）后按容器key分片并行计算，结果与单线程一致
+     * @param Bitmap ...$bitmaps
+     * @return Bitmap
+     */
+    public static function orMany(Bitmap ...$bitmaps): Bitmap
+    {
+        if (count($bitmaps) === 0) {
+            throw new RuntimeException("bitmaps is empty");
+        }
+        $bitmaps = array_values($bitmaps);
+        $bit = $bitmaps[0]->bit;
+        $ptrs = self::newBitmapPtrs($bitmaps, $bit);
+        $ptr = Library::getInstance($bit)->or_many(FFI::addr($ptrs[0]), count($bitmaps));
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap or_many failed");
+        }
+        $bp = unserialize(self::$unSerializeTpl[$bit]);
+        $bp->bitmap = $ptr;
+        return $bp;
+    }
+
+    /**
+     * 计算多个位图的对称差集（异或），返回新位图
+     * 开启线程池（Library::setThreads）后按容器key分片并行计算，结果与单线程一致
+     * @param Bitmap ...$bitmaps
+     * @return Bitmap
+     */
+    public static function xOrMany(Bitmap ...$bitmaps): Bitmap
+    {
+        if (count($bitmaps) === 0) {
+            throw new RuntimeException("bitmaps is empty");
+        }
+        $bitmaps = array_values($bitmaps);
+        $bit = $bitmaps[0]->bit;
+        $ptrs = self::newBitmapPtrs($bitmaps, $bit);
+        $ptr = Library::getInstance($bit)->xor_many(FFI::addr($ptrs[0]), count($bitmaps));
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap xor_many failed");
+        }
+        $bp = unserialize(self::$unSerializeTpl[$bit]);
+        $bp->bitmap = $ptr;
+        return $bp;
+    }
+
+    /**
+     * 计算多个位图的交集，返回新位图
+     * 在原生库中先求所有位图公共的容器key，再按基数从小到大求每个key的交集，中间结果为空时立即结束
+     * 开启线程池（Library::setThreads）后按容器key分片并行计算，结果与单线程一致
+     * @param Bitmap ...$bitmaps
+     * @return Bitmap
+     */
+    public static function andMany(Bitmap ...$bitmaps): Bitmap
+    {
+        if (count($bitmaps) === 0) {
+            throw new RuntimeException("bitmaps is empty");
+        }
+        $bitmaps = array_values($bitmaps);
+        $bit = $bitmaps[0]->bit;
+        $ptrs = self::newBitmapPtrs($bitmaps, $bit);
+        $ptr = Library::getInstance($bit)->and_many(FFI::addr($ptrs[0]), count($bitmaps));
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap and_many failed");
+        }
+        $bp = unserialize(self::$unSerializeTpl[$bit]);
+        $bp->bitmap = $ptr;
+        return $bp;
+    }
+
+    /**
+     * 计算多个位图交集的元素个数，不生成交集位图
+     * @param Bitmap ...$bitmaps
+     * @return int
+     */
+    public static function andManyCardinality(Bitmap ...$bitmaps): int
+    {
+        if (count($bitmaps) === 0) {
+            throw new RuntimeException("bitmaps is empty");
+        }
+        $bitmaps = array_values($bitmaps);
+        $bit = $bitmaps[0]->bit;
+        $ptrs = self::newBitmapPtrs($bitmaps, $bit);
+        $cardinality = Library::getFFI()->new('uint64_t');
+        if (!Library::getInstance($bit)->and_many_cardinality(FFI::addr($ptrs[0]), count($bitmaps), FFI::addr($cardinality))) {
+            throw new RuntimeException("bitmap and_many_cardinality failed");
+        }
+        return $cardinality->cdata;
+    }
+
+    /**
+     * 计算至少出现在 t 个位图中的元素，返回新位图，例如“命中这 10 个兴趣中至少 3 个的用户”
+     * 在原生库中按容器key对齐计数：只出现在不足 t 个位图中的key直接跳过，其余的key用按位切片的计数器一次累加 64 个元素
+     * t 为 1 时等同于并集，t 等于位图个数时等同于交集，t 大于位图个数时返回空位图
+     * 开启线程池（Library::setThreads）后按容器key分片并行计算，结果与单线程一致
+     * @param array|Bitmap[] $bitmaps
+     * @param int $t
+     * @return Bitmap
+     */
+    public static function threshold(array $bitmaps, int $t): Bitmap
+    {
+        if (count($bitmaps) === 0) {
+            throw new RuntimeException("bitmaps is empty");
+        }
+        if ($t < 1) {
+            throw new RuntimeException("t must be greater than 0");
+        }
+        $bitmaps = array_values($bitmaps);
+        $bit = $bitmaps[0]->bit;
+        $ptrs = self::newBitmapPtrs($bitmaps, $bit);
+        $ptr = Library::getInstance($bit)->threshold(FFI::addr($ptrs[0]), count($bitmaps), $t);
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap threshold failed");
+        }
+        $bp = unserialize(self::$unSerializeTpl[$bit]);
+        $bp->bitmap = $ptr;
+        return $bp;
+    }
+
+    /**
+     * 统计每个元素出现在多少个位图中，例如“在这 500 个日活位图中出现次数最多的 1000 个用户”
+     * 在原生库中按容器key逐个累加计数器，计数器只覆盖一个key，内存与元素个数无关
+     * 取 top K 时只保留 K 个候选，出现的位图个数不超过第 K 名次数的key直接跳过
+     * 开启线程池（Library::setThreads）后按容器key分片并行计算，结果与单线程一致
+     * @param array|Bitmap[] $bitmaps
+     * @param int $topK 0 表示返回所有元素，按元素从小到大排列；大于 0 时返回次数最多的 K 个元素，按次数从大到小排列，次数相同时元素小的在前
+     * @return array|int[] 键为元素，值为出现的次数
+     */
+    public static function occurrenceCounts(array $bitmaps, int $topK = 0): array
+    {
+        if (count($bitmaps) === 0) {
+            throw new RuntimeException("bitmaps is empty");
+        }
+        if ($topK < 0) {
+            throw new RuntimeException("topK must not be negative");
+        }
+        $bitmaps = array_values($bitmaps);
+        $bit = $bitmaps[0]->bit;
+        $ptrs = self::newBitmapPtrs($bitmaps, $bit);
+        $ptr = Library::getInstance($bit)->occurrence_counts(FFI::addr($ptrs[0]), count($bitmaps), $topK);
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap occurrence_counts failed");
+        }
+        $size = Library::getFFI()->bp_occurrences_size($ptr);
+        $values = Library::getFFI()->new(sprintf('uint64_t[%d]', max($size, 1)));
+        $counts = Library::getFFI()->new(sprintf('uint64_t[%d]', max($size, 1)));
+        Library::getFFI()->bp_occurrences_export($ptr, FFI::addr($values[0]), FFI::addr($counts[0]));
+        $ret = [];
+        for ($i = 0; $i < $size; $i++) {
+            $ret[$values[$i]] = $counts[$i];
+        }
+        return $ret;
+    }
+
+    /**
+     * 计算两组位图两两交集的元素个数
+     * 返回 $ret[$i][$j] = $bitmaps1[$i] 与 $bitmaps2[$j] 交集的元素个数，键与入参数组的键一致
+     * 开启线程池（Library::setThreads）后各个格子并行计算
+     * @param array|Bitmap[] $bitmaps1
+     * @param array|Bitmap[] $bitmaps2
+     * @return array
+     */
+    public static function andCardinalityMatrix(array $bitmaps1, array $bitmaps2): array
+    {
+        $n1 = count($bitmaps1);
+        $n2 = count($bitmaps2);
+        if ($n1 === 0 || $n2 === 0) {
+            return [];
+        }
+        $bit = reset($bitmaps1)->bit;
+        $ptrs1 = self::newBitmapPtrs($bitmaps1, $bit);
+        $ptrs2 = self::newBitmapPtrs($bitmaps2, $bit);
+        $out = Library::getFFI()->new(sprintf('uint64_t[%d]', $n1 * $n2));
+        Library::getInstance($bit)->and_cardinality_matrix(FFI::addr($ptrs1[0]), $n1, FFI::addr($ptrs2[0]), $n2, FFI::addr($out[0]));
+        $keys2 = array_keys($bitmaps2);
+        $ret = [];
+        $k = 0;
+        foreach (array_keys($bitmaps1) as $key1) {
+            foreach ($keys2 as $key2) {
+                $ret[$key1][$key2] = $out[$k++];
+            }
+        }
+        return $ret;
+    }
+
+    /**
+     * 批量转为字节码，返回值的键与入参数组的键一致，每个值与 toBytes() 的结果一致
+     * 所有位图序列化到同一块缓冲区，开启线程池（Library::setThreads）后各个位图并行序列化
+     * @param array|Bitmap[] $bitmaps
+     * @return array|string[]
+     */
+    public static function serializeMany(array $bitmaps): array
+    {
+        $n = count($bitmaps);
+        if ($n === 0) {
+            return [];
+        }
+        $bit = reset($bitmaps)->bit;
+        $ptrs = self::newBitmapPtrs($bitmaps, $bit);
+        $sizes = Library::getFFI()->new(sprintf('size_t[%d]', $n));
+        $total = Library::getInstance($bit)->portable_size_in_bytes_many(FFI::addr($ptrs[0]), $n, FFI::addr($sizes[0]));
+        $buf = Library::getFFI()->new("char[$total]");
+        Library::getInstance($bit)->portable_serialize_many(FFI::addr($ptrs[0]), $n, FFI::addr($sizes[0]), FFI::addr($buf[0]));
+        $ret = [];
+        $offset = 0;
+        $i = 0;
+        foreach (array_keys($bitmaps) as $key) {
+            $ret[$key] = FFI::string(FFI::addr($buf[$offset]), $sizes[$i]);
+            $offset += $sizes[$i++];
+        }
+        return $ret;
+    }
+
+    /**
+     * 计算位图布尔表达式，返回新位图，例如 Bitmap::evaluate('(A ∧ B) ∨ (C ∧ ¬D)', ['A' => $a, 'B' => $b, 'C' => $c, 'D' => $d])
+     * 整个表达式在原生库中求值，语法见 Expression，同一个表达式多次求值时可以直接使用 Expression 避免重复解析
+     * @param string $expr
+     * @param array|Bitmap[] $operands 键为操作数的名字
+     * @return Bitmap
+     */
+    public static function evaluate(string $expr, array $operands): Bitmap
+    {
+        return (new Expression($expr))->evaluate($operands);
+    }
+
     /**
      * 获取迭代器
      * @param int $size foreach循环返回，每次返回的最大元素个数
@@ -0,0 +1,295 @@
+<?php
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+declare(strict_types=1);
+
+namespace Roaring;
+
+use Countable;
+use FFI;
+use RuntimeException;
+
+/**
+ * 位图索引，适合取值较少的分类列，例如城市、渠道、等级
+ * 由一列 (行号, 值) 构建，每行只能有一个值，原生库一次遍历完成按值分组和所有位图的填充，开启线程池（Library::setThreads）后各个值的位图并行填充
+ * 等值编码：每个不同的值一个位图，保存取该值的行
+ * 范围编码：按值从小到大，第 i 个位图保存值小于等于第 i 小的值的行，任意区间只需要一次差集
+ * IN 和区间查询被编译成排序后的值的下标区间，交给原生库做一次多路并集
+ */
+class BitmapIndex implements Countable
+{
+    public const EQUALITY = 0;
+    public const RANGE = 1;
+
+    /**
+     * 表示是32 位 还是 64 位
+     * @var int 32 or 64
+     */
+    protected int $bit = 0;
+
+    /**
+     * 编码方式
+     * @var int self::EQUALITY or self::RANGE
+     */
+    protected int $encoding = self::EQUALITY;
+
+    /**
+     * 从小到大排序的不同的值
+     * @var array|int[]
+     */
+    protected array $values = [];
+
+    /**
+     * 与 values 一一对应的位图
+     * @var array|Bitmap[]
+     */
+    protected array $bitmaps = [];
+
+    /**
+     * 值到下标的映射
+     * @var array|int[]
+     */
+    protected array $positions = [];
+
+    final protected function __construct()
+    {
+    }
+
+    /**
+     * 用打包好的 (行号, 值) 构建索引
+     * @param string $pairs 以机器字节序的 64 位整数依次排列的行号和值，即 pack('q*', $row1, $value1, $row2, $value2, ...)，行号不能重复
+     * @param int $bit 32 or 64，行号的位数
+     * @param int $encoding self::EQUALITY or self::RANGE
+     * @return BitmapIndex
+     */
+    public static function fromPairs(string $pairs, int $bit = Library::BIT_32, int $encoding = self::EQUALITY): BitmapIndex
+    {
+        if (strlen($pairs) % 16 !== 0) {
+            throw new RuntimeException("bitmap index pairs length must be a multiple of 16");
+        }
+        if ($encoding !== self::EQUALITY && $encoding !== self::RANGE) {
+            throw new RuntimeException("bitmap index encoding must be BitmapIndex::EQUALITY or BitmapIndex::RANGE");
+        }
+        $ptr = Library::getInstance($bit)->index_build($pairs, intdiv(strlen($pairs), 16), $encoding);
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap index build failed, rows must be distinct and non-negative");
+        }
+        $size = Library::getFFI()->bp_index_size($ptr);
+        $values = Library::getFFI()->new(sprintf('int64_t[%d]', max($size, 1)));
+        $ptrs = Library::getFFI()->new(sprintf('void *[%d]', max($size, 1)));
+        Library::getFFI()->bp_index_export($ptr, FFI::addr($values[0]), FFI::addr($ptrs[0]));
+        $index = new static();
+        $index->bit = $bit;
+        $index->encoding = $encoding;
+        for ($i = 0; $i < $size; $i++) {
+            $index->values[$i] = $values[$i];
+            $index->bitmaps[$i] = Bitmap::fromPointer($bit, $ptrs[$i]);
+            $index->positions[$values[$i]] = $i;
+        }
+        return $index;
+    }
+
+    /**
+     * 用一列数据构建索引
+     * @param array|int[] $column 键为行号，值为列的值
+     * @param int $bit 32 or 64，行号的位数
+     * @param int $encoding self::EQUALITY or self::RANGE
+     * @return BitmapIndex
+     */
+    public static function fromArray(array $column, int $bit = Library::BIT_32, int $encoding = self::EQUALITY): BitmapIndex
+    {
+        $pairs = [];
+        foreach ($column as $row => $value) {
+            $pairs[] = $row;
+            $pairs[] = $value;
+        }
+        return self::fromPairs(pack('q*', ...$pairs), $bit, $encoding);
+    }
+
+    /**
+     * 获取行号的位数
+     * @return int 32 or 64
+     */
+    public function getBit(): int
+    {
+        return $this->bit;
+    }
+
+    /**
+     * 获取编码方式
+     * @return int self::EQUALITY or self::RANGE
+     */
+    public function getEncoding(): int
+    {
+        return $this->encoding;
+    }
+
+    /**
+     * 获取从小到大排序的不同的值
+     * @return array|int[]
+     */
+    public function getValues(): array
+    {
+        return $this->values;
+    }
+
+    /**
+     * 获取不同的值的个数
+     * @return int
+     */
+    public function count(): int
+    {
+        return count($this->values);
+    }
+
+    /**
+     * 获取值等于 value 的行
+     * @param int $value
+     * @return Bitmap
+     */
+    public function equal(int $value): Bitmap
+    {
+        return $this->in([$value]);
+    }
+
+    /**
+     * 获取值在 values 中的行，相邻的值合并成一个区间后在原生库中求并集
+     * @param array|int[] $values
+     * @return Bitmap
+     */
+    public function in(array $values): Bitmap
+    {
+        $positions = [];
+        foreach ($values as $value) {
+            if (isset($this->positions[$value])) {
+                $positions[$this->positions[$value]] = true;
+            }
+        }
+        $positions = array_keys($positions);
+        sort($positions);
+        $runs = [];
+        foreach ($positions as $position) {
+            $last = count($runs) - 1;
+            if ($last >= 0 && $runs[$last][1] + 1 === $position) {
+                $runs[$last][1] = $position;
+            } else {
+                $runs[] = [$position, $position];
+            }
+        }
+        return $this->union($runs);
+    }
+
+    /**
+     * 获取值在闭区间 [min, max] 内的行
+     * @param int $min
+     * @param int $max
+     * @return Bitmap
+     */
+    public function between(int $min, int $max): Bitmap
+    {
+        $first = $this->lowerBound($min);
+        $last = $this->lowerBound($max);
+        if ($last === count($this->values) || $this->values[$last] !== $max) {
+            $last--;
+        }
+        if ($first > $last) {
+            return $this->union([]);
+        }
+        return $this->union([[$first, $last]]);
+    }
+
+    /**
+     * 获取值小于 value 的行
+     * @param int $value
+     * @return Bitmap
+     */
+    public function lessThan(int $value): Bitmap
+    {
+        return $value === PHP_INT_MIN ? $this->union([]) : $this->between(PHP_INT_MIN, $value - 1);
+    }
+
+    /**
+     * 获取值小于等于 value 的行
+     * @param int $value
+     * @return Bitmap
+     */
+    public function lessThanOrEqual(int $value): Bitmap
+    {
+        return $this->between(PHP_INT_MIN, $value);
+    }
+
+    /**
+     * 获取值大于 value 的行
+     * @param int $value
+     * @return Bitmap
+     */
+    public function greaterThan(int $value): Bitmap
+    {
+        return $value === PHP_INT_MAX ? $this->union([]) : $this->between($value + 1, PHP_INT_MAX);
+    }
+
+    /**
+     * 获取值大于等于 value 的行
+     * @param int $value
+     * @return Bitmap
+     */
+    public function greaterThanOrEqual(int $value): Bitmap
+    {
+        return $this->between($value, PHP_INT_MAX);
+    }
+
+    /**
+     * 返回第一个大于等于 value 的值的下标，没有时返回值的个数
+     * @param int $value
+     * @return int
+     */
+    protected function lowerBound(int $value): int
+    {
+        $low = 0;
+        $high = count($this->values);
+        while ($low < $high) {
+            $mid = ($low + $high) >> 1;
+            if ($this->values[$mid] < $value) {
+                $low = $mid + 1;
+            } else {
+                $high = $mid;
+            }
+        }
+        return $low;
+    }
+
+    /**
+     * 在原生库中求多个下标区间的行的并集
+     * @param array $runs 排序且不相交的 [第一个下标, 最后一个下标]
+     * @return Bitmap
+     */
+    protected function union(array $runs): Bitmap
+    {
+        $number = count($runs);
+        $buff = Library::getFFI()->new(sprintf('uint64_t[%d]', max($number * 2, 1)));
+        foreach ($runs as $i => $run) {
+            $buff[$i * 2] = $run[0];
+            $buff[$i * 2 + 1] = $run[1];
+        }
+        $ptrs = Bitmap::newBitmapPtrs($this->bitmaps, $this->bit);
+        $ptr = Library::getInstance($this->bit)->index_union(FFI::addr($ptrs[0]), count($this->bitmaps), FFI::addr($buff[0]), $number, $this->encoding);
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap index union failed");
+        }
+        return Bitmap::fromPointer($this->bit, $ptr);
+    }
+}
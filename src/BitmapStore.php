@@ -0,0 +1,186 @@
+<?php
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+declare(strict_types=1);
+
+namespace Roaring;
+
+use Countable;
+use FFI;
+use RuntimeException;
+
+/**
+ * 位图仓库，把多个位图按键写入同一个文件
+ * 文件由文件头、按键排序的目录、每个位图的 frozen 格式字节码组成，文件头、目录、每个位图都带有 CRC32C 校验和
+ * 打开仓库时通过 mmap 映射文件，只校验文件头和目录，读取某个位图时二分查找目录，只读取并校验该位图自己的字节
+ * 文件使用写入机器的字节序，打开期间不能修改文件
+ */
+class BitmapStore implements Countable
+{
+    /**
+     * 指向底层仓库对象的指针
+     * @var object|null
+     */
+    protected object|null $store = null;
+
+    /**
+     * 仓库中位图的位数
+     * @var int 32 or 64
+     */
+    protected int $bit = 0;
+
+    /**
+     * 打开仓库文件
+     * @param string $path
+     */
+    public function __construct(string $path)
+    {
+        Library::ensureSupported('bp_store_open');
+        $this->store = Library::getFFI()->bp_store_open($path);
+        if (is_null($this->store)) {
+            throw new RuntimeException("bitmap store open $path failed");
+        }
+        $this->bit = Library::getFFI()->bp_store_bit($this->store);
+    }
+
+    public function __destruct()
+    {
+        $this->close();
+    }
+
+    /**
+     * 把一组位图写入仓库文件，文件已存在时覆盖，数组的键就是位图在仓库中的键
+     * 64 位的位图写入前会先收缩内存（frozen 格式的要求），位图内容不变
+     * @param string $path
+     * @param array|Bitmap[] $bitmaps
+     * @param int $bit 32 or 64，所有位图的位数必须与之一致
+     * @return void
+     */
+    public static function write(string $path, array $bitmaps, int $bit = Library::BIT_32): void
+    {
+        $n = count($bitmaps);
+        $ptrs = Bitmap::newBitmapPtrs($bitmaps, $bit);
+        $lengths = Library::getFFI()->new(sprintf('size_t[%d]', max($n, 1)));
+        $keys = '';
+        $i = 0;
+        foreach (array_keys($bitmaps) as $key) {
+            $key = (string)$key;
+            $lengths[$i++] = strlen($key);
+            $keys .= $key;
+        }
+        if (!Library::getInstance($bit)->store_write($path, $keys, FFI::addr($lengths[0]), FFI::addr($ptrs[0]), $n)) {
+            throw new RuntimeException("bitmap store write to $path failed");
+        }
+    }
+
+    /**
+     * 获取仓库中位图的位数
+     * @return int 32 or 64
+     */
+    public function getBit(): int
+    {
+        return $this->bit;
+    }
+
+    /**
+     * 获取仓库中位图的个数
+     * @return int
+     */
+    public function count(): int
+    {
+        return Library::getFFI()->bp_store_count($this->getStore());
+    }
+
+    /**
+     * 检查仓库中是否有指定键的位图
+     * @param string|int $key
+     * @return bool
+     */
+    public function has(string|int $key): bool
+    {
+        $key = (string)$key;
+        return Library::getFFI()->bp_store_find($this->getStore(), $key, strlen($key)) >= 0;
+    }
+
+    /**
+     * 读取指定键的位图，返回的位图是一份拷贝，可以随意修改
+     * @param string|int $key
+     * @return Bitmap
+     */
+    public function get(string|int $key): Bitmap
+    {
+        $key = (string)$key;
+        $index = Library::getFFI()->bp_store_find($this->getStore(), $key, strlen($key));
+        if ($index < 0) {
+            throw new RuntimeException("bitmap store key $key not found");
+        }
+        $ptr = Library::getFFI()->bp_store_get($this->store, $index);
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap store key $key checksum mismatch");
+        }
+        return Bitmap::fromPointer($this->bit, $ptr);
+    }
+
+    /**
+     * 获取仓库中所有的键，按字节序排序
+     * @return array|string[]
+     */
+    public function keys(): array
+    {
+        $store = $this->getStore();
+        $length = Library::getFFI()->new('size_t');
+        $n = $this->count();
+        $ret = [];
+        for ($i = 0; $i < $n; $i++) {
+            $ptr = Library::getFFI()->bp_store_key($store, $i, FFI::addr($length));
+            $ret[] = FFI::string($ptr, $length->cdata);
+        }
+        return $ret;
+    }
+
+    /**
+     * 校验仓库中所有位图的校验和
+     * @return bool
+     */
+    public function verify(): bool
+    {
+        return Library::getFFI()->bp_store_verify($this->getStore());
+    }
+
+    /**
+     * 关闭仓库，释放文件映射
+     * @return void
+     */
+    public function close(): void
+    {
+        if ($this->store) {
+            Library::getFFI()->bp_store_close($this->store);
+            $this->store = null;
+        }
+    }
+
+    /**
+     * @return object
+     */
+    protected function getStore(): object
+    {
+        if (is_null($this->store)) {
+            throw new RuntimeException("bitmap store is closed");
+        }
+        return $this->store;
+    }
+}
@@ -0,0 +1,1034 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Operations over many bitmaps at once.
+ *
+ * The inputs are flattened into container lists and walked key by key: every
+ * key is handled independently of all others, so the key space is cut into
+ * ranges that run on the thread pool, and the per-range results are spliced
+ * back together in key order. Each key is computed the same way whatever the
+ * number of threads, so the result does not depend on it.
+ */
+
+/**
+ * Computes the output container for one key. `group` holds the containers of
+ * the inputs having that key, in input order. Returns NULL when the key has
+ * no output. On allocation failure sets `*failed` and returns NULL.
+ */
+typedef container_t *(*lib_group_fn)(const lib_entry_t **group, size_t n, void *arg, uint8_t *result_type,
+                                     bool *failed);
+
+typedef struct {
+    const lib_list_t *lists;
+    size_t number;
+    const uint64_t *bounds;
+    size_t min_group;  // keys present in fewer inputs are skipped
+    lib_group_fn fn;
+    void *arg;
+    lib_list_t *outs;  // one per task
+    bool *failed;      // one per task
+} lib_groups_t;
+
+static void lib_groups_task(void *ctx, size_t task) {
+    lib_groups_t *g = (lib_groups_t *) ctx;
+    uint64_t lo = g->bounds[task];
+    uint64_t hi = g->bounds[task + 1];
+    size_t *pos = (size_t *) roaring_malloc(g->number * sizeof(size_t));
+    const lib_entry_t **group = (const lib_entry_t **) roaring_malloc(g->number * sizeof(lib_entry_t *));
+    if (pos == NULL || group == NULL) {
+        g->failed[task] = true;
+        roaring_free(pos);
+        roaring_free((void *) group);
+        return;
+    }
+    for (size_t i = 0; i < g->number; i++) {
+        pos[i] = lo == 0 ? 0 : lib_list_lower_bound(&g->lists[i], lo);
+    }
+    while (true) {
+        uint64_t key = hi;
+        for (size_t i = 0; i < g->number; i++) {
+            if (pos[i] < g->lists[i].size && g->lists[i].entries[pos[i]].key < key) {
+                key = g->lists[i].entries[pos[i]].key;
+            }
+        }
+        if (key == hi) {
+            break;
+        }
+        size_t n = 0;
+        for (size_t i = 0; i < g->number; i++) {
+            if (pos[i] < g->lists[i].size && g->lists[i].entries[pos[i]].key == key) {
+                group[n++] = &g->lists[i].entries[pos[i]++];
+            }
+        }
+        if (n < g->min_group) {
+            continue;
+        }
+        uint8_t type;
+        bool failed = false;
+        container_t *c = g->fn(group, n, g->arg, &type, &failed);
+        if (failed || (c != NULL && !lib_list_push(&g->outs[task], key, c, type))) {
+            g->failed[task] = true;
+            break;
+        }
+    }
+    roaring_free(pos);
+    roaring_free((void *) group);
+}
+
+/**
+ * Runs `fn` over every key of the given bitmaps on up to `threads` threads
+ * and returns the resulting bitmap, or NULL on allocation failure.
+ */
+static void *lib_groups_run(void **rs, size_t number, int bit, uint32_t threads, size_t min_group, lib_group_fn fn,
+                            void *arg) {
+    void *result = NULL;
+    lib_list_t *lists = (lib_list_t *) roaring_calloc(number == 0 ? 1 : number, sizeof(lib_list_t));
+    if (lists == NULL) {
+        return NULL;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < number; i++) {
+        if (!lib_list_view(&lists[i], rs[i], bit)) {
+            goto out_lists;
+        }
+        total += lists[i].size;
+    }
+    size_t tasks = lib_pool_tasks(threads, total);
+    uint64_t *bounds = (uint64_t *) roaring_malloc((tasks + 1) * sizeof(uint64_t));
+    lib_list_t *outs = (lib_list_t *) roaring_calloc(tasks, sizeof(lib_list_t));
+    bool *failed = (bool *) roaring_calloc(tasks, sizeof(bool));
+    if (bounds == NULL || outs == NULL || failed == NULL || !lib_key_bounds(lists, number, tasks, bounds)) {
+        goto out_tasks;
+    }
+    lib_groups_t g = {lists, number, bounds, min_group, fn, arg, outs, failed};
+    lib_pool_run_threads(threads, tasks, lib_groups_task, &g);
+    lib_list_t merged = {0};
+    bool ok = true;
+    for (size_t t = 0; t < tasks; t++) {
+        ok = ok && !failed[t] && lib_list_append(&merged, &outs[t]);
+    }
+    if (ok) {
+        result = lib_list_to_bitmap(&merged, bit);
+    } else {
+        lib_list_free_containers(&merged);
+    }
+out_tasks:
+    if (outs != NULL) {
+        for (size_t t = 0; t < tasks; t++) {
+            lib_list_free_containers(&outs[t]);
+        }
+    }
+    roaring_free(bounds);
+    roaring_free(outs);
+    roaring_free(failed);
+out_lists:
+    for (size_t i = 0; i < number; i++) {
+        lib_list_free(&lists[i]);
+    }
+    roaring_free(lists);
+    return result;
+}
+
+static container_t *lib_group_or(const lib_entry_t **group, size_t n, void *arg, uint8_t *result_type,
+                                 bool *failed) {
+    (void) arg;
+    uint8_t type = group[0]->typecode;
+    container_t *c = container_clone(group[0]->container, type);
+    for (size_t i = 1; i < n && c != NULL; i++) {
+        uint8_t t;
+        container_t *r = container_lazy_ior(c, type, group[i]->container, group[i]->typecode, &t);
+        if (r != c) {
+            container_free(c, type);
+        }
+        c = r;
+        type = t;
+    }
+    if (c != NULL) {
+        c = container_repair_after_lazy(c, &type);
+    }
+    *failed = c == NULL;
+    *result_type = type;
+    return c;
+}
+
+static container_t *lib_group_xor(const lib_entry_t **group, size_t n, void *arg, uint8_t *result_type,
+                                  bool *failed) {
+    (void) arg;
+    uint8_t type = group[0]->typecode;
+    container_t *c = container_clone(group[0]->container, type);
+    for (size_t i = 1; i < n && c != NULL; i++) {
+        uint8_t t;
+        c = container_ixor(c, type, group[i]->container, group[i]->typecode, &t);
+        type = t;
+    }
+    *failed = c == NULL;
+    *result_type = type;
+    return c;
+}
+
+static void *lib_or_many(void **rs, size_t number, int bit) {
+    return lib_groups_run(rs, number, bit, lib_pool_get_threads(), 1, lib_group_or, NULL);
+}
+
+static void *lib_xor_many(void **rs, size_t number, int bit) {
+    return lib_groups_run(rs, number, bit, lib_pool_get_threads(), 1, lib_group_xor, NULL);
+}
+
+//----------------------------按key分片的并集----------------------------
+
+static void *lib_or_parallel(void *r1, void *r2, int bit, uint32_t threads) {
+    void *rs[2] = {r1, r2};
+    return lib_groups_run(rs, 2, bit, threads, 1, lib_group_or, NULL);
+}
+
+/**
+ * Replaces the content of `r` with the content of `result` and frees what is
+ * left of `result`. `r` keeps its address and its flags (copy on write).
+ */
+static void lib_bitmap_replace(void *r, void *result, int bit) {
+    if (bit == LIB_BIT_32) {
+        roaring_bitmap_t *dst = (roaring_bitmap_t *) r;
+        roaring_bitmap_t *src = (roaring_bitmap_t *) result;
+        roaring_array_t tmp = dst->high_low_container;
+        dst->high_low_container = src->high_low_container;
+        dst->high_low_container.flags = tmp.flags;
+        src->high_low_container = tmp;
+        roaring_bitmap_free(src);
+        return;
+    }
+    roaring64_bitmap_t *dst = (roaring64_bitmap_t *) r;
+    roaring64_bitmap_t *src = (roaring64_bitmap_t *) result;
+    roaring64_bitmap_t tmp = *dst;
+    *dst = *src;
+    dst->flags = tmp.flags;
+    *src = tmp;
+    roaring64_bitmap_free(src);
+}
+
+static bool lib_or_inplace_parallel(void *r1, void *r2, int bit, uint32_t threads) {
+    void *result = lib_or_parallel(r1, r2, bit, threads);
+    if (result == NULL) {
+        return false;
+    }
+    lib_bitmap_replace(r1, result, bit);
+    return true;
+}
+
+//----------------------------两两交集基数----------------------------
+
+typedef struct {
+    void **rs1;
+    size_t n1;
+    void **rs2;
+    size_t n2;
+    int bit;
+    size_t tasks;
+    uint64_t *out;
+} lib_matrix_t;
+
+static void lib_matrix_task(void *ctx, size_t task) {
+    lib_matrix_t *m = (lib_matrix_t *) ctx;
+    size_t cells = m->n1 * m->n2;
+    size_t begin = task * cells / m->tasks;
+    size_t end = (task + 1) * cells / m->tasks;
+    for (size_t k = begin; k < end; k++) {
+        void *r1 = m->rs1[k / m->n2];
+        void *r2 = m->rs2[k % m->n2];
+        if (m->bit == LIB_BIT_32) {
+            m->out[k] = roaring_bitmap_and_cardinality((const roaring_bitmap_t *) r1, (const roaring_bitmap_t *) r2);
+        } else {
+            m->out[k] = roaring64_bitmap_and_cardinality((const roaring64_bitmap_t *) r1, (const roaring64_bitmap_t *) r2);
+        }
+    }
+}
+
+/**
+ * out[i * n2 + j] = |rs1[i] AND rs2[j]|. The cells are split over the pool,
+ * each one is an independent read-only computation.
+ */
+static void lib_and_cardinality_matrix(void **rs1, size_t n1, void **rs2, size_t n2, uint64_t *out, int bit) {
+    lib_matrix_t m = {rs1, n1, rs2, n2, bit, lib_pool_tasks(lib_pool_get_threads(), n1 * n2), out};
+    if (n1 == 0 || n2 == 0) {
+        return;
+    }
+    lib_pool_run(m.tasks, lib_matrix_task, &m);
+}
+
+//----------------------------多路交集----------------------------
+
+typedef struct {
+    const lib_entry_t *entry;
+    int cardinality;
+} lib_and_operand_t;
+
+static int lib_and_operand_compare(const void *a, const void *b) {
+    int x = ((const lib_and_operand_t *) a)->cardinality;
+    int y = ((const lib_and_operand_t *) b)->cardinality;
+    return (x > y) - (x < y);
+}
+
+typedef struct {
+    const lib_entry_t **at;  // at[k * number + i] is the entry of the k-th common key in the i-th input
+    size_t keys;
+    size_t number;
+    size_t tasks;
+    bool count_only;
+    lib_list_t *outs;      // one per task, unused when counting
+    uint64_t *counts;      // one per task
+    bool *failed;          // one per task
+} lib_and_many_t;
+
+/**
+ * Intersects the containers of one common key, smallest first, and stops as
+ * soon as the running result is empty. When counting the last step is a
+ * cardinality only intersection and nothing is kept. Returns NULL when the
+ * result is empty or only counted. On allocation failure sets `*failed` and
+ * returns NULL.
+ */
+static container_t *lib_and_key(lib_and_operand_t *ops, size_t n, bool count_only, uint64_t *count,
+                                uint8_t *result_type, bool *failed) {
+    *count = 0;
+    qsort(ops, n, sizeof(lib_and_operand_t), lib_and_operand_compare);
+    if (ops[0].cardinality == 0) {
+        return NULL;
+    }
+    if (n == 1) {
+        *count = (uint64_t) ops[0].cardinality;
+        *result_type = ops[0].entry->typecode;
+        if (count_only) {
+            return NULL;
+        }
+        container_t *c = container_clone(ops[0].entry->container, ops[0].entry->typecode);
+        *failed = c == NULL;
+        return c;
+    }
+    if (count_only && n == 2) {
+        *count = (uint64_t) container_and_cardinality(ops[0].entry->container, ops[0].entry->typecode,
+                                                      ops[1].entry->container, ops[1].entry->typecode);
+        return NULL;
+    }
+    uint8_t type;
+    container_t *c = container_and(ops[0].entry->container, ops[0].entry->typecode, ops[1].entry->container,
+                                   ops[1].entry->typecode, &type);
+    for (size_t i = 2; i < n && c != NULL; i++) {
+        if (!container_nonzero_cardinality(c, type)) {
+            break;
+        }
+        if (count_only && i == n - 1) {
+            *count = (uint64_t) container_and_cardinality(c, type, ops[i].entry->container, ops[i].entry->typecode);
+            container_free(c, type);
+            return NULL;
+        }
+        uint8_t t;
+        container_t *r = container_iand(c, type, ops[i].entry->container, ops[i].entry->typecode, &t);
+        if (r != c) {
+            container_free(c, type);
+        }
+        c = r;
+        type = t;
+    }
+    if (c == NULL) {
+        *failed = true;
+        return NULL;
+    }
+    *count = (uint64_t) container_get_cardinality(c, type);
+    if (count_only) {
+        container_free(c, type);
+        return NULL;
+    }
+    *result_type = type;
+    return c;
+}
+
+static void lib_and_many_task(void *ctx, size_t task) {
+    lib_and_many_t *a = (lib_and_many_t *) ctx;
+    size_t begin = task * a->keys / a->tasks;
+    size_t end = (task + 1) * a->keys / a->tasks;
+    lib_and_operand_t *ops = (lib_and_operand_t *) roaring_malloc(a->number * sizeof(lib_and_operand_t));
+    if (ops == NULL) {
+        a->failed[task] = true;
+        return;
+    }
+    for (size_t k = begin; k < end; k++) {
+        const lib_entry_t **entries = a->at + k * a->number;
+        for (size_t i = 0; i < a->number; i++) {
+            ops[i].entry = entries[i];
+            ops[i].cardinality = container_get_cardinality(entries[i]->container, entries[i]->typecode);
+        }
+        uint64_t count;
+        uint8_t type;
+        bool failed = false;
+        container_t *c = lib_and_key(ops, a->number, a->count_only, &count, &type, &failed);
+        a->counts[task] += count;
+        if (failed || (c != NULL && !lib_list_push(&a->outs[task], entries[0]->key, c, type))) {
+            a->failed[task] = true;
+            break;
+        }
+    }
+    roaring_free(ops);
+}
+
+static int lib_and_list_compare(const void *a, const void *b) {
+    size_t x = ((const lib_list_t *) a)->size;
+    size_t y = ((const lib_list_t *) b)->size;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Intersection of `number` bitmaps. The keys common to all inputs are found
+ * first, walking the inputs from the one with the fewest containers and
+ * galloping through the others, so an input only costs the keys that are
+ * still candidates, and nothing else is done when no key is left. The
+ * containers of every common key are then intersected smallest first, with
+ * the keys split over the pool. With `result` NULL only the cardinality is
+ * computed and no bitmap is built. Returns false on allocation failure.
+ */
+static bool lib_and_many_run(void **rs, size_t number, int bit, void **result, uint64_t *cardinality) {
+    bool ok = false;
+    *cardinality = 0;
+    lib_list_t *lists = (lib_list_t *) roaring_calloc(number == 0 ? 1 : number, sizeof(lib_list_t));
+    const lib_entry_t **at = NULL;
+    lib_list_t *outs = NULL;
+    uint64_t *counts = NULL;
+    bool *failed = NULL;
+    size_t tasks = 0;
+    if (lists == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < number; i++) {
+        if (!lib_list_view(&lists[i], rs[i], bit)) {
+            goto out;
+        }
+    }
+    qsort(lists, number, sizeof(lib_list_t), lib_and_list_compare);
+    size_t keys = number == 0 ? 0 : lists[0].size;
+    at = (const lib_entry_t **) roaring_malloc((keys == 0 ? 1 : keys * number) * sizeof(lib_entry_t *));
+    if (at == NULL) {
+        goto out;
+    }
+    for (size_t k = 0; k < keys; k++) {
+        at[k * number] = &lists[0].entries[k];
+    }
+    for (size_t i = 1; i < number && keys > 0; i++) {
+        size_t kept = 0;
+        size_t pos = 0;
+        for (size_t k = 0; k < keys && pos < lists[i].size; k++) {
+            uint64_t key = at[k * number]->key;
+            pos = lib_list_gallop(&lists[i], pos, key);
+            if (pos < lists[i].size && lists[i].entries[pos].key == key) {
+                if (kept != k) {
+                    memcpy(at + kept * number, at + k * number, i * sizeof(lib_entry_t *));
+                }
+                at[kept * number + i] = &lists[i].entries[pos++];
+                kept++;
+            }
+        }
+        keys = kept;
+    }
+    tasks = lib_pool_tasks(lib_pool_get_threads(), keys);
+    outs = (lib_list_t *) roaring_calloc(tasks, sizeof(lib_list_t));
+    counts = (uint64_t *) roaring_calloc(tasks, sizeof(uint64_t));
+    failed = (bool *) roaring_calloc(tasks, sizeof(bool));
+    if (outs == NULL || counts == NULL || failed == NULL) {
+        goto out;
+    }
+    if (keys > 0) {
+        lib_and_many_t a = {at, keys, number, tasks, result == NULL, outs, counts, failed};
+        lib_pool_run(tasks, lib_and_many_task, &a);
+    }
+    lib_list_t merged = {0};
+    ok = true;
+    for (size_t t = 0; t < tasks; t++) {
+        *cardinality += counts[t];
+        ok = ok && !failed[t] && (result == NULL || lib_list_append(&merged, &outs[t]));
+    }
+    if (ok && result != NULL) {
+        *result = lib_list_to_bitmap(&merged, bit);
+        ok = *result != NULL;
+    } else {
+        lib_list_free_containers(&merged);
+    }
+out:
+    if (outs != NULL) {
+        for (size_t t = 0; t < tasks; t++) {
+            lib_list_free_containers(&outs[t]);
+        }
+    }
+    roaring_free(outs);
+    roaring_free(counts);
+    roaring_free(failed);
+    roaring_free((void *) at);
+    for (size_t i = 0; i < number; i++) {
+        lib_list_free(&lists[i]);
+    }
+    roaring_free(lists);
+    return ok;
+}
+
+static void *lib_and_many(void **rs, size_t number, int bit) {
+    void *result = NULL;
+    uint64_t cardinality;
+    return lib_and_many_run(rs, number, bit, &result, &cardinality) ? result : NULL;
+}
+
+static bool lib_and_many_cardinality(void **rs, size_t number, int bit, uint64_t *cardinality) {
+    return lib_and_many_run(rs, number, bit, NULL, cardinality);
+}
+
+//----------------------------阈值----------------------------
+
+/**
+ * Adds the bits of `word` to the counters of word `w`. The counters of a key
+ * are bit sliced: bit b of the count of a value is in slice b, so one call
+ * adds 64 values with a ripple carry that stops as soon as nothing is left to
+ * carry.
+ */
+static inline void lib_threshold_add(uint64_t *slices, size_t depth, size_t w, uint64_t word) {
+    for (size_t s = 0; s < depth && word != 0; s++) {
+        uint64_t *x = slices + s * BITSET_CONTAINER_SIZE_IN_WORDS + w;
+        uint64_t carry = *x & word;
+        *x ^= word;
+        word = carry;
+    }
+}
+
+/**
+ * Values of one key present in at least `*(size_t *) arg` containers of the
+ * group. Only called for keys present in at least that many inputs. When
+ * every container of the group is needed this is a plain intersection,
+ * otherwise every container is added to bit sliced counters, bitsets a word at
+ * a time, and the counters are compared with the threshold slice by slice.
+ */
+static container_t *lib_group_threshold(const lib_entry_t **group, size_t n, void *arg, uint8_t *result_type,
+                                        bool *failed) {
+    size_t t = *(const size_t *) arg;
+    if (n == t) {
+        lib_and_operand_t *ops = (lib_and_operand_t *) roaring_malloc(n * sizeof(lib_and_operand_t));
+        if (ops == NULL) {
+            *failed = true;
+            return NULL;
+        }
+        for (size_t i = 0; i < n; i++) {
+            ops[i].entry = group[i];
+            ops[i].cardinality = container_get_cardinality(group[i]->container, group[i]->typecode);
+        }
+        uint64_t count;
+        container_t *c = lib_and_key(ops, n, false, &count, result_type, failed);
+        roaring_free(ops);
+        return c;
+    }
+    size_t depth = 0;
+    while (depth < 64 && (n >> depth) != 0) {
+        depth++;
+    }
+    // depth slices and one scratch bitset for run containers
+    uint64_t *slices = (uint64_t *) roaring_calloc((depth + 1) * BITSET_CONTAINER_SIZE_IN_WORDS, sizeof(uint64_t));
+    bitset_container_t *bitset = bitset_container_create();
+    if (slices == NULL || bitset == NULL) {
+        roaring_free(slices);
+        if (bitset != NULL) {
+            bitset_container_free(bitset);
+        }
+        *failed = true;
+        return NULL;
+    }
+    uint64_t *scratch = slices + depth * BITSET_CONTAINER_SIZE_IN_WORDS;
+    for (size_t i = 0; i < n; i++) {
+        const container_t *c = group[i]->container;
+        if (group[i]->typecode == ARRAY_CONTAINER_TYPE) {
+            const array_container_t *a = const_CAST_array(c);
+            for (int32_t j = 0; j < a->cardinality; j++) {
+                lib_threshold_add(slices, depth, a->array[j] >> 6, UINT64_C(1) << (a->array[j] & 63));
+            }
+            continue;
+        }
+        const uint64_t *words = scratch;
+        if (group[i]->typecode == BITSET_CONTAINER_TYPE) {
+            words = const_CAST_bitset(c)->words;
+        } else {
+            const run_container_t *run = const_CAST_run(c);
+            memset(scratch, 0, BITSET_CONTAINER_SIZE_IN_WORDS * sizeof(uint64_t));
+            for (int32_t j = 0; j < run->n_runs; j++) {
+                bitset_set_lenrange(scratch, run->runs[j].value, run->runs[j].length);
+            }
+        }
+        for (size_t w = 0; w < BITSET_CONTAINER_SIZE_IN_WORDS; w++) {
+            lib_threshold_add(slices, depth, w, words[w]);
+        }
+    }
+    // count >= t, from the most significant slice down
+    for (size_t w = 0; w < BITSET_CONTAINER_SIZE_IN_WORDS; w++) {
+        uint64_t gt = 0;
+        uint64_t eq = ~UINT64_C(0);
+        for (size_t s = depth; s-- > 0;) {
+            uint64_t x = slices[s * BITSET_CONTAINER_SIZE_IN_WORDS + w];
+            if ((t >> s) & 1) {
+                eq &= x;
+            } else {
+                gt |= eq & x;
+                eq &= ~x;
+            }
+        }
+        bitset->words[w] = gt | eq;
+    }
+    roaring_free(slices);
+    bitset->cardinality = bitset_container_compute_cardinality(bitset);
+    if (bitset->cardinality > DEFAULT_MAX_SIZE) {
+        *result_type = BITSET_CONTAINER_TYPE;
+        return bitset;
+    }
+    array_container_t *array = array_container_from_bitset(bitset);
+    bitset_container_free(bitset);
+    *failed = array == NULL;
+    *result_type = ARRAY_CONTAINER_TYPE;
+    return array;
+}
+
+/**
+ * Values present in at least `t` of the `number` bitmaps. Keys present in
+ * fewer than `t` bitmaps are skipped without looking at their containers,
+ * `t` equal to 1 is a union and `t` equal to `number` an intersection.
+ * Returns NULL on allocation failure.
+ */
+static void *lib_threshold(void **rs, size_t number, size_t t, int bit) {
+    if (t <= 1) {
+        return lib_or_many(rs, number, bit);
+    }
+    if (t > number) {
+        return lib_bitmap_create(bit);
+    }
+    if (t == number) {
+        return lib_and_many(rs, number, bit);
+    }
+    return lib_groups_run(rs, number, bit, lib_pool_get_threads(), t, lib_group_threshold, &t);
+}
+
+//----------------------------出现次数----------------------------
+
+typedef struct {
+    uint64_t value;
+    uint64_t count;
+} lib_occurrence_t;
+
+typedef struct {
+    lib_occurrence_t *items;
+    size_t size;
+    size_t capacity;
+} lib_occurrences_t;
+
+static void lib_occurrences_free(lib_occurrences_t *o) {
+    if (o != NULL) {
+        roaring_free(o->items);
+        roaring_free(o);
+    }
+}
+
+/**
+ * True if `a` ranks before `b`: higher count first, then smaller value.
+ */
+static inline bool lib_occurrence_before(const lib_occurrence_t *a, const lib_occurrence_t *b) {
+    return a->count > b->count || (a->count == b->count && a->value < b->value);
+}
+
+static int lib_occurrence_compare(const void *a, const void *b) {
+    const lib_occurrence_t *x = (const lib_occurrence_t *) a;
+    const lib_occurrence_t *y = (const lib_occurrence_t *) b;
+    return lib_occurrence_before(x, y) ? -1 : (lib_occurrence_before(y, x) ? 1 : 0);
+}
+
+static bool lib_occurrences_push(lib_occurrences_t *o, uint64_t value, uint64_t count) {
+    if (o->size == o->capacity) {
+        size_t capacity = o->capacity == 0 ? 1024 : 2 * o->capacity;
+        lib_occurrence_t *items = (lib_occurrence_t *) roaring_realloc(o->items, capacity * sizeof(lib_occurrence_t));
+        if (items == NULL) {
+            return false;
+        }
+        o->items = items;
+        o->capacity = capacity;
+    }
+    o->items[o->size].value = value;
+    o->items[o->size].count = count;
+    o->size++;
+    return true;
+}
+
+/**
+ * Offers an occurrence to a heap of the best `top_k`, the root being the one
+ * ranked last. `o->items` holds `top_k` items.
+ */
+static void lib_occurrences_offer(lib_occurrences_t *o, size_t top_k, uint64_t value, uint64_t count) {
+    lib_occurrence_t x = {value, count};
+    size_t i;
+    if (o->size < top_k) {
+        i = o->size++;
+        while (i > 0 && lib_occurrence_before(&o->items[(i - 1) / 2], &x)) {
+            o->items[i] = o->items[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        o->items[i] = x;
+        return;
+    }
+    if (!lib_occurrence_before(&x, &o->items[0])) {
+        return;
+    }
+    i = 0;
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= o->size) {
+            break;
+        }
+        if (child + 1 < o->size && lib_occurrence_before(&o->items[child], &o->items[child + 1])) {
+            child++;
+        }
+        if (!lib_occurrence_before(&x, &o->items[child])) {
+            break;
+        }
+        o->items[i] = o->items[child];
+        i = child;
+    }
+    o->items[i] = x;
+}
+
+typedef struct {
+    const lib_list_t *lists;
+    size_t number;
+    const uint64_t *bounds;
+    size_t top_k;  // 0 for all the values
+    size_t depth;  // counter slices
+    lib_occurrences_t *outs;  // one per task
+    bool *failed;  // one per task
+} lib_occurrences_run_t;
+
+/**
+ * Counts the keys of one range. The counters of a key are bit sliced as in
+ * `lib_group_threshold()` and reused from key to key, so the memory does not
+ * depend on the number of values. With a full top-k heap, a key present in no
+ * more inputs than the count of the last ranked value is skipped: its values
+ * can at best tie with it and are larger.
+ */
+static void lib_occurrences_task(void *ctx, size_t task) {
+    lib_occurrences_run_t *r = (lib_occurrences_run_t *) ctx;
+    lib_occurrences_t *out = &r->outs[task];
+    uint64_t lo = r->bounds[task];
+    uint64_t hi = r->bounds[task + 1];
+    size_t depth = r->depth;
+    size_t *pos = (size_t *) roaring_malloc(r->number * sizeof(size_t));
+    uint64_t *slices = (uint64_t *) roaring_malloc((depth + 1) * BITSET_CONTAINER_SIZE_IN_WORDS * sizeof(uint64_t));
+    if (r->top_k > 0) {
+        out->items = (lib_occurrence_t *) roaring_malloc(r->top_k * sizeof(lib_occurrence_t));
+        out->capacity = r->top_k;
+    }
+    if (pos == NULL || slices == NULL || (r->top_k > 0 && out->items == NULL)) {
+        r->failed[task] = true;
+        goto out;
+    }
+    uint64_t *scratch = slices + depth * BITSET_CONTAINER_SIZE_IN_WORDS;
+    for (size_t i = 0; i < r->number; i++) {
+        pos[i] = lo == 0 ? 0 : lib_list_lower_bound(&r->lists[i], lo);
+    }
+    while (true) {
+        uint64_t key = hi;
+        size_t n = 0;
+        for (size_t i = 0; i < r->number; i++) {
+            if (pos[i] < r->lists[i].size && r->lists[i].entries[pos[i]].key < key) {
+                key = r->lists[i].entries[pos[i]].key;
+            }
+        }
+        if (key == hi) {
+            break;
+        }
+        for (size_t i = 0; i < r->number; i++) {
+            if (pos[i] < r->lists[i].size && r->lists[i].entries[pos[i]].key == key) {
+                n++;
+            }
+        }
+        bool skip = r->top_k > 0 && out->size == r->top_k && n <= out->items[0].count;
+        if (!skip) {
+            memset(slices, 0, depth * BITSET_CONTAINER_SIZE_IN_WORDS * sizeof(uint64_t));
+        }
+        for (size_t i = 0; i < r->number; i++) {
+            if (pos[i] >= r->lists[i].size || r->lists[i].entries[pos[i]].key != key) {
+                continue;
+            }
+            const lib_entry_t *e = &r->lists[i].entries[pos[i]++];
+            if (skip) {
+                continue;
+            }
+            if (e->typecode == ARRAY_CONTAINER_TYPE) {
+                const array_container_t *a = const_CAST_array(e->container);
+                for (int32_t j = 0; j < a->cardinality; j++) {
+                    lib_threshold_add(slices, depth, a->array[j] >> 6, UINT64_C(1) << (a->array[j] & 63));
+                }
+                continue;
+            }
+            const uint64_t *words = scratch;
+            if (e->typecode == BITSET_CONTAINER_TYPE) {
+                words = const_CAST_bitset(e->container)->words;
+            } else {
+                const run_container_t *run = const_CAST_run(e->container);
+                memset(scratch, 0, BITSET_CONTAINER_SIZE_IN_WORDS * sizeof(uint64_t));
+                for (int32_t j = 0; j < run->n_runs; j++) {
+                    bitset_set_lenrange(scratch, run->runs[j].value, run->runs[j].length);
+                }
+            }
+            for (size_t w = 0; w < BITSET_CONTAINER_SIZE_IN_WORDS; w++) {
+                lib_threshold_add(slices, depth, w, words[w]);
+            }
+        }
+        if (skip) {
+            continue;
+        }
+        for (size_t w = 0; w < BITSET_CONTAINER_SIZE_IN_WORDS; w++) {
+            uint64_t any = 0;
+            for (size_t s = 0; s < depth; s++) {
+                any |= slices[s * BITSET_CONTAINER_SIZE_IN_WORDS + w];
+            }
+            while (any != 0) {
+                uint32_t b = (uint32_t) roaring_trailing_zeroes(any);
+                any &= any - 1;
+                uint64_t count = 0;
+                for (size_t s = 0; s < depth; s++) {
+                    count |= ((slices[s * BITSET_CONTAINER_SIZE_IN_WORDS + w] >> b) & 1) << s;
+                }
+                uint64_t value = (key << 16) | (w << 6) | b;
+                if (r->top_k > 0) {
+                    lib_occurrences_offer(out, r->top_k, value, count);
+                } else if (!lib_occurrences_push(out, value, count)) {
+                    r->failed[task] = true;
+                    goto out;
+                }
+            }
+        }
+    }
+out:
+    roaring_free(pos);
+    roaring_free(slices);
+}
+
+/**
+ * Counts in how many of the `number` bitmaps every value appears. With
+ * `top_k` 0 the result holds every value of the union sorted by value,
+ * otherwise the `top_k` values with the highest counts, ties going to the
+ * smaller value, sorted in that order. Keys are split over the pool. Returns
+ * NULL on allocation failure.
+ */
+static lib_occurrences_t *lib_occurrence_counts(void **rs, size_t number, size_t top_k, int bit) {
+    lib_occurrences_t *result = NULL;
+    lib_list_t *lists = (lib_list_t *) roaring_calloc(number == 0 ? 1 : number, sizeof(lib_list_t));
+    if (lists == NULL) {
+        return NULL;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < number; i++) {
+        if (!lib_list_view(&lists[i], rs[i], bit)) {
+            goto out_lists;
+        }
+        total += lists[i].size;
+    }
+    size_t tasks = lib_pool_tasks(lib_pool_get_threads(), total);
+    uint64_t *bounds = (uint64_t *) roaring_malloc((tasks + 1) * sizeof(uint64_t));
+    lib_occurrences_t *outs = (lib_occurrences_t *) roaring_calloc(tasks, sizeof(lib_occurrences_t));
+    bool *failed = (bool *) roaring_calloc(tasks, sizeof(bool));
+    result = (lib_occurrences_t *) roaring_calloc(1, sizeof(lib_occurrences_t));
+    if (bounds == NULL || outs == NULL || failed == NULL || result == NULL ||
+        !lib_key_bounds(lists, number, tasks, bounds)) {
+        goto fail;
+    }
+    size_t depth = 0;
+    while (depth < 64 && (number >> depth) != 0) {
+        depth++;
+    }
+    lib_occurrences_run_t r = {lists, number, bounds, top_k, depth, outs, failed};
+    lib_pool_run(tasks, lib_occurrences_task, &r);
+    size_t size = 0;
+    for (size_t t = 0; t < tasks; t++) {
+        if (failed[t]) {
+            goto fail;
+        }
+        size += outs[t].size;
+    }
+    result->items = (lib_occurrence_t *) roaring_malloc((size == 0 ? 1 : size) * sizeof(lib_occurrence_t));
+    if (result->items == NULL) {
+        goto fail;
+    }
+    for (size_t t = 0; t < tasks; t++) {
+        if (outs[t].size > 0) {
+            memcpy(result->items + result->size, outs[t].items, outs[t].size * sizeof(lib_occurrence_t));
+        }
+        result->size += outs[t].size;
+    }
+    result->capacity = size;
+    if (top_k > 0) {
+        qsort(result->items, result->size, sizeof(lib_occurrence_t), lib_occurrence_compare);
+        if (result->size > top_k) {
+            result->size = top_k;
+        }
+    }
+    goto out_tasks;
+fail:
+    lib_occurrences_free(result);
+    result = NULL;
+out_tasks:
+    if (outs != NULL) {
+        for (size_t t = 0; t < tasks; t++) {
+            roaring_free(outs[t].items);
+        }
+    }
+    roaring_free(bounds);
+    roaring_free(outs);
+    roaring_free(failed);
+out_lists:
+    for (size_t i = 0; i < number; i++) {
+        lib_list_free(&lists[i]);
+    }
+    roaring_free(lists);
+    return result;
+}
+
+//----------------------------相似度----------------------------
+
+#define LIB_SIMILARITY_JACCARD 0
+#define LIB_SIMILARITY_OVERLAP 1
+
+typedef struct {
+    size_t index;
+    double score;  // exact once computed, an upper bound before
+} lib_similar_t;
+
+/**
+ * True if `a` ranks before `b`: higher score first, then smaller index.
+ */
+static inline bool lib_similar_before(const lib_similar_t *a, const lib_similar_t *b) {
+    return a->score > b->score || (a->score == b->score && a->index < b->index);
+}
+
+static int lib_similar_compare(const void *a, const void *b) {
+    const lib_similar_t *x = (const lib_similar_t *) a;
+    const lib_similar_t *y = (const lib_similar_t *) b;
+    return lib_similar_before(x, y) ? -1 : (lib_similar_before(y, x) ? 1 : 0);
+}
+
+/**
+ * Similarity of two sets from their sizes and the size of their
+ * intersection, 0 when it is undefined (empty sets).
+ */
+static inline double lib_similarity(uint64_t a, uint64_t b, uint64_t both, int metric) {
+    uint64_t d = metric == LIB_SIMILARITY_JACCARD ? a + b - both : (a < b ? a : b);
+    return d == 0 ? 0 : (double) both / (double) d;
+}
+
+typedef struct {
+    const void *r;
+    uint64_t cardinality;
+    void *const *candidates;
+    const uint64_t *cardinalities;
+    int metric;
+    lib_similar_t *batch;
+    size_t size;
+    size_t tasks;
+    int bit;
+} lib_similar_run_t;
+
+static void lib_similar_task(void *ctx, size_t task) {
+    lib_similar_run_t *s = (lib_similar_run_t *) ctx;
+    size_t begin = task * s->size / s->tasks;
+    size_t end = (task + 1) * s->size / s->tasks;
+    for (size_t i = begin; i < end; i++) {
+        size_t c = s->batch[i].index;
+        uint64_t both = lib_bitmap_and_cardinality(s->r, s->candidates[c], s->bit);
+        s->batch[i].score = lib_similarity(s->cardinality, s->cardinalities[c], both, s->metric);
+    }
+}
+
+/**
+ * Finds the `k` candidates most similar to `r` and writes their indices and
+ * scores to `indices` and `scores`, best first, ties going to the smaller
+ * index. Returns how many were written, at most `k`, or SIZE_MAX on
+ * allocation failure.
+ *
+ * The exact cardinalities give every candidate an upper bound before any
+ * intersection: min / max of the two sizes for Jaccard, 1 (0 if a side is
+ * empty) for the overlap coefficient. Candidates are visited by decreasing
+ * bound in batches whose intersection sizes are computed on the pool, and the
+ * search stops as soon as the next bound cannot beat the k-th best score.
+ */
+static size_t lib_most_similar(const void *r, void *const *candidates, size_t number, size_t k, int metric,
+                               uint64_t *indices, double *scores, int bit) {
+    if (k == 0 || number == 0) {
+        return 0;
+    }
+    lib_similar_t *order = (lib_similar_t *) roaring_malloc(number * sizeof(lib_similar_t));
+    uint64_t *sizes = (uint64_t *) roaring_malloc(number * sizeof(uint64_t));
+    size_t batch_size = lib_pool_get_threads() * 16;
+    if (batch_size < 16) {
+        batch_size = 16;
+    }
+    lib_similar_t *batch = (lib_similar_t *) roaring_malloc(batch_size * sizeof(lib_similar_t));
+    lib_similar_t *best = (lib_similar_t *) roaring_malloc((k < number ? k : number) * sizeof(lib_similar_t));
+    if (order == NULL || sizes == NULL || batch == NULL || best == NULL) {
+        roaring_free(order);
+        roaring_free(sizes);
+        roaring_free(batch);
+        roaring_free(best);
+        return SIZE_MAX;
+    }
+    uint64_t size = lib_bitmap_cardinality(r, bit);
+    for (size_t i = 0; i < number; i++) {
+        sizes[i] = lib_bitmap_cardinality(candidates[i], bit);
+        uint64_t lo = size < sizes[i] ? size : sizes[i];
+        uint64_t hi = size < sizes[i] ? sizes[i] : size;
+        order[i].index = i;
+        order[i].score = metric == LIB_SIMILARITY_JACCARD ? lib_similarity(lo, hi, lo, metric) : (lo == 0 ? 0 : 1);
+    }
+    qsort(order, number, sizeof(lib_similar_t), lib_similar_compare);
+    size_t count = 0;  // `best` is sorted, best first
+    size_t limit = k < number ? k : number;
+    for (size_t next = 0; next < number;) {
+        size_t n = 0;
+        // a bound equal to the k-th score can still win on a smaller index
+        while (next < number && n < batch_size &&
+               (count < limit || !lib_similar_before(&best[count - 1], &order[next]))) {
+            batch[n++] = order[next++];
+        }
+        if (n == 0) {
+            break;
+        }
+        lib_similar_run_t s = {r, size, candidates, sizes, metric, batch, n, lib_pool_tasks(lib_pool_get_threads(), n),
+                               bit};
+        lib_pool_run(s.tasks, lib_similar_task, &s);
+        for (size_t i = 0; i < n; i++) {
+            if (count == limit && !lib_similar_before(&batch[i], &best[count - 1])) {
+                continue;
+            }
+            size_t j = count < limit ? count++ : count - 1;
+            while (j > 0 && lib_similar_before(&batch[i], &best[j - 1])) {
+                best[j] = best[j - 1];
+                j--;
+            }
+            best[j] = batch[i];
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        indices[i] = best[i].index;
+        scores[i] = best[i].score;
+    }
+    roaring_free(order);
+    roaring_free(sizes);
+    roaring_free(batch);
+    roaring_free(best);
+    return count;
+}
@@ -0,0 +1,415 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Native counterpart of benchmarks/run.php.
+ *
+ * Runs the same cases over the same data distributions, calling the bp32_ and
+ * bp64_ shims of the shared library directly, and prints a report with the
+ * same JSON layout. Joining both reports on (bit, distribution, op) gives the
+ * time spent in PHP and FFI marshalling as the difference of per_op_ns. Not
+ * part of the library, it is built and run by `php bin/build --bench`:
+ *
+ *   gcc -O2 -o bench bench.c library-linux-x86_64.so
+ *   ./bench [--size=100000] [--repeat=5] [--bit=32|64] [--distribution=name] [--filter=op]
+ *
+ * Time is read with clock_gettime(CLOCK_MONOTONIC), plus rdtsc on x64 where
+ * the report also carries cycles.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../shared/library.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <x86intrin.h>
+#define BENCH_RDTSC 1
+#endif
+
+typedef struct {
+    size_t size;
+    int repeat;
+    int bit;  // 0 for both
+    const char *distribution;
+    const char *filter;
+} bench_options_t;
+
+typedef struct {
+    int bit;
+    uint64_t *values;  // sorted
+    uint32_t *values32;
+    size_t count;
+    uint64_t *probes;
+    size_t probe_count;
+    void *a;
+    void *b;
+    char *bytes;
+    size_t bytes_size;
+    bool optimize;
+} bench_data_t;
+
+static uint64_t bench_state = 88172645463325252ULL;
+
+static uint64_t bench_rand(void) {
+    bench_state ^= bench_state << 13;
+    bench_state ^= bench_state >> 7;
+    bench_state ^= bench_state << 17;
+    return bench_state;
+}
+
+static uint64_t bench_between(uint64_t lo, uint64_t hi) {
+    return lo + bench_rand() % (hi - lo + 1);
+}
+
+static uint64_t bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static int bench_compare(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Sorts and removes duplicates, returns the new count.
+ */
+static size_t bench_unique(uint64_t *values, size_t n) {
+    qsort(values, n, sizeof(uint64_t), bench_compare);
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (k == 0 || values[k - 1] != values[i]) {
+            values[k++] = values[i];
+        }
+    }
+    return k;
+}
+
+/**
+ * Fills `values` with `size` distinct values following the distribution of
+ * the same name in benchmarks/run.php. Returns the count.
+ */
+static size_t bench_generate(const char *distribution, uint64_t *values, size_t size) {
+    size_t n = 0;
+    if (strcmp(distribution, "sparse") == 0) {
+        while (n < size) {
+            for (; n < size; n++) {
+                values[n] = bench_between(0, 0xFFFFFFFFULL);
+            }
+            n = bench_unique(values, n);
+        }
+    } else if (strcmp(distribution, "dense") == 0) {
+        while (n < size) {
+            for (; n < size; n++) {
+                values[n] = bench_between(0, 2 * size);
+            }
+            n = bench_unique(values, n);
+        }
+    } else if (strcmp(distribution, "clustered") == 0) {
+        uint64_t base = 0;
+        while (n < size) {
+            base += bench_between(1 << 16, 1 << 22);
+            for (int i = 0; i < 1000 && n < size; i++) {
+                values[n++] = base + bench_between(0, 4095);
+            }
+            n = bench_unique(values, n);
+        }
+    } else {
+        uint64_t start = 0;
+        while (n < size) {
+            start += bench_between(100, 20000);
+            size_t length = (size_t) bench_between(500, 5000);
+            for (size_t i = 0; i < length && n < size; i++) {
+                values[n++] = start + i;
+            }
+            start += length;
+        }
+    }
+    return n;
+}
+
+static void *bench_new_bitmap(const bench_data_t *d, const uint64_t *values, const uint32_t *values32, size_t n) {
+    void *r = d->bit == 32 ? bp32_create() : bp64_create();
+    for (size_t i = 0; i < n; i += 65536) {
+        size_t k = n - i < 65536 ? n - i : 65536;
+        if (d->bit == 32) {
+            bp32_add_many(r, k, values32 + i);
+        } else {
+            bp64_add_many(r, k, values + i);
+        }
+    }
+    if (d->optimize) {
+        d->bit == 32 ? bp32_run_optimize(r) : bp64_run_optimize(r);
+    }
+    return r;
+}
+
+static void bench_free(const bench_data_t *d, void *r) {
+    d->bit == 32 ? bp32_free(r) : bp64_free(r);
+}
+
+static volatile uint64_t bench_sink;
+
+static void case_add(bench_data_t *d) {
+    void *r = d->bit == 32 ? bp32_create() : bp64_create();
+    for (size_t i = 0; i < d->count; i++) {
+        if (d->bit == 32) {
+            bp32_add(r, d->values32[i]);
+        } else {
+            bp64_add(r, d->values[i]);
+        }
+    }
+    bench_free(d, r);
+}
+
+static void case_add_many(bench_data_t *d) {
+    bench_free(d, bench_new_bitmap(d, d->values, d->values32, d->count));
+}
+
+static void case_contains(bench_data_t *d) {
+    uint64_t hits = 0;
+    for (size_t i = 0; i < d->probe_count; i++) {
+        hits += d->bit == 32 ? bp32_contains(d->a, (uint32_t) d->probes[i]) : bp64_contains(d->a, d->probes[i]);
+    }
+    bench_sink = hits;
+}
+
+static void case_and(bench_data_t *d) {
+    bench_free(d, d->bit == 32 ? bp32_and(d->a, d->b) : bp64_and(d->a, d->b));
+}
+
+static void case_or(bench_data_t *d) {
+    bench_free(d, d->bit == 32 ? bp32_or(d->a, d->b) : bp64_or(d->a, d->b));
+}
+
+static void case_xor(bench_data_t *d) {
+    bench_free(d, d->bit == 32 ? bp32_xor(d->a, d->b) : bp64_xor(d->a, d->b));
+}
+
+static void case_andnot(bench_data_t *d) {
+    bench_free(d, d->bit == 32 ? bp32_andnot(d->a, d->b) : bp64_andnot(d->a, d->b));
+}
+
+static void case_and_cardinality(bench_data_t *d) {
+    bench_sink = d->bit == 32 ? bp32_and_cardinality(d->a, d->b) : bp64_and_cardinality(d->a, d->b);
+}
+
+static void case_or_cardinality(bench_data_t *d) {
+    bench_sink = d->bit == 32 ? bp32_or_cardinality(d->a, d->b) : bp64_or_cardinality(d->a, d->b);
+}
+
+static void case_get_cardinality(bench_data_t *d) {
+    bench_sink = d->bit == 32 ? bp32_get_cardinality(d->a) : bp64_get_cardinality(d->a);
+}
+
+static void case_to_bytes(bench_data_t *d) {
+    size_t size = d->bit == 32 ? bp32_portable_size_in_bytes(d->a) : bp64_portable_size_in_bytes(d->a);
+    char *buf = (char *) malloc(size);
+    bench_sink = d->bit == 32 ? bp32_portable_serialize(d->a, buf) : bp64_portable_serialize(d->a, buf);
+    free(buf);
+}
+
+static void case_from_bytes(bench_data_t *d) {
+    void *r = d->bit == 32 ? bp32_portable_deserialize(d->bytes, d->bytes_size)
+                           : bp64_portable_deserialize(d->bytes, d->bytes_size);
+    bench_free(d, r);
+}
+
+static void case_iterate(bench_data_t *d) {
+    uint64_t buf64[1000];
+    uint32_t buf32[1000];
+    uint64_t read = 0;
+    if (d->bit == 32) {
+        void *it = bp32_iterator_create(d->a);
+        while (read < d->count) {
+            read += bp32_iterator_read(it, buf32, 1000);
+        }
+        bp32_iterator_free(it);
+    } else {
+        void *it = bp64_iterator_create(d->a);
+        while (read < d->count) {
+            read += bp64_iterator_read(it, buf64, 1000);
+        }
+        bp64_iterator_free(it);
+    }
+    bench_sink = read;
+}
+
+static void case_to_array(bench_data_t *d) {
+    if (d->bit == 32) {
+        uint32_t *ans = (uint32_t *) malloc(d->count * sizeof(uint32_t) + 1);
+        bp32_to_uint_array(d->a, ans);
+        free(ans);
+    } else {
+        uint64_t *ans = (uint64_t *) malloc(d->count * sizeof(uint64_t) + 1);
+        bp64_to_uint_array(d->a, ans);
+        free(ans);
+    }
+}
+
+typedef struct {
+    const char *op;
+    void (*fn)(bench_data_t *d);
+    int per;  // 0: one operation, 1: one per value, 2: one per probe
+} bench_case_t;
+
+static const bench_case_t bench_cases[] = {
+    {"add", case_add, 1},
+    {"addMany", case_add_many, 1},
+    {"contains", case_contains, 2},
+    {"and", case_and, 0},
+    {"or", case_or, 0},
+    {"xOr", case_xor, 0},
+    {"andNot", case_andnot, 0},
+    {"andCardinality", case_and_cardinality, 0},
+    {"orCardinality", case_or_cardinality, 0},
+    {"getCardinality", case_get_cardinality, 0},
+    {"toBytes", case_to_bytes, 0},
+    {"fromBytes", case_from_bytes, 0},
+    {"iterate", case_iterate, 1},
+    {"toArray", case_to_array, 1},
+};
+
+static const char *bench_distributions[] = {"sparse", "dense", "clustered", "runs"};
+
+static void bench_prepare(bench_data_t *d, int bit, const char *distribution, size_t size) {
+    uint64_t offset = bit == 64 ? 1ULL << 40 : 0;
+    uint64_t *others = (uint64_t *) malloc(size * sizeof(uint64_t));
+    uint32_t *others32 = (uint32_t *) malloc(size * sizeof(uint32_t));
+    d->bit = bit;
+    d->optimize = strcmp(distribution, "runs") == 0;
+    d->values = (uint64_t *) malloc(size * sizeof(uint64_t));
+    d->values32 = (uint32_t *) malloc(size * sizeof(uint32_t));
+    d->count = bench_generate(distribution, d->values, size);
+    size_t other_count = bench_generate(distribution, others, size);
+    for (size_t i = 0; i < size; i++) {
+        d->values[i] += offset;
+        others[i] += offset;
+        d->values32[i] = (uint32_t) d->values[i];
+        others32[i] = (uint32_t) others[i];
+    }
+    d->a = bench_new_bitmap(d, d->values, d->values32, d->count);
+    d->b = bench_new_bitmap(d, others, others32, other_count);
+    d->probe_count = d->count < 10000 ? d->count : 10000;
+    d->probes = (uint64_t *) malloc((d->probe_count + 1) * sizeof(uint64_t));
+    for (size_t i = 0; i < d->probe_count; i++) {
+        d->probes[i] = d->values[bench_rand() % d->count];
+    }
+    d->bytes_size = bit == 32 ? bp32_portable_size_in_bytes(d->a) : bp64_portable_size_in_bytes(d->a);
+    d->bytes = (char *) malloc(d->bytes_size);
+    bit == 32 ? bp32_portable_serialize(d->a, d->bytes) : bp64_portable_serialize(d->a, d->bytes);
+    free(others);
+    free(others32);
+}
+
+static void bench_release(bench_data_t *d) {
+    bench_free(d, d->a);
+    bench_free(d, d->b);
+    free(d->values);
+    free(d->values32);
+    free(d->probes);
+    free(d->bytes);
+}
+
+static const char *bench_option(const char *arg, const char *name) {
+    size_t n = strlen(name);
+    return strncmp(arg, name, n) == 0 && arg[n] == '=' ? arg + n + 1 : NULL;
+}
+
+int main(int argc, char **argv) {
+    bench_options_t o = {100000, 5, 0, NULL, NULL};
+    for (int i = 1; i < argc; i++) {
+        const char *v;
+        if ((v = bench_option(argv[i], "--size")) != NULL) {
+            o.size = (size_t) strtoull(v, NULL, 10);
+        } else if ((v = bench_option(argv[i], "--repeat")) != NULL) {
+            o.repeat = atoi(v) < 1 ? 1 : atoi(v);
+        } else if ((v = bench_option(argv[i], "--bit")) != NULL) {
+            o.bit = atoi(v);
+        } else if ((v = bench_option(argv[i], "--distribution")) != NULL) {
+            o.distribution = v;
+        } else if ((v = bench_option(argv[i], "--filter")) != NULL) {
+            o.filter = v;
+        }
+    }
+    if (o.size == 0) {
+        o.size = 1;
+    }
+    uint64_t *times = (uint64_t *) malloc(o.repeat * sizeof(uint64_t));
+    uint64_t *cycles = (uint64_t *) malloc(o.repeat * sizeof(uint64_t));
+    printf("{\n    \"meta\": {\n        \"native\": true,\n        \"simd_compiled\": %d,\n        \"simd_active\": %d,\n"
+           "        \"size\": %zu,\n        \"repeat\": %d\n    },\n    \"results\": [",
+           bp_simd_compiled(), bp_simd_active(), o.size, o.repeat);
+    bool first = true;
+    for (int bit = 32; bit <= 64; bit += 32) {
+        if (o.bit != 0 && o.bit != bit) {
+            continue;
+        }
+        for (size_t k = 0; k < sizeof(bench_distributions) / sizeof(bench_distributions[0]); k++) {
+            const char *distribution = bench_distributions[k];
+            if (o.distribution != NULL && strcmp(o.distribution, distribution) != 0) {
+                continue;
+            }
+            bench_data_t d;
+            bench_prepare(&d, bit, distribution, o.size);
+            for (size_t c = 0; c < sizeof(bench_cases) / sizeof(bench_cases[0]); c++) {
+                const bench_case_t *bc = &bench_cases[c];
+                if (o.filter != NULL && strstr(bc->op, o.filter) == NULL) {
+                    continue;
+                }
+                bc->fn(&d);
+                for (int r = 0; r < o.repeat; r++) {
+#ifdef BENCH_RDTSC
+                    uint64_t tsc = __rdtsc();
+#endif
+                    uint64_t start = bench_now();
+                    bc->fn(&d);
+                    times[r] = bench_now() - start;
+#ifdef BENCH_RDTSC
+                    cycles[r] = __rdtsc() - tsc;
+#else
+                    cycles[r] = 0;
+#endif
+                }
+                qsort(times, o.repeat, sizeof(uint64_t), bench_compare);
+                qsort(cycles, o.repeat, sizeof(uint64_t), bench_compare);
+                size_t operations = bc->per == 1 ? d.count : bc->per == 2 ? d.probe_count : 1;
+                uint64_t median = times[o.repeat / 2];
+                printf("%s\n        {\"bit\": %d, \"distribution\": \"%s\", \"op\": \"%s\", \"operations\": %zu, "
+                       "\"median_ns\": %llu, \"min_ns\": %llu, \"per_op_ns\": %.3f, \"median_cycles\": %llu}",
+                       first ? "" : ",", bit, distribution, bc->op, operations, (unsigned long long) median,
+                       (unsigned long long) times[0], (double) median / (double) operations,
+                       (unsigned long long) cycles[o.repeat / 2]);
+                first = false;
+                fprintf(stderr, "%2d %-10s %-15s %14.1f ns/op\n", bit, distribution, bc->op,
+                        (double) median / (double) operations);
+            }
+            bench_release(&d);
+        }
+    }
+    printf("\n    ]\n}\n");
+    free(times);
+    free(cycles);
+    return 0;
+}
@@ -0,0 +1,319 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Bit-sliced index (O'Neil and Quass, "Improved Query Performance with
+ * Variant Indexes").
+ *
+ * An unsigned integer attribute of every column is stored as `depth` bitmaps,
+ * slice i holding the columns whose value has bit i set, plus an existence
+ * bitmap holding the columns that have a value. Comparisons walk the slices
+ * from the most significant one down keeping the columns still equal to the
+ * searched value, so they cost `depth` bitmap operations whatever the number
+ * of distinct values.
+ *
+ * `found`, when not NULL, restricts every query to its columns.
+ */
+
+#define LIB_BSI_EQ 0
+#define LIB_BSI_NE 1
+#define LIB_BSI_LT 2
+#define LIB_BSI_LE 3
+#define LIB_BSI_GT 4
+#define LIB_BSI_GE 5
+
+/**
+ * Returns the columns of `ebm` (and of `found` if not NULL), NULL on
+ * allocation failure.
+ */
+static void *lib_bsi_candidates(const void *ebm, const void *found, int bit) {
+    if (found == NULL) {
+        return lib_bitmap_copy(ebm, bit);
+    }
+    return lib_bitmap_and(ebm, found, bit);
+}
+
+/**
+ * Compares the value of every candidate column with `value` and returns the
+ * columns for which `op` holds. Returns NULL on allocation failure.
+ */
+static void *lib_bsi_compare(void *const *slices, size_t depth, const void *ebm, const void *found, int op,
+                             uint64_t value, int bit) {
+    void *eq = lib_bsi_candidates(ebm, found, bit);
+    void *lt = lib_bitmap_create(bit);
+    void *gt = lib_bitmap_create(bit);
+    if (eq == NULL || lt == NULL || gt == NULL) {
+        lib_bitmap_free(eq, bit);
+        lib_bitmap_free(lt, bit);
+        lib_bitmap_free(gt, bit);
+        return NULL;
+    }
+    if (depth < 64 && (value >> depth) != 0) {
+        // wider than every stored value
+        void *tmp = lt;
+        lt = eq;
+        eq = tmp;
+    } else {
+        bool want_lt = op == LIB_BSI_NE || op == LIB_BSI_LT || op == LIB_BSI_LE;
+        bool want_gt = op == LIB_BSI_NE || op == LIB_BSI_GT || op == LIB_BSI_GE;
+        for (size_t i = depth; i-- > 0 && !lib_bitmap_is_empty(eq, bit);) {
+            if ((value >> i) & 1) {
+                if (want_lt) {
+                    void *drop = lib_bitmap_andnot(eq, slices[i], bit);
+                    if (drop == NULL) {
+                        goto fail;
+                    }
+                    lib_bitmap_or_inplace(lt, drop, bit);
+                    lib_bitmap_free(drop, bit);
+                }
+                lib_bitmap_and_inplace(eq, slices[i], bit);
+            } else {
+                if (want_gt) {
+                    void *drop = lib_bitmap_and(eq, slices[i], bit);
+                    if (drop == NULL) {
+                        goto fail;
+                    }
+                    lib_bitmap_or_inplace(gt, drop, bit);
+                    lib_bitmap_free(drop, bit);
+                }
+                lib_bitmap_andnot_inplace(eq, slices[i], bit);
+            }
+        }
+    }
+    void *ret;
+    switch (op) {
+        case LIB_BSI_EQ:
+            ret = eq;
+            eq = NULL;
+            break;
+        case LIB_BSI_NE:
+            lib_bitmap_or_inplace(lt, gt, bit);
+            ret = lt;
+            lt = NULL;
+            break;
+        case LIB_BSI_LT:
+            ret = lt;
+            lt = NULL;
+            break;
+        case LIB_BSI_LE:
+            lib_bitmap_or_inplace(lt, eq, bit);
+            ret = lt;
+            lt = NULL;
+            break;
+        case LIB_BSI_GT:
+            ret = gt;
+            gt = NULL;
+            break;
+        default:
+            lib_bitmap_or_inplace(gt, eq, bit);
+            ret = gt;
+            gt = NULL;
+            break;
+    }
+    lib_bitmap_free(eq, bit);
+    lib_bitmap_free(lt, bit);
+    lib_bitmap_free(gt, bit);
+    return ret;
+fail:
+    lib_bitmap_free(eq, bit);
+    lib_bitmap_free(lt, bit);
+    lib_bitmap_free(gt, bit);
+    return NULL;
+}
+
+/**
+ * Returns the candidate columns whose value is in [min, max], NULL on
+ * allocation failure.
+ */
+static void *lib_bsi_between(void *const *slices, size_t depth, const void *ebm, const void *found, uint64_t min,
+                             uint64_t max, int bit) {
+    if (min > max) {
+        return lib_bitmap_create(bit);
+    }
+    void *ge = lib_bsi_compare(slices, depth, ebm, found, LIB_BSI_GE, min, bit);
+    if (ge == NULL || lib_bitmap_is_empty(ge, bit)) {
+        return ge;
+    }
+    void *ret = lib_bsi_compare(slices, depth, ebm, ge, LIB_BSI_LE, max, bit);
+    lib_bitmap_free(ge, bit);
+    return ret;
+}
+
+/**
+ * Sums the values of the candidate columns into `sum` and counts them into
+ * `count`, without materializing anything but the candidates. Returns false on
+ * allocation failure or if the sum does not fit in an int64_t.
+ */
+static bool lib_bsi_sum(void *const *slices, size_t depth, const void *ebm, const void *found, int64_t *sum,
+                        uint64_t *count, int bit) {
+    const void *candidates = found == NULL ? ebm : NULL;
+    void *owned = NULL;
+    if (candidates == NULL) {
+        owned = lib_bitmap_and(ebm, found, bit);
+        if (owned == NULL) {
+            return false;
+        }
+        candidates = owned;
+    }
+    *count = lib_bitmap_cardinality(candidates, bit);
+    int64_t total = 0;
+    bool ok = true;
+    for (size_t i = 0; i < depth && ok; i++) {
+        uint64_t n = lib_bitmap_and_cardinality(slices[i], candidates, bit);
+        if (n == 0) {
+            continue;
+        }
+        int64_t part;
+        ok = i < 63 && n <= INT64_MAX && !__builtin_mul_overflow((int64_t) n, (int64_t) 1 << i, &part) &&
+             !__builtin_add_overflow(total, part, &total);
+    }
+    lib_bitmap_free(owned, bit);
+    *sum = total;
+    return ok;
+}
+
+/**
+ * Returns the `k` candidate columns with the largest values, or all of them if
+ * there are fewer. Among columns with equal values the smallest columns win.
+ * Returns NULL on allocation failure.
+ */
+static void *lib_bsi_top_k(void *const *slices, size_t depth, const void *ebm, const void *found, uint64_t k,
+                           int bit) {
+    void *g = lib_bitmap_create(bit);  // columns known to be in the top k
+    void *e = lib_bsi_candidates(ebm, found, bit);  // columns still tied
+    if (g == NULL || e == NULL) {
+        lib_bitmap_free(g, bit);
+        lib_bitmap_free(e, bit);
+        return NULL;
+    }
+    uint64_t g_card = 0;
+    for (size_t i = depth; i-- > 0 && g_card < k && !lib_bitmap_is_empty(e, bit);) {
+        uint64_t high = lib_bitmap_and_cardinality(e, slices[i], bit);
+        if (g_card + high > k) {
+            lib_bitmap_and_inplace(e, slices[i], bit);
+        } else {
+            void *x = lib_bitmap_and(e, slices[i], bit);
+            if (x == NULL) {
+                lib_bitmap_free(g, bit);
+                lib_bitmap_free(e, bit);
+                return NULL;
+            }
+            lib_bitmap_or_inplace(g, x, bit);
+            lib_bitmap_free(x, bit);
+            g_card += high;
+            lib_bitmap_andnot_inplace(e, slices[i], bit);
+        }
+    }
+    lib_bitmap_keep_first(e, k - g_card, bit);
+    lib_bitmap_or_inplace(g, e, bit);
+    lib_bitmap_free(e, bit);
+    return g;
+}
+
+/**
+ * Returns true if `column` has a value and stores it into `value`.
+ */
+static bool lib_bsi_get(void *const *slices, size_t depth, const void *ebm, uint64_t column, uint64_t *value,
+                        int bit) {
+    if (!lib_bitmap_contains(ebm, column, bit)) {
+        return false;
+    }
+    uint64_t v = 0;
+    for (size_t i = 0; i < depth; i++) {
+        if (lib_bitmap_contains(slices[i], column, bit)) {
+            v |= (uint64_t) 1 << i;
+        }
+    }
+    *value = v;
+    return true;
+}
+
+typedef struct {
+    uint64_t column;
+    uint64_t value;
+    size_t order;
+} lib_bsi_pair_t;
+
+static int lib_bsi_pair_compare(const void *a, const void *b) {
+    const lib_bsi_pair_t *x = (const lib_bsi_pair_t *) a;
+    const lib_bsi_pair_t *y = (const lib_bsi_pair_t *) b;
+    if (x->column != y->column) {
+        return x->column < y->column ? -1 : 1;
+    }
+    return x->order < y->order ? -1 : (x->order > y->order ? 1 : 0);
+}
+
+/**
+ * Sets the value of `n` columns, when a column is given several times the
+ * last value wins. Every value must fit in `depth` bits. Slices are updated
+ * with one sorted bulk add and one bulk remove each. Returns false, without
+ * changing anything, if a value or a column does not fit or on allocation
+ * failure.
+ */
+static bool lib_bsi_set_many(void *const *slices, size_t depth, void *ebm, const uint64_t *columns,
+                             const uint64_t *values, size_t n, int bit) {
+    if (n == 0) {
+        return true;
+    }
+    lib_bsi_pair_t *pairs = (lib_bsi_pair_t *) roaring_malloc(n * sizeof(lib_bsi_pair_t));
+    uint64_t *set = (uint64_t *) roaring_malloc(n * sizeof(uint64_t));
+    uint64_t *clear = (uint64_t *) roaring_malloc(n * sizeof(uint64_t));
+    bool *existed = (bool *) roaring_malloc(n * sizeof(bool));
+    bool ok = pairs != NULL && set != NULL && clear != NULL && existed != NULL;
+    for (size_t i = 0; ok && i < n; i++) {
+        ok = (depth >= 64 || (values[i] >> depth) == 0) && (bit == LIB_BIT_64 || columns[i] <= UINT32_MAX);
+        pairs[i].column = columns[i];
+        pairs[i].value = values[i];
+        pairs[i].order = i;
+    }
+    if (!ok) {
+        roaring_free(pairs);
+        roaring_free(set);
+        roaring_free(clear);
+        roaring_free(existed);
+        return false;
+    }
+    qsort(pairs, n, sizeof(lib_bsi_pair_t), lib_bsi_pair_compare);
+    size_t m = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i + 1 < n && pairs[i + 1].column == pairs[i].column) {
+            continue;
+        }
+        pairs[m] = pairs[i];
+        existed[m] = lib_bitmap_contains(ebm, pairs[m].column, bit);
+        set[m] = pairs[m].column;
+        m++;
+    }
+    lib_bitmap_add_many(ebm, m, set, bit);
+    for (size_t s = 0; s < depth; s++) {
+        size_t n_set = 0;
+        size_t n_clear = 0;
+        for (size_t i = 0; i < m; i++) {
+            if ((pairs[i].value >> s) & 1) {
+                set[n_set++] = pairs[i].column;
+            } else if (existed[i]) {
+                clear[n_clear++] = pairs[i].column;
+            }
+        }
+        lib_bitmap_add_many(slices[s], n_set, set, bit);
+        lib_bitmap_remove_many(slices[s], n_clear, clear, bit);
+    }
+    roaring_free(pairs);
+    roaring_free(set);
+    roaring_free(clear);
+    roaring_free(existed);
+    return true;
+}
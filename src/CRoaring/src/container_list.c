@@ -0,0 +1,267 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Bit width independent access to the containers of a bitmap.
+ *
+ * A 32-bit bitmap keeps its containers in a sorted array keyed by the high 16
+ * bits, a 64-bit bitmap keeps them in an ART keyed by the high 48 bits. The
+ * algorithms of this library work on a flat list of (key, container, typecode)
+ * sorted by key instead, where `key` is `value >> 16` for both widths, and
+ * turn the result back into a bitmap of the requested width.
+ */
+
+#define LIB_BIT_32 32
+#define LIB_BIT_64 64
+
+typedef struct {
+    uint64_t key;
+    container_t *container;
+    uint8_t typecode;
+} lib_entry_t;
+
+typedef struct {
+    lib_entry_t *entries;
+    size_t size;
+    size_t capacity;
+} lib_list_t;
+
+static bool lib_list_reserve(lib_list_t *list, size_t capacity) {
+    if (capacity <= list->capacity) {
+        return true;
+    }
+    if (capacity < 2 * list->capacity) {
+        capacity = 2 * list->capacity;
+    }
+    lib_entry_t *entries = (lib_entry_t *) roaring_realloc(list->entries, capacity * sizeof(lib_entry_t));
+    if (entries == NULL) {
+        return false;
+    }
+    list->entries = entries;
+    list->capacity = capacity;
+    return true;
+}
+
+/**
+ * Frees the entry array, the containers are left alone.
+ */
+static void lib_list_free(lib_list_t *list) {
+    roaring_free(list->entries);
+    list->entries = NULL;
+    list->size = 0;
+    list->capacity = 0;
+}
+
+/**
+ * Frees the containers owned by the list and the entry array.
+ */
+static void lib_list_free_containers(lib_list_t *list) {
+    for (size_t i = 0; i < list->size; i++) {
+        container_free(list->entries[i].container, list->entries[i].typecode);
+    }
+    lib_list_free(list);
+}
+
+/**
+ * Fills `list` with the containers of `r`, the containers stay owned by `r`.
+ * Shared (copy on write) containers are unwrapped, so entries can be handed
+ * to any read-only container function. Returns false on allocation failure.
+ */
+static bool lib_list_view(lib_list_t *list, const void *r, int bit) {
+    list->size = 0;
+    if (bit == LIB_BIT_32) {
+        const roaring_array_t *ra = &((const roaring_bitmap_t *) r)->high_low_container;
+        if (!lib_list_reserve(list, (size_t) ra->size)) {
+            return false;
+        }
+        for (int32_t i = 0; i < ra->size; i++) {
+            uint8_t typecode = ra->typecodes[i];
+            const container_t *c = container_unwrap_shared(ra->containers[i], &typecode);
+            list->entries[i].key = ra->keys[i];
+            list->entries[i].container = (container_t *) c;
+            list->entries[i].typecode = typecode;
+        }
+        list->size = (size_t) ra->size;
+        return true;
+    }
+    const roaring64_bitmap_t *r64 = (const roaring64_bitmap_t *) r;
+    art_iterator_t it = art_init_iterator((art_t *) &r64->art, true);
+    while (it.value != NULL) {
+        if (!lib_list_reserve(list, list->size + 1)) {
+            return false;
+        }
+        leaf_t leaf = (leaf_t) *it.value;
+        uint8_t typecode = get_typecode(leaf);
+        const container_t *c = container_unwrap_shared(get_container(r64, leaf), &typecode);
+        lib_entry_t *e = &list->entries[list->size++];
+        e->key = combine_key(it.key, 0) >> 16;
+        e->container = (container_t *) c;
+        e->typecode = typecode;
+        art_iterator_next(&it);
+    }
+    return true;
+}
+
+/**
+ * Appends a container owned by the list. Empty containers are freed instead
+ * of being appended. Keys must be pushed in increasing order. On allocation
+ * failure the container is freed and false is returned.
+ */
+static bool lib_list_push(lib_list_t *list, uint64_t key, container_t *c, uint8_t typecode) {
+    if (!container_nonzero_cardinality(c, typecode)) {
+        container_free(c, typecode);
+        return true;
+    }
+    if (!lib_list_reserve(list, list->size + 1)) {
+        container_free(c, typecode);
+        return false;
+    }
+    lib_entry_t *e = &list->entries[list->size++];
+    e->key = key;
+    e->container = c;
+    e->typecode = typecode;
+    return true;
+}
+
+/**
+ * Moves all entries of `src` to the end of `dst`, `src` is left empty.
+ */
+static bool lib_list_append(lib_list_t *dst, lib_list_t *src) {
+    if (!lib_list_reserve(dst, dst->size + src->size)) {
+        return false;
+    }
+    if (src->size > 0) {
+        memcpy(dst->entries + dst->size, src->entries, src->size * sizeof(lib_entry_t));
+    }
+    dst->size += src->size;
+    lib_list_free(src);
+    return true;
+}
+
+/**
+ * Index of the first entry whose key is >= `key`.
+ */
+static size_t lib_list_lower_bound(const lib_list_t *list, uint64_t key) {
+    size_t lo = 0;
+    size_t hi = list->size;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (list->entries[mid].key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * Index of the first entry at or after `from` whose key is >= `key`, found by
+ * galloping from `from`: cheap when the key is close, logarithmic otherwise.
+ */
+static size_t lib_list_gallop(const lib_list_t *list, size_t from, uint64_t key) {
+    size_t lo = from;
+    size_t hi = from;
+    size_t step = 1;
+    while (hi < list->size && list->entries[hi].key < key) {
+        lo = hi + 1;
+        hi = step < list->size - hi ? hi + step : list->size;
+        step <<= 1;
+    }
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (list->entries[mid].key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * Turns a list of owned containers into a new bitmap of the given width. The
+ * containers move into the bitmap and the list is emptied. Returns NULL on
+ * allocation failure, in that case the containers are freed.
+ */
+static void *lib_list_to_bitmap(lib_list_t *list, int bit) {
+    if (bit == LIB_BIT_32) {
+        roaring_bitmap_t *r = roaring_bitmap_create_with_capacity((uint32_t) list->size);
+        if (r == NULL) {
+            lib_list_free_containers(list);
+            return NULL;
+        }
+        for (size_t i = 0; i < list->size; i++) {
+            lib_entry_t *e = &list->entries[i];
+            ra_append(&r->high_low_container, (uint16_t) e->key, e->container, e->typecode);
+        }
+        lib_list_free(list);
+        return r;
+    }
+    roaring64_bitmap_t *r = roaring64_bitmap_create();
+    if (r == NULL) {
+        lib_list_free_containers(list);
+        return NULL;
+    }
+    for (size_t i = 0; i < list->size; i++) {
+        lib_entry_t *e = &list->entries[i];
+        uint8_t high48[ART_KEY_BYTES];
+        split_key(e->key << 16, high48);
+        leaf_t leaf = add_container(r, e->container, e->typecode);
+        art_insert(&r->art, high48, (art_val_t) leaf);
+    }
+    lib_list_free(list);
+    return r;
+}
+
+static int lib_key_compare(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Splits the key space covered by `lists` into `tasks` ranges holding roughly
+ * the same number of containers. `bounds` receives `tasks + 1` keys, range `t`
+ * is [bounds[t], bounds[t + 1]). Some ranges may be empty.
+ */
+static bool lib_key_bounds(const lib_list_t *lists, size_t number, size_t tasks, uint64_t *bounds) {
+    bounds[0] = 0;
+    bounds[tasks] = UINT64_MAX;
+    if (tasks == 1) {
+        return true;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < number; i++) {
+        total += lists[i].size;
+    }
+    uint64_t *keys = (uint64_t *) roaring_malloc((total == 0 ? 1 : total) * sizeof(uint64_t));
+    if (keys == NULL) {
+        return false;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < number; i++) {
+        for (size_t j = 0; j < lists[i].size; j++) {
+            keys[n++] = lists[i].entries[j].key;
+        }
+    }
+    qsort(keys, n, sizeof(uint64_t), lib_key_compare);
+    for (size_t t = 1; t < tasks; t++) {
+        bounds[t] = n == 0 ? UINT64_MAX : keys[t * n / tasks];
+    }
+    roaring_free(keys);
+    return true;
+}
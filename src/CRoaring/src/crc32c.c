@@ -0,0 +1,95 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * CRC32C (Castagnoli, the polynomial of iSCSI, ext4 and SSE 4.2).
+ *
+ * The SSE 4.2 crc32 instruction is used on x64 when the cpu has it, the
+ * ARMv8 crc32c instructions on arm64 when the compiler targets them, and a
+ * table driven version otherwise. All of them give the same result.
+ */
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define LIB_CRC32C_X64 1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define LIB_CRC32C_ARM64 1
+#endif
+
+static uint32_t lib_crc32c_table[256];
+static pthread_once_t lib_crc32c_once = PTHREAD_ONCE_INIT;
+
+static void lib_crc32c_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+        }
+        lib_crc32c_table[i] = crc;
+    }
+}
+
+static uint32_t lib_crc32c_soft(uint32_t crc, const uint8_t *p, size_t n) {
+    pthread_once(&lib_crc32c_once, lib_crc32c_init);
+    while (n-- > 0) {
+        crc = lib_crc32c_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(LIB_CRC32C_X64)
+__attribute__((target("sse4.2"))) static uint32_t lib_crc32c_hw(uint32_t crc, const uint8_t *p, size_t n) {
+    uint64_t c = crc;
+    for (; n >= 8; n -= 8, p += 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        c = _mm_crc32_u64(c, v);
+    }
+    crc = (uint32_t) c;
+    for (; n > 0; n--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+#elif defined(LIB_CRC32C_ARM64)
+static uint32_t lib_crc32c_hw(uint32_t crc, const uint8_t *p, size_t n) {
+    for (; n >= 8; n -= 8, p += 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        crc = __crc32cd(crc, v);
+    }
+    for (; n > 0; n--) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return crc;
+}
+#endif
+
+/**
+ * Returns the CRC32C of `n` bytes at `buf`.
+ */
+static uint32_t lib_crc32c(const void *buf, size_t n) {
+    const uint8_t *p = (const uint8_t *) buf;
+#if defined(LIB_CRC32C_X64)
+    if (__builtin_cpu_supports("sse4.2")) {
+        return ~lib_crc32c_hw(~0u, p, n);
+    }
+#elif defined(LIB_CRC32C_ARM64)
+    return ~lib_crc32c_hw(~0u, p, n);
+#endif
+    return ~lib_crc32c_soft(~0u, p, n);
+}
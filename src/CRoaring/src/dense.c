@@ -0,0 +1,275 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Conversion between bitmaps and raw dense bitsets.
+ *
+ * A dense bitset is a byte string where bit i stands for value offset + i.
+ * Bits are numbered from the least significant bit of each byte, which is
+ * the layout of `bitset_t` words on little-endian machines, or from the most
+ * significant bit, which is the layout of Redis SETBIT / GETRANGE.
+ *
+ * Every 8 KB of the string (65536 bits) is one container. On import each
+ * chunk is loaded into a word buffer, counted, and becomes an array
+ * container when sparse and a bitset container otherwise, then a run
+ * container when that is smaller. Chunks are independent, so they are
+ * decoded on the pool. On export every container writes its values straight
+ * into the zeroed output: arrays bit by bit, runs as byte ranges and bitsets
+ * word by word.
+ */
+
+/**
+ * `b` with its bits in reverse order.
+ */
+static inline uint8_t lib_dense_reverse(uint8_t b) {
+    b = (uint8_t) ((b & 0xF0) >> 4 | (b & 0x0F) << 4);
+    b = (uint8_t) ((b & 0xCC) >> 2 | (b & 0x33) << 2);
+    return (uint8_t) ((b & 0xAA) >> 1 | (b & 0x55) << 1);
+}
+
+/**
+ * Byte `i` of the bitset with its bits numbered from the least significant
+ * one, 0 outside of [0, n).
+ */
+static inline uint64_t lib_dense_byte(const uint8_t *bits, size_t n, int64_t i, bool msb) {
+    if (i < 0 || (uint64_t) i >= n) {
+        return 0;
+    }
+    return msb ? lib_dense_reverse(bits[i]) : bits[i];
+}
+
+/**
+ * The 64 bits starting at bit `pos`, which may be negative or past the end.
+ */
+static inline uint64_t lib_dense_load(const uint8_t *bits, size_t n, int64_t pos, bool msb) {
+    int64_t q = pos >= 0 ? pos / 8 : -((7 - pos) / 8);
+    unsigned shift = (unsigned) (pos - q * 8);
+    uint64_t word = 0;
+    if (!msb && shift == 0 && q >= 0 && (uint64_t) q + 8 <= n) {
+        for (int k = 0; k < 8; k++) {
+            word |= (uint64_t) bits[q + k] << (8 * k);
+        }
+        return word;
+    }
+    for (int k = 0; k < 8; k++) {
+        word |= lib_dense_byte(bits, n, q + k, msb) << (8 * k);
+    }
+    if (shift != 0) {
+        word = (word >> shift) | (lib_dense_byte(bits, n, q + 8, msb) << (64 - shift));
+    }
+    return word;
+}
+
+typedef struct {
+    const uint8_t *bits;
+    size_t n;
+    int64_t first;  // bit of the first value of chunk 0, <= 0
+    size_t chunks;
+    size_t tasks;
+    bool msb;
+    container_t **containers;  // by chunk, NULL when empty
+    uint8_t *typecodes;
+    atomic_bool failed;
+} lib_dense_import_t;
+
+/**
+ * Container of the 65536 bits starting at `pos`, NULL when they are all 0.
+ */
+static container_t *lib_dense_chunk(const lib_dense_import_t *d, int64_t pos, uint8_t *type, bool *failed) {
+    uint64_t words[BITSET_CONTAINER_SIZE_IN_WORDS];
+    int32_t cardinality = 0;
+    for (size_t w = 0; w < BITSET_CONTAINER_SIZE_IN_WORDS; w++) {
+        words[w] = lib_dense_load(d->bits, d->n, pos + 64 * (int64_t) w, d->msb);
+        cardinality += roaring_hamming(words[w]);
+    }
+    if (cardinality == 0) {
+        return NULL;
+    }
+    container_t *c;
+    if (cardinality <= DEFAULT_MAX_SIZE) {
+        array_container_t *ac = array_container_create_given_capacity(cardinality);
+        if (ac != NULL) {
+            bitset_extract_setbits_uint16(words, BITSET_CONTAINER_SIZE_IN_WORDS, ac->array, 0);
+            ac->cardinality = cardinality;
+        }
+        c = ac;
+        *type = ARRAY_CONTAINER_TYPE;
+    } else {
+        bitset_container_t *bc = bitset_container_create();
+        if (bc != NULL) {
+            memcpy(bc->words, words, sizeof(words));
+            bc->cardinality = cardinality;
+        }
+        c = bc;
+        *type = BITSET_CONTAINER_TYPE;
+    }
+    if (c == NULL) {
+        *failed = true;
+        return NULL;
+    }
+    return convert_run_optimize(c, *type, type);
+}
+
+static void lib_dense_import_task(void *ctx, size_t task) {
+    lib_dense_import_t *d = (lib_dense_import_t *) ctx;
+    size_t begin = task * d->chunks / d->tasks;
+    size_t end = (task + 1) * d->chunks / d->tasks;
+    bool failed = false;
+    for (size_t j = begin; j < end && !failed; j++) {
+        d->containers[j] = lib_dense_chunk(d, d->first + (int64_t) j * 65536, &d->typecodes[j], &failed);
+    }
+    if (failed) {
+        atomic_store(&d->failed, true);
+    }
+}
+
+/**
+ * Builds a bitmap from the `n` bytes of a dense bitset whose bit i is value
+ * `offset` + i. Returns NULL on allocation failure, or if a set bit is a
+ * value that does not fit in the width.
+ */
+static void *lib_dense_import(const char *bits, size_t n, uint64_t offset, bool msb, int bit) {
+    if (n > (SIZE_MAX - 0xFFFF) / 8) {
+        return NULL;
+    }
+    uint64_t max_key = bit == LIB_BIT_32 ? 0xFFFF : (UINT64_C(1) << 48) - 1;
+    uint64_t first_key = offset >> 16;
+    uint64_t low = offset & 0xFFFF;
+    lib_dense_import_t d = {(const uint8_t *) bits, n, -(int64_t) low, 0, 0, msb, NULL, NULL, false};
+    // only the chunks of keys that fit in the width are decoded, a bit past them fails below
+    d.chunks = (size_t) ((low + (uint64_t) n * 8 + 0xFFFF) >> 16);
+    if (first_key > max_key) {
+        d.chunks = 0;
+    } else if (d.chunks > max_key - first_key + 1) {
+        d.chunks = (size_t) (max_key - first_key + 1);
+    }
+    lib_list_t list = {0};
+    void *result = NULL;
+    d.containers = (container_t **) roaring_calloc(d.chunks == 0 ? 1 : d.chunks, sizeof(container_t *));
+    d.typecodes = (uint8_t *) roaring_malloc(d.chunks == 0 ? 1 : d.chunks);
+    if (d.containers == NULL || d.typecodes == NULL) {
+        goto out;
+    }
+    d.tasks = lib_pool_tasks(lib_pool_get_threads(), d.chunks);
+    if (d.chunks > 0) {
+        lib_pool_run(d.tasks, lib_dense_import_task, &d);
+    }
+    // bits past the last key of the width
+    uint64_t covered = d.chunks == 0 ? 0 : (uint64_t) d.chunks * 65536 - low;
+    for (uint64_t i = covered / 8; !atomic_load(&d.failed) && i < n; i++) {
+        uint64_t byte = lib_dense_byte(d.bits, n, (int64_t) i, msb);
+        if ((i == covered / 8 ? byte >> (covered % 8) : byte) != 0) {
+            atomic_store(&d.failed, true);
+        }
+    }
+    bool ok = !atomic_load(&d.failed) && lib_list_reserve(&list, d.chunks);
+    for (size_t j = 0; j < d.chunks; j++) {
+        if (d.containers[j] == NULL) {
+            continue;
+        }
+        if (ok) {
+            ok = lib_list_push(&list, first_key + j, d.containers[j], d.typecodes[j]);
+        } else {
+            container_free(d.containers[j], d.typecodes[j]);
+        }
+    }
+    if (ok) {
+        result = lib_list_to_bitmap(&list, bit);
+    } else {
+        lib_list_free_containers(&list);
+    }
+out:
+    roaring_free(d.containers);
+    roaring_free(d.typecodes);
+    return result;
+}
+
+/**
+ * Number of bytes of the dense bitset of `r`: up to its maximum, 0 when it
+ * is empty. Returns SIZE_MAX if that does not fit in a size_t.
+ */
+static size_t lib_dense_size(const void *r, int bit) {
+    if (lib_bitmap_is_empty(r, bit)) {
+        return 0;
+    }
+    uint64_t max = bit == LIB_BIT_32 ? roaring_bitmap_maximum((const roaring_bitmap_t *) r)
+                                     : roaring64_bitmap_maximum((const roaring64_bitmap_t *) r);
+    if (max / 8 >= SIZE_MAX) {
+        return SIZE_MAX;
+    }
+    return (size_t) (max / 8 + 1);
+}
+
+/**
+ * Sets the bits [lo, hi] of `buf`.
+ */
+static void lib_dense_set_range(uint8_t *buf, uint64_t lo, uint64_t hi, bool msb) {
+    uint64_t first = lo / 8;
+    uint64_t last = hi / 8;
+    uint8_t head = (uint8_t) (0xFF << (lo % 8));
+    uint8_t tail = (uint8_t) (0xFF >> (7 - hi % 8));
+    if (first == last) {
+        head &= tail;
+    }
+    buf[first] |= msb ? lib_dense_reverse(head) : head;
+    if (first == last) {
+        return;
+    }
+    if (last > first + 1) {
+        memset(buf + first + 1, 0xFF, (size_t) (last - first - 1));
+    }
+    buf[last] |= msb ? lib_dense_reverse(tail) : tail;
+}
+
+/**
+ * Writes the dense bitset of `r`, `lib_dense_size()` bytes, to `buf`.
+ * Returns false on allocation failure, `buf` is then left zeroed.
+ */
+static bool lib_dense_export(const void *r, char *out, size_t size, bool msb, int bit) {
+    uint8_t *buf = (uint8_t *) out;
+    memset(buf, 0, size);
+    lib_list_t list = {0};
+    if (!lib_list_view(&list, r, bit)) {
+        lib_list_free(&list);
+        return false;
+    }
+    for (size_t i = 0; i < list.size; i++) {
+        const lib_entry_t *e = &list.entries[i];
+        uint64_t base = e->key << 16;
+        if (e->typecode == ARRAY_CONTAINER_TYPE) {
+            const array_container_t *ac = const_CAST_array(e->container);
+            for (int32_t k = 0; k < ac->cardinality; k++) {
+                uint64_t v = base + ac->array[k];
+                buf[v / 8] |= (uint8_t) (msb ? 0x80 >> (v % 8) : 1 << (v % 8));
+            }
+        } else if (e->typecode == RUN_CONTAINER_TYPE) {
+            const run_container_t *rc = const_CAST_run(e->container);
+            for (int32_t k = 0; k < rc->n_runs; k++) {
+                uint64_t lo = base + rc->runs[k].value;
+                lib_dense_set_range(buf, lo, lo + rc->runs[k].length, msb);
+            }
+        } else {
+            const bitset_container_t *bc = const_CAST_bitset(e->container);
+            uint64_t end = size - base / 8 < 8192 ? size - base / 8 : 8192;
+            for (uint64_t b = 0; b < end; b++) {
+                uint8_t byte = (uint8_t) (bc->words[b / 8] >> (8 * (b % 8)));
+                buf[base / 8 + b] = msb ? lib_dense_reverse(byte) : byte;
+            }
+        }
+    }
+    lib_list_free(&list);
+    return true;
+}
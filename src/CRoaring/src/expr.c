@@ -0,0 +1,263 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Evaluation of boolean expressions over bitmaps.
+ *
+ * The expression is a plan of int32 in prefix order:
+ *
+ *   operand: LIB_EXPR_OPERAND, index into the operands
+ *   and:     LIB_EXPR_AND, n, n children
+ *   or:      LIB_EXPR_OR, n, n children
+ *   xor:     LIB_EXPR_XOR, n, n children
+ *   not:     LIB_EXPR_NOT, child (only as a child of an and with at least
+ *            one child that is not a not, there is no universe to complement)
+ *
+ * Operands are never copied when they do not need to be: a node evaluates to
+ * either a borrowed operand or a bitmap it owns. An and starts from the
+ * intersection of its two smallest operands, folds the other children into
+ * that buffer in place, subtracts the negated children last and stops as soon
+ * as the buffer is empty, without evaluating the remaining children. Unions
+ * and symmetric differences skip empty children and merge the rest with one
+ * key-partitioned `lib_or_many()` / `lib_xor_many()`.
+ */
+
+#define LIB_EXPR_OPERAND 0
+#define LIB_EXPR_AND 1
+#define LIB_EXPR_OR 2
+#define LIB_EXPR_XOR 3
+#define LIB_EXPR_NOT 4
+#define LIB_EXPR_MAX_DEPTH 1000
+
+typedef struct {
+    const int32_t *plan;
+    size_t size;
+    void *const *operands;
+    size_t number;
+    int bit;
+} lib_expr_t;
+
+typedef struct {
+    void *r;  // NULL on failure
+    bool owned;
+} lib_expr_value_t;
+
+/**
+ * Returns the position after the node at `pos`, or SIZE_MAX if the plan is
+ * malformed.
+ */
+static size_t lib_expr_skip(const lib_expr_t *e, size_t pos, int depth) {
+    if (depth > LIB_EXPR_MAX_DEPTH || pos + 1 >= e->size) {
+        return SIZE_MAX;
+    }
+    switch (e->plan[pos]) {
+        case LIB_EXPR_OPERAND:
+            return e->plan[pos + 1] >= 0 && (size_t) e->plan[pos + 1] < e->number ? pos + 2 : SIZE_MAX;
+        case LIB_EXPR_NOT:
+            return lib_expr_skip(e, pos + 1, depth + 1);
+        case LIB_EXPR_AND:
+        case LIB_EXPR_OR:
+        case LIB_EXPR_XOR: {
+            if (e->plan[pos + 1] <= 0) {
+                return SIZE_MAX;
+            }
+            size_t next = pos + 2;
+            for (int32_t i = 0; i < e->plan[pos + 1] && next != SIZE_MAX; i++) {
+                next = lib_expr_skip(e, next, depth + 1);
+            }
+            return next;
+        }
+        default:
+            return SIZE_MAX;
+    }
+}
+
+static void lib_expr_release(lib_expr_value_t *v, int bit) {
+    if (v->owned) {
+        lib_bitmap_free(v->r, bit);
+    }
+    v->r = NULL;
+    v->owned = false;
+}
+
+static lib_expr_value_t lib_expr_owned(void *r) {
+    lib_expr_value_t v = {r, true};
+    return v;
+}
+
+/**
+ * acc = acc AND r, or acc AND NOT r, in place when acc is owned.
+ */
+static bool lib_expr_fold(lib_expr_value_t *acc, const void *r, bool negate, int bit) {
+    if (acc->owned) {
+        if (negate) {
+            lib_bitmap_andnot_inplace(acc->r, r, bit);
+        } else {
+            lib_bitmap_and_inplace(acc->r, r, bit);
+        }
+        return true;
+    }
+    void *result = negate ? lib_bitmap_andnot(acc->r, r, bit) : lib_bitmap_and(acc->r, r, bit);
+    if (result == NULL) {
+        return false;
+    }
+    *acc = lib_expr_owned(result);
+    return true;
+}
+
+typedef struct {
+    size_t pos;
+    uint64_t cardinality;
+} lib_expr_child_t;
+
+static int lib_expr_child_compare(const void *a, const void *b) {
+    uint64_t x = ((const lib_expr_child_t *) a)->cardinality;
+    uint64_t y = ((const lib_expr_child_t *) b)->cardinality;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static lib_expr_value_t lib_expr_eval(const lib_expr_t *e, size_t pos, int depth);
+
+static lib_expr_value_t lib_expr_and(const lib_expr_t *e, size_t pos, int depth) {
+    lib_expr_value_t acc = {NULL, false};
+    size_t n = (size_t) e->plan[pos + 1];
+    // operands first sorted by cardinality, then the other children, then the negated ones
+    lib_expr_child_t *children = (lib_expr_child_t *) roaring_malloc(n * sizeof(lib_expr_child_t));
+    if (children == NULL) {
+        return acc;
+    }
+    size_t leaves = 0;
+    size_t positives = 0;
+    size_t negatives = n;
+    size_t next = pos + 2;
+    for (size_t i = 0; i < n; i++) {
+        size_t child = next;
+        next = lib_expr_skip(e, child, depth + 1);
+        if (e->plan[child] == LIB_EXPR_NOT) {
+            children[--negatives].pos = child + 1;
+        } else {
+            children[positives].pos = child;
+            children[positives].cardinality = UINT64_MAX;
+            if (e->plan[child] == LIB_EXPR_OPERAND) {
+                children[positives].cardinality = lib_bitmap_cardinality(e->operands[e->plan[child + 1]], e->bit);
+                leaves++;
+            }
+            positives++;
+        }
+    }
+    if (positives == 0) {
+        goto out;
+    }
+    qsort(children, positives, sizeof(lib_expr_child_t), lib_expr_child_compare);
+    if (leaves > 0 && children[0].cardinality == 0) {
+        acc = lib_expr_owned(lib_bitmap_create(e->bit));
+        goto out;
+    }
+    if (leaves >= 2) {
+        acc = lib_expr_owned(lib_bitmap_and(e->operands[e->plan[children[0].pos + 1]],
+                                            e->operands[e->plan[children[1].pos + 1]], e->bit));
+    } else {
+        acc = lib_expr_eval(e, children[0].pos, depth + 1);
+    }
+    for (size_t i = leaves >= 2 ? 2 : 1; i < n && acc.r != NULL; i++) {
+        if (lib_bitmap_is_empty(acc.r, e->bit)) {
+            break;
+        }
+        lib_expr_value_t v = lib_expr_eval(e, children[i].pos, depth + 1);
+        if (v.r == NULL || !lib_expr_fold(&acc, v.r, i >= positives, e->bit)) {
+            lib_expr_release(&v, e->bit);
+            lib_expr_release(&acc, e->bit);
+            break;
+        }
+        lib_expr_release(&v, e->bit);
+    }
+out:
+    roaring_free(children);
+    return acc;
+}
+
+static lib_expr_value_t lib_expr_merge(const lib_expr_t *e, size_t pos, int depth) {
+    lib_expr_value_t ret = {NULL, false};
+    size_t n = (size_t) e->plan[pos + 1];
+    lib_expr_value_t *values = (lib_expr_value_t *) roaring_calloc(n, sizeof(lib_expr_value_t));
+    void **rs = (void **) roaring_malloc(n * sizeof(void *));
+    size_t count = 0;
+    bool ok = values != NULL && rs != NULL;
+    size_t next = pos + 2;
+    for (size_t i = 0; i < n && ok; i++) {
+        values[count] = lib_expr_eval(e, next, depth + 1);
+        next = lib_expr_skip(e, next, depth + 1);
+        ok = values[count].r != NULL;
+        if (ok && lib_bitmap_is_empty(values[count].r, e->bit)) {
+            lib_expr_release(&values[count], e->bit);
+        } else if (ok) {
+            rs[count] = values[count].r;
+            count++;
+        }
+    }
+    if (ok && count == 0) {
+        ret = lib_expr_owned(lib_bitmap_create(e->bit));
+    } else if (ok && count == 1) {
+        ret = values[0];
+        values[0].owned = false;
+    } else if (ok) {
+        void *r = e->plan[pos] == LIB_EXPR_OR ? lib_or_many(rs, count, e->bit) : lib_xor_many(rs, count, e->bit);
+        ret = lib_expr_owned(r);
+    }
+    for (size_t i = 0; values != NULL && i < n; i++) {
+        lib_expr_release(&values[i], e->bit);
+    }
+    roaring_free(values);
+    roaring_free(rs);
+    return ret;
+}
+
+/**
+ * Evaluates the node at `pos` of a validated plan. The result is NULL on
+ * allocation failure or if a not is misplaced.
+ */
+static lib_expr_value_t lib_expr_eval(const lib_expr_t *e, size_t pos, int depth) {
+    lib_expr_value_t v = {NULL, false};
+    switch (e->plan[pos]) {
+        case LIB_EXPR_OPERAND:
+            v.r = e->operands[e->plan[pos + 1]];
+            return v;
+        case LIB_EXPR_AND:
+            return lib_expr_and(e, pos, depth);
+        case LIB_EXPR_OR:
+        case LIB_EXPR_XOR:
+            return lib_expr_merge(e, pos, depth);
+        default:
+            return v;
+    }
+}
+
+/**
+ * Evaluates the plan over the operands and returns a new bitmap, or NULL if
+ * the plan is malformed, a not is not the child of an and with a
+ * non-negated child, or on allocation failure.
+ */
+static void *lib_expr_evaluate(const int32_t *plan, size_t size, void *const *operands, size_t number, int bit) {
+    lib_expr_t e = {plan, size, operands, number, bit};
+    if (lib_expr_skip(&e, 0, 0) != size) {
+        return NULL;
+    }
+    lib_expr_value_t v = lib_expr_eval(&e, 0, 0);
+    if (v.r != NULL && !v.owned) {
+        return lib_bitmap_copy(v.r, bit);
+    }
+    return v.r;
+}
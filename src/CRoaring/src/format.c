@@ -0,0 +1,180 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The serialization formats besides the portable one, and detection of the
+ * format of serialized bytes.
+ *
+ *   native   `roaring_bitmap_serialize()`, 32-bit only: a tag byte, then the
+ *            cardinality and every value as a uint32 (tag 1) or the portable
+ *            format (tag 2), whichever is smaller
+ *   frozen   `roaring_bitmap_frozen_serialize()` and
+ *            `roaring64_bitmap_frozen_serialize()`: the containers as they are
+ *            laid out in memory, read through a frozen view of an aligned copy
+ *
+ * 32-bit portable bytes start with the cookie 12346 or 12347, native bytes
+ * with their tag and frozen bytes end with the frozen cookie. 64-bit portable
+ * bytes have no cookie, so bytes are taken as portable when the portable
+ * headers span exactly all of them. Detection tries portable, then native,
+ * then frozen, and falls back to portable, whose reader then rejects bytes
+ * that are none of them.
+ */
+
+#define LIB_FORMAT_PORTABLE 0
+#define LIB_FORMAT_NATIVE 1
+#define LIB_FORMAT_FROZEN 2
+#define LIB_FORMAT_ALIGNMENT 64  // >= the alignment needed by the frozen views
+
+/**
+ * The format of the `n` bytes of `buf`, LIB_FORMAT_PORTABLE when unknown.
+ */
+static int lib_format_detect(const char *buf, size_t n, int bit) {
+    if (bit == LIB_BIT_64) {
+        if (roaring64_bitmap_portable_deserialize_size(buf, n) == n) {
+            return LIB_FORMAT_PORTABLE;
+        }
+        // the flags, then the container count, padded to a multiple of the alignment
+        if (n >= 16 && n % CROARING_BITSET_ALIGNMENT == 0 && (buf[0] & ~ROARING_FLAG_FROZEN) == 0) {
+            return LIB_FORMAT_FROZEN;
+        }
+        return LIB_FORMAT_PORTABLE;
+    }
+    if (n > 0 && roaring_bitmap_portable_deserialize_size(buf, n) == n) {
+        return LIB_FORMAT_PORTABLE;
+    }
+    if (n >= 5 && buf[0] == CROARING_SERIALIZATION_ARRAY_UINT32) {
+        uint32_t card;
+        memcpy(&card, buf + 1, sizeof(card));
+        if (5 + (uint64_t) card * sizeof(uint32_t) == n) {
+            return LIB_FORMAT_NATIVE;
+        }
+    }
+    if (n >= 1 && buf[0] == CROARING_SERIALIZATION_CONTAINER &&
+        roaring_bitmap_portable_deserialize_size(buf + 1, n - 1) == n - 1) {
+        return LIB_FORMAT_NATIVE;
+    }
+    if (n >= 4) {
+        uint32_t header;
+        memcpy(&header, buf + n - 4, sizeof(header));
+        uint64_t tail = 4 + (uint64_t) (header >> 15) * 5;  // keys, counts, typecodes and header
+        // the keys follow containers made of uint16, so they start at an even offset
+        if ((header & 0x7FFF) == FROZEN_COOKIE && tail <= n && (n - tail) % 2 == 0) {
+            return LIB_FORMAT_FROZEN;
+        }
+    }
+    return LIB_FORMAT_PORTABLE;
+}
+
+/**
+ * Fills `view` with the containers of the 32-bit bitmap `r`, shared (copy on
+ * write) containers unwrapped, so it can be frozen without unsharing the
+ * containers of `r`. The containers stay owned by `r`, release the view with
+ * `ra_clear_without_containers()`. Returns false on allocation failure.
+ */
+static bool lib_frozen_view_of(roaring_bitmap_t *view, const roaring_bitmap_t *r) {
+    const roaring_array_t *ra = &r->high_low_container;
+    if (!ra_init_with_capacity(&view->high_low_container, (uint32_t) ra->size)) {
+        return false;
+    }
+    for (int32_t i = 0; i < ra->size; i++) {
+        uint8_t typecode = ra->typecodes[i];
+        view->high_low_container.containers[i] = (container_t *) container_unwrap_shared(ra->containers[i], &typecode);
+        view->high_low_container.keys[i] = ra->keys[i];
+        view->high_low_container.typecodes[i] = typecode;
+    }
+    view->high_low_container.size = ra->size;
+    return true;
+}
+
+/**
+ * Size of the frozen serialization of `r`, 0 on allocation failure. A 32-bit
+ * bitmap is left untouched, its shared containers are measured in place. A
+ * 64-bit bitmap is shrunk first, as the 64-bit frozen format requires: its
+ * memory is compacted, the values are unchanged and 64-bit bitmaps share no
+ * containers with their clones.
+ */
+static size_t lib_frozen_size(void *r, int bit) {
+    if (bit == LIB_BIT_32) {
+        roaring_bitmap_t view;
+        if (!lib_frozen_view_of(&view, (const roaring_bitmap_t *) r)) {
+            return 0;
+        }
+        size_t size = roaring_bitmap_frozen_size_in_bytes(&view);
+        ra_clear_without_containers(&view.high_low_container);
+        return size;
+    }
+    roaring64_bitmap_shrink_to_fit((roaring64_bitmap_t *) r);
+    return roaring64_bitmap_frozen_size_in_bytes((const roaring64_bitmap_t *) r);
+}
+
+/**
+ * Writes the frozen serialization of `r` to `buf`, which may be unaligned and
+ * must hold `lib_frozen_size()` bytes. Returns the size, 0 on failure. Like
+ * `lib_frozen_size()` it leaves a 32-bit bitmap untouched and shrinks a
+ * 64-bit one.
+ */
+static size_t lib_frozen_serialize(void *r, char *buf, int bit) {
+    if (bit == LIB_BIT_32) {
+        roaring_bitmap_t view;
+        if (!lib_frozen_view_of(&view, (const roaring_bitmap_t *) r)) {
+            return 0;
+        }
+        size_t size = roaring_bitmap_frozen_size_in_bytes(&view);
+        roaring_bitmap_frozen_serialize(&view, buf);
+        ra_clear_without_containers(&view.high_low_container);
+        return size;
+    }
+    roaring64_bitmap_shrink_to_fit((roaring64_bitmap_t *) r);
+    return roaring64_bitmap_frozen_serialize((const roaring64_bitmap_t *) r, buf);
+}
+
+/**
+ * Reads a bitmap from its `n` bytes of frozen serialization: takes a frozen
+ * view of an aligned copy of them, copies the view and validates the copy.
+ * Returns NULL if the bytes are not a valid bitmap or on allocation failure.
+ */
+static void *lib_frozen_deserialize(const char *buf, size_t n, int bit) {
+    char *aligned = (char *) roaring_aligned_malloc(LIB_FORMAT_ALIGNMENT, n == 0 ? 1 : n);
+    if (aligned == NULL) {
+        return NULL;
+    }
+    memcpy(aligned, buf, n);
+    const char *reason = NULL;
+    void *r = NULL;
+    if (bit == LIB_BIT_32) {
+        roaring_bitmap_t *view = (roaring_bitmap_t *) roaring_bitmap_frozen_view(aligned, n);
+        if (view != NULL) {
+            r = roaring_bitmap_copy(view);
+            roaring_bitmap_free(view);
+        }
+        if (r != NULL && !roaring_bitmap_internal_validate((const roaring_bitmap_t *) r, &reason)) {
+            roaring_bitmap_free((roaring_bitmap_t *) r);
+            r = NULL;
+        }
+    } else {
+        roaring64_bitmap_t *view = roaring64_bitmap_frozen_view(aligned, n);
+        if (view != NULL) {
+            r = roaring64_bitmap_copy(view);
+            roaring64_bitmap_free(view);
+        }
+        if (r != NULL && !roaring64_bitmap_internal_validate((const roaring64_bitmap_t *) r, &reason)) {
+            roaring64_bitmap_free((roaring64_bitmap_t *) r);
+            r = NULL;
+        }
+    }
+    roaring_aligned_free(aligned);
+    return r;
+}
@@ -0,0 +1,313 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Bitmap index of a column of (row, value) pairs.
+ *
+ * With equality encoding there is one bitmap per distinct value holding the
+ * rows with that value. With range encoding bitmap i holds the rows whose
+ * value is lower than or equal to the i-th smallest value, so any range of
+ * values is one andnot of two bitmaps.
+ *
+ * The index is built in one pass over the pairs: rows are grouped by value
+ * with a hash table and a counting scatter, then the bitmap of every group is
+ * filled with bulk adds on the pool.
+ */
+
+#define LIB_INDEX_EQUALITY 0
+#define LIB_INDEX_RANGE 1
+
+typedef struct {
+    int bit;
+    size_t size;  // number of distinct values
+    int64_t *values;  // sorted
+    void **bitmaps;  // bitmaps[i] goes with values[i]
+} lib_index_t;
+
+static void lib_index_free(lib_index_t *index) {
+    if (index == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < index->size; i++) {
+        lib_bitmap_free(index->bitmaps[i], index->bit);
+    }
+    roaring_free(index->values);
+    roaring_free(index->bitmaps);
+    roaring_free(index);
+}
+
+typedef struct {
+    int64_t value;
+    uint32_t group;
+} lib_index_value_t;
+
+static int lib_index_value_compare(const void *a, const void *b) {
+    int64_t x = ((const lib_index_value_t *) a)->value;
+    int64_t y = ((const lib_index_value_t *) b)->value;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/**
+ * Open addressing table from value to group, groups are numbered in order of
+ * first appearance.
+ */
+typedef struct {
+    uint32_t *slots;  // group + 1, 0 is empty
+    size_t mask;
+    lib_index_value_t *groups;
+    size_t size;
+    size_t capacity;
+} lib_index_table_t;
+
+static inline size_t lib_index_hash(int64_t value) {
+    uint64_t h = (uint64_t) value * 0x9E3779B97F4A7C15ULL;
+    return (size_t) (h ^ (h >> 32));
+}
+
+static bool lib_index_table_grow(lib_index_table_t *t) {
+    size_t capacity = t->capacity == 0 ? 256 : 2 * t->capacity;
+    if (capacity > UINT32_MAX) {
+        return false;
+    }
+    lib_index_value_t *groups = (lib_index_value_t *) roaring_realloc(t->groups, capacity * sizeof(lib_index_value_t));
+    if (groups == NULL) {
+        return false;
+    }
+    t->groups = groups;
+    uint32_t *slots = (uint32_t *) roaring_calloc(2 * capacity, sizeof(uint32_t));
+    if (slots == NULL) {
+        return false;
+    }
+    roaring_free(t->slots);
+    t->slots = slots;
+    t->mask = 2 * capacity - 1;
+    t->capacity = capacity;
+    for (size_t g = 0; g < t->size; g++) {
+        size_t s = lib_index_hash(t->groups[g].value) & t->mask;
+        while (t->slots[s] != 0) {
+            s = (s + 1) & t->mask;
+        }
+        t->slots[s] = (uint32_t) g + 1;
+    }
+    return true;
+}
+
+/**
+ * Returns the group of `value`, adding it if needed, or UINT32_MAX on
+ * allocation failure.
+ */
+static uint32_t lib_index_table_find(lib_index_table_t *t, int64_t value) {
+    if (t->size == t->capacity && !lib_index_table_grow(t)) {
+        return UINT32_MAX;
+    }
+    size_t s = lib_index_hash(value) & t->mask;
+    while (t->slots[s] != 0) {
+        uint32_t g = t->slots[s] - 1;
+        if (t->groups[g].value == value) {
+            return g;
+        }
+        s = (s + 1) & t->mask;
+    }
+    t->groups[t->size].value = value;
+    t->groups[t->size].group = (uint32_t) t->size;
+    t->slots[s] = (uint32_t) ++t->size;
+    return (uint32_t) (t->size - 1);
+}
+
+typedef struct {
+    const uint64_t *rows;
+    const size_t *offsets;  // rows of group g are rows[offsets[g] .. offsets[g + 1])
+    size_t groups;
+    size_t tasks;
+    int bit;
+    void **bitmaps;  // by group
+} lib_index_fill_t;
+
+static void lib_index_fill_task(void *ctx, size_t task) {
+    lib_index_fill_t *f = (lib_index_fill_t *) ctx;
+    size_t begin = task * f->groups / f->tasks;
+    size_t end = (task + 1) * f->groups / f->tasks;
+    for (size_t g = begin; g < end; g++) {
+        f->bitmaps[g] = lib_bitmap_create(f->bit);
+        if (f->bitmaps[g] != NULL) {
+            lib_bitmap_add_many(f->bitmaps[g], f->offsets[g + 1] - f->offsets[g], f->rows + f->offsets[g], f->bit);
+        }
+    }
+}
+
+static inline int64_t lib_index_load(const char *pairs, size_t i) {
+    int64_t v;
+    memcpy(&v, pairs + i * sizeof(int64_t), sizeof(v));
+    return v;
+}
+
+/**
+ * Builds the index of `n` (row, value) pairs laid out as 2 * n int64 in
+ * machine byte order. Each row holds one value, the two encodings would
+ * disagree on a row given several, so repeated rows are rejected. Returns NULL on allocation failure, if a row repeats or
+ * if a row is negative or, for 32-bit bitmaps, does not fit in 32 bits.
+ */
+static lib_index_t *lib_index_build(const char *pairs, size_t n, int encoding, int bit) {
+    lib_index_t *index = NULL;
+    lib_index_table_t t = {0};
+    uint32_t *group_of = (uint32_t *) roaring_malloc((n == 0 ? 1 : n) * sizeof(uint32_t));
+    size_t *offsets = NULL;
+    uint64_t *rows = NULL;
+    void **bitmaps = NULL;
+    if (group_of == NULL) {
+        return NULL;
+    }
+    uint64_t row_max = bit == LIB_BIT_32 ? UINT32_MAX : INT64_MAX;
+    for (size_t i = 0; i < n; i++) {
+        int64_t row = lib_index_load(pairs, 2 * i);
+        if (row < 0 || (uint64_t) row > row_max) {
+            goto out;
+        }
+        group_of[i] = lib_index_table_find(&t, lib_index_load(pairs, 2 * i + 1));
+        if (group_of[i] == UINT32_MAX) {
+            goto out;
+        }
+    }
+    size_t k = t.size;
+    offsets = (size_t *) roaring_calloc(k + 2, sizeof(size_t));
+    rows = (uint64_t *) roaring_malloc((n == 0 ? 1 : n) * sizeof(uint64_t));
+    bitmaps = (void **) roaring_calloc(k == 0 ? 1 : k, sizeof(void *));
+    index = (lib_index_t *) roaring_calloc(1, sizeof(lib_index_t));
+    if (offsets == NULL || rows == NULL || bitmaps == NULL || index == NULL) {
+        goto fail;
+    }
+    index->bit = bit;
+    index->values = (int64_t *) roaring_malloc((k == 0 ? 1 : k) * sizeof(int64_t));
+    index->bitmaps = (void **) roaring_calloc(k == 0 ? 1 : k, sizeof(void *));
+    if (index->values == NULL || index->bitmaps == NULL) {
+        goto fail;
+    }
+    // counting scatter, rows keep their input order inside a group
+    for (size_t i = 0; i < n; i++) {
+        offsets[group_of[i] + 2]++;
+    }
+    for (size_t g = 2; g < k + 2; g++) {
+        offsets[g] += offsets[g - 1];
+    }
+    for (size_t i = 0; i < n; i++) {
+        rows[offsets[group_of[i] + 1]++] = (uint64_t) lib_index_load(pairs, 2 * i);
+    }
+    lib_index_fill_t f = {rows, offsets, k, lib_pool_tasks(lib_pool_get_threads(), k), bit, bitmaps};
+    if (k > 0) {
+        lib_pool_run(f.tasks, lib_index_fill_task, &f);
+    }
+    for (size_t g = 0; g < k; g++) {
+        if (bitmaps[g] == NULL) {
+            goto fail;
+        }
+    }
+    // the union of the groups holds n rows only when no row repeats
+    if (k > 0) {
+        void *all = lib_or_many(bitmaps, k, bit);
+        bool distinct = all != NULL && lib_bitmap_cardinality(all, bit) == n;
+        lib_bitmap_free(all, bit);
+        if (!distinct) {
+            goto fail;
+        }
+    }
+    if (k > 1) {
+        qsort(t.groups, k, sizeof(lib_index_value_t), lib_index_value_compare);
+    }
+    for (size_t i = 0; i < k; i++) {
+        index->values[i] = t.groups[i].value;
+        index->bitmaps[i] = bitmaps[t.groups[i].group];
+        bitmaps[t.groups[i].group] = NULL;
+        index->size++;
+        if (encoding == LIB_INDEX_RANGE && i > 0) {
+            lib_bitmap_or_inplace(index->bitmaps[i], index->bitmaps[i - 1], bit);
+        }
+    }
+    goto out;
+fail:
+    if (bitmaps != NULL) {
+        for (size_t g = 0; g < k; g++) {
+            lib_bitmap_free(bitmaps[g], bit);
+        }
+    }
+    lib_index_free(index);
+    index = NULL;
+out:
+    roaring_free(bitmaps);
+    roaring_free(rows);
+    roaring_free(offsets);
+    roaring_free(group_of);
+    roaring_free(t.slots);
+    roaring_free(t.groups);
+    return index;
+}
+
+/**
+ * Returns the rows matching the runs of values [runs[2 * i], runs[2 * i + 1]]
+ * (inclusive positions in the sorted values, runs sorted and disjoint) of an
+ * index of `n` bitmaps. With equality encoding this is the union of all the
+ * bitmaps of the runs, with range encoding the union of one andnot per run.
+ * The union goes through `lib_or_many()`, so it uses the pool. Returns NULL
+ * on allocation failure.
+ */
+static void *lib_index_union(void *const *bitmaps, size_t n, const uint64_t *runs, size_t number, int encoding,
+                             int bit) {
+    size_t count = 0;
+    for (size_t i = 0; i < number; i++) {
+        if (runs[2 * i] > runs[2 * i + 1] || runs[2 * i + 1] >= n) {
+            return NULL;
+        }
+        count += encoding == LIB_INDEX_RANGE ? 1 : (size_t) (runs[2 * i + 1] - runs[2 * i] + 1);
+    }
+    if (count == 0) {
+        return lib_bitmap_create(bit);
+    }
+    void **parts = (void **) roaring_calloc(count, sizeof(void *));
+    if (parts == NULL) {
+        return NULL;
+    }
+    void *result = NULL;
+    size_t k = 0;
+    for (size_t i = 0; i < number; i++) {
+        uint64_t first = runs[2 * i];
+        uint64_t last = runs[2 * i + 1];
+        if (encoding != LIB_INDEX_RANGE) {
+            for (uint64_t j = first; j <= last; j++) {
+                parts[k++] = bitmaps[j];
+            }
+        } else if (first == 0) {
+            parts[k++] = lib_bitmap_copy(bitmaps[last], bit);
+        } else {
+            parts[k++] = lib_bitmap_andnot(bitmaps[last], bitmaps[first - 1], bit);
+        }
+        if (parts[k - 1] == NULL) {
+            goto out;
+        }
+    }
+    if (count == 1) {
+        result = encoding == LIB_INDEX_RANGE ? parts[0] : lib_bitmap_copy(parts[0], bit);
+        parts[0] = NULL;
+    } else {
+        result = lib_or_many(parts, count, bit);
+    }
+out:
+    if (encoding == LIB_INDEX_RANGE) {
+        for (size_t i = 0; i < k; i++) {
+            lib_bitmap_free(parts[i], bit);
+        }
+    }
+    roaring_free(parts);
+    return result;
+}
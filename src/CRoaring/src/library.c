@@ -15,6 +15,25 @@
  */
 
 #include "roaring.c"
+#include "simd.c"
+#include "thread_pool.c"
+#include "container_list.c"
+#include "stats.c"
+#include "memory.c"
+#include "ops.c"
+#include "aggregate.c"
+#include "range.c"
+#include "offset.c"
+#include "width.c"
+#include "dense.c"
+#include "portable.c"
+#include "stream.c"
+#include "crc32c.c"
+#include "format.c"
+#include "store.c"
+#include "bsi.c"
+#include "index.c"
+#include "expr.c"
 //----------------------------创建、复制、压缩、清空、释放----------------------------
 /**
  * Dynamically allocates a new bitmap (initially empty).
@@ -22,7 +41,7 @@
  * Client is responsible for calling `roaring_bitmap_free()`.
  */
 void *bp32_create(void) {
-    return roaring_bitmap_create();
+    return lib_live_track(LIB_LIVE_BITMAP, roaring_bitmap_create());
 }
 
 /**
@@ -31,7 +50,7 @@ void *bp32_create(void) {
  * Client is responsible for calling `roaring_bitmap_free()`.
  */
 void *bp64_create(void) {
-    return roaring64_bitmap_create();
+    return lib_live_track(LIB_LIVE_BITMAP, roaring64_bitmap_create());
 }
 
 /**
@@ -40,7 +59,7 @@ void *bp64_create(void) {
  * The returned pointer may be NULL in case of errors.
  */
 void *bp32_copy(void *r) {
-    return roaring_bitmap_copy((roaring_bitmap_t *) r);
+    return lib_live_track(LIB_LIVE_BITMAP, roaring_bitmap_copy((roaring_bitmap_t *) r));
 }
 
 /**
@@ -49,7 +68,44 @@ void *bp32_copy(void *r) {
  * The returned pointer may be NULL in case of errors.
  */
 void *bp64_copy(void *r) {
-    return roaring64_bitmap_copy((roaring64_bitmap_t *) r);
+    return lib_live_track(LIB_LIVE_BITMAP, roaring64_bitmap_copy((roaring64_bitmap_t *) r));
+}
+
+/**
+ * Whether you want to use copy-on-write.
+ * Saves memory and avoids copies, but needs more care in a threaded context.
+ * Most users should ignore this flag.
+ *
+ * With copy-on-write, copies of the bitmap (and their copies) share their
+ * containers until one of them writes to a container. Always returns true.
+ */
+bool bp32_set_copy_on_write(void *r, bool cow) {
+    roaring_bitmap_set_copy_on_write((roaring_bitmap_t *) r, cow);
+    return true;
+}
+
+/**
+ * 64-bit bitmaps always copy their containers: their copy and every write
+ * path work on unshared containers. Returns false if `cow` is true.
+ */
+bool bp64_set_copy_on_write(void *r, bool cow) {
+    (void) r;
+    return !cow;
+}
+
+/**
+ * Returns true if the bitmap uses copy-on-write.
+ */
+bool bp32_get_copy_on_write(void *r) {
+    return roaring_bitmap_get_copy_on_write((const roaring_bitmap_t *) r);
+}
+
+/**
+ * 64-bit bitmaps never use copy-on-write, always returns false.
+ */
+bool bp64_get_copy_on_write(void *r) {
+    (void) r;
+    return false;
 }
 
 /** convert array and bitmap containers to run containers when it is more
@@ -90,6 +146,7 @@ void bp64_clear(void *r) {
  * Frees the memory.
  */
 void bp32_free(void *r) {
+    lib_live_untrack(LIB_LIVE_BITMAP, r);
     roaring_bitmap_free((roaring_bitmap_t *) r);
 }
 
@@ -97,6 +154,7 @@ void bp32_free(void *r) {
  * Frees the memory.
  */
 void bp64_free(void *r) {
+    lib_live_untrack(LIB_LIVE_BITMAP, r);
     roaring64_bitmap_free((roaring64_bitmap_t *) r);
 }
 //----------------------------添加、删除函数----------------------------
@@ -124,7 +182,9 @@ void bp64_add(void *r, uint64_t x) {
  * elements in `vals`
  */
 void bp32_add_many(void *r, size_t n_args, const uint32_t *vals) {
+    uint64_t start = lib_stats_begin();
     roaring_bitmap_add_many((roaring_bitmap_t *) r, n_args, vals);
+    lib_stats_end(LIB_STAT_ADD_MANY, LIB_BIT_32, start, n_args * sizeof(uint32_t), 0);
 }
 
 /**
@@ -136,7 +196,9 @@ void bp32_add_many(void *r, size_t n_args, const uint32_t *vals) {
  * `vals`.
  */
 void bp64_add_many(void *r, size_t n_args, const uint64_t *vals) {
+    uint64_t start = lib_stats_begin();
     roaring64_bitmap_add_many((roaring64_bitmap_t *) r, n_args, vals);
+    lib_stats_end(LIB_STAT_ADD_MANY, LIB_BIT_64, start, n_args * sizeof(uint64_t), 0);
 }
 
 /**
@@ -187,14 +249,18 @@ void bp64_remove(void *r, uint64_t x) {
  * Remove multiple values
  */
 void bp32_remove_many(void *r, size_t n_args, uint32_t *vals) {
+    uint64_t start = lib_stats_begin();
     roaring_bitmap_remove_many((roaring_bitmap_t *) r, n_args, vals);
+    lib_stats_end(LIB_STAT_REMOVE_MANY, LIB_BIT_32, start, n_args * sizeof(uint32_t), 0);
 }
 
 /**
  * Remove multiple values
  */
 void bp64_remove_many(void *r, size_t n_args, uint64_t *vals) {
+    uint64_t start = lib_stats_begin();
     roaring64_bitmap_remove_many((roaring64_bitmap_t *) r, n_args, vals);
+    lib_stats_end(LIB_STAT_REMOVE_MANY, LIB_BIT_64, start, n_args * sizeof(uint64_t), 0);
 }
 
 /**
@@ -404,6 +470,40 @@ bool bp64_is_empty(void *r) {
     return roaring64_bitmap_is_empty((roaring64_bitmap_t *) r);
 }
 
+/**
+ * Computes the Jaccard index between two bitmaps. (Also known as the Tanimoto
+ * distance, or the Jaccard similarity coefficient)
+ *
+ * The Jaccard index is undefined if both bitmaps are empty.
+ */
+double bp32_jaccard_index(void *r1, void *r2) {
+    return roaring_bitmap_jaccard_index((roaring_bitmap_t *) r1, (roaring_bitmap_t *) r2);
+}
+
+/**
+ * Computes the Jaccard index between two bitmaps. (Also known as the Tanimoto
+ * distance, or the Jaccard similarity coefficient)
+ *
+ * The Jaccard index is undefined if both bitmaps are empty.
+ */
+double bp64_jaccard_index(void *r1, void *r2) {
+    return roaring64_bitmap_jaccard_index((roaring64_bitmap_t *) r1, (roaring64_bitmap_t *) r2);
+}
+
+/**
+ * Return true if all the elements of r1 are also in r2.
+ */
+bool bp32_is_subset(void *r1, void *r2) {
+    return roaring_bitmap_is_subset((roaring_bitmap_t *) r1, (roaring_bitmap_t *) r2);
+}
+
+/**
+ * Returns true if all values in `r1` are also in `r2`.
+ */
+bool bp64_is_subset(void *r1, void *r2) {
+    return roaring64_bitmap_is_subset((roaring64_bitmap_t *) r1, (roaring64_bitmap_t *) r2);
+}
+
 //----------------------------并集、交集、差集、称差集----------------------------
 
 /**
@@ -412,7 +512,7 @@ bool bp64_is_empty(void *r) {
  * The returned pointer may be NULL in case of errors.
  */
 void *bp32_or(void *r1, void *r2) {
-    return roaring_bitmap_or((roaring_bitmap_t *) r1, (roaring_bitmap_t *) r2);
+    return lib_live_track(LIB_LIVE_BITMAP, roaring_bitmap_or((roaring_bitmap_t *) r1, (roaring_bitmap_t *) r2));
 }
 
 /**
@@ -421,7 +521,7 @@ void *bp32_or(void *r1, void *r2) {
  * The returned pointer may be NULL in case of errors.
  */
 void *bp64_or(void *r1, void *r2) {
-    return roaring64_bitmap_or((roaring64_bitmap_t *) r1, (roaring64_bitmap_t *) r2);
+    return lib_live_track(LIB_LIVE_BITMAP, roaring64_bitmap_or((roaring64_bitmap_t *) r1, (roaring64_bitmap_t *) r2));
 }
 
 /**
@@ -453,13 +553,53 @@ uint64_t bp64_or_cardinality(void *r1, void *r2) {
     return roaring64_bitmap_or_cardinality((roaring64_bitmap_t *) r1, (roaring64_bitmap_t *) r2);
 }
 
+/**
+ * Computes the union between two bitmaps on up to `threads` threads and
+ * returns new bitmap. The key space (high 16 bits) is split into ranges
+ * holding about the same number of containers, each range is merged on its
+ * own thread and the container arrays are spliced back together.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_or_parallel(void *r1, void *r2, uint32_t threads) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_or_parallel(r1, r2, LIB_BIT_32, threads));
+}
+
+/**
+ * Computes the union between two bitmaps on up to `threads` threads and
+ * returns new bitmap. The key space (high 48 bits) is split into ranges
+ * holding about the same number of containers, each range is merged on its
+ * own thread and the containers are put back into one ART.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_or_parallel(void *r1, void *r2, uint32_t threads) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_or_parallel(r1, r2, LIB_BIT_64, threads));
+}
+
+/**
+ * Parallel version of `bp32_or_inplace()`, modifies r1 which keeps its
+ * address. Returns false if an allocation failed, r1 is then left unchanged.
+ */
+bool bp32_or_inplace_parallel(void *r1, void *r2, uint32_t threads) {
+    return lib_or_inplace_parallel(r1, r2, LIB_BIT_32, threads);
+}
+
+/**
+ * Parallel version of `bp64_or_inplace()`, modifies r1 which keeps its
+ * address. Returns false if an allocation failed, r1 is then left unchanged.
+ */
+bool bp64_or_inplace_parallel(void *r1, void *r2, uint32_t threads) {
+    return lib_or_inplace_parallel(r1, r2, LIB_BIT_64, threads);
+}
+
 /**
  * Computes the symmetric difference (xor) between two bitmaps
  * and returns new bitmap. The caller is responsible for memory management.
  * The returned pointer may be NULL in case of errors.
  */
 void *bp32_xor(void *r1, void *r2) {
-    return roaring_bitmap_xor((roaring_bitmap_t *) r1, (roaring_bitmap_t *) r2);
+    return lib_live_track(LIB_LIVE_BITMAP, roaring_bitmap_xor((roaring_bitmap_t *) r1, (roaring_bitmap_t *) r2));
 }
 
 /**
@@ -468,7 +608,7 @@ void *bp32_xor(void *r1, void *r2) {
  * The returned pointer may be NULL in case of errors.
  */
 void *bp64_xor(void *r1, void *r2) {
-    return roaring64_bitmap_xor((roaring64_bitmap_t *) r1, (roaring64_bitmap_t *) r2);
+    return lib_live_track(LIB_LIVE_BITMAP, roaring64_bitmap_xor((roaring64_bitmap_t *) r1, (roaring64_bitmap_t *) r2));
 }
 
 /**
@@ -512,7 +652,7 @@ uint64_t bp64_xor_cardinality(void *r1, void *r2) {
  * The returned pointer may be NULL in case of errors.
  */
 void *bp32_and(void *r1, void *r2) {
-    return roaring_bitmap_and((roaring_bitmap_t *) r1, (roaring_bitmap_t *) r2);
+    return lib_live_track(LIB_LIVE_BITMAP, roaring_bitmap_and((roaring_bitmap_t *) r1, (roaring_bitmap_t *) r2));
 }
 
 /**
@@ -527,7 +667,7 @@ void *bp32_and(void *r1, void *r2) {
  * The returned pointer may be NULL in case of errors.
  */
 void *bp64_and(void *r1, void *r2) {
-    return roaring64_bitmap_and((roaring64_bitmap_t *) r1, (roaring64_bitmap_t *) r2);
+    return lib_live_track(LIB_LIVE_BITMAP, roaring64_bitmap_and((roaring64_bitmap_t *) r1, (roaring64_bitmap_t *) r2));
 }
 
 /**
@@ -572,7 +712,7 @@ uint64_t bp64_and_cardinality(void *r1, void *r2) {
  * The returned pointer may be NULL in case of errors.
  */
 void *bp32_andnot(void *r1, void *r2) {
-    return roaring_bitmap_andnot((roaring_bitmap_t *) r1, (roaring_bitmap_t *) r2);
+    return lib_live_track(LIB_LIVE_BITMAP, roaring_bitmap_andnot((roaring_bitmap_t *) r1, (roaring_bitmap_t *) r2));
 }
 
 /**
@@ -581,7 +721,7 @@ void *bp32_andnot(void *r1, void *r2) {
  * The returned pointer may be NULL in case of errors.
  */
 void *bp64_andnot(void *r1, void *r2) {
-    return roaring64_bitmap_andnot((roaring64_bitmap_t *) r1, (roaring64_bitmap_t *) r2);
+    return lib_live_track(LIB_LIVE_BITMAP, roaring64_bitmap_andnot((roaring64_bitmap_t *) r1, (roaring64_bitmap_t *) r2));
 }
 
 /**
@@ -613,6 +753,191 @@ uint64_t bp64_andnot_cardinality(void *r1, void *r2) {
     return roaring64_bitmap_andnot_cardinality((roaring64_bitmap_t *) r1, (roaring64_bitmap_t *) r2);
 }
 
+/**
+ * Computes the intersection between a bitmap and the range [min, max) and
+ * returns new bitmap. Only the containers inside the range are copied, the
+ * two at its edges are clipped, no bitmap is built for the range.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_and_range(void *r, uint64_t min, uint64_t max) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_range_op(r, min, max, LIB_RANGE_AND, LIB_BIT_32));
+}
+
+/**
+ * Computes the intersection between a bitmap and the range [min, max) and
+ * returns new bitmap. Only the containers inside the range are copied, the
+ * two at its edges are clipped, no bitmap is built for the range.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_and_range(void *r, uint64_t min, uint64_t max) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_range_op(r, min, max, LIB_RANGE_AND, LIB_BIT_64));
+}
+
+/**
+ * Computes the difference between a bitmap and the range [min, max) and
+ * returns new bitmap. The containers inside the range are skipped, the two at
+ * its edges are clipped, no bitmap is built for the range.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_andnot_range(void *r, uint64_t min, uint64_t max) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_range_op(r, min, max, LIB_RANGE_ANDNOT, LIB_BIT_32));
+}
+
+/**
+ * Computes the difference between a bitmap and the range [min, max) and
+ * returns new bitmap. The containers inside the range are skipped, the two at
+ * its edges are clipped, no bitmap is built for the range.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_andnot_range(void *r, uint64_t min, uint64_t max) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_range_op(r, min, max, LIB_RANGE_ANDNOT, LIB_BIT_64));
+}
+
+/**
+ * Computes the union between a bitmap and the range [min, max) and returns
+ * new bitmap. The keys inside the range become full run containers, the two
+ * at its edges are filled, no bitmap is built for the range.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_or_range(void *r, uint64_t min, uint64_t max) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_range_op(r, min, max, LIB_RANGE_OR, LIB_BIT_32));
+}
+
+/**
+ * Computes the union between a bitmap and the range [min, max) and returns
+ * new bitmap. The keys inside the range become full run containers, the two
+ * at its edges are filled, no bitmap is built for the range.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_or_range(void *r, uint64_t min, uint64_t max) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_range_op(r, min, max, LIB_RANGE_OR, LIB_BIT_64));
+}
+
+/**
+ * Compute the negation of the bitmap in the interval [range_start, range_end).
+ * The number of negated values is range_end - range_start.
+ * Areas outside the range are passed through unchanged.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_flip(void *r, uint64_t range_start, uint64_t range_end) {
+    if (range_end > (uint64_t) UINT32_MAX + 1) {
+        range_end = (uint64_t) UINT32_MAX + 1;
+    }
+    return lib_live_track(LIB_LIVE_BITMAP, roaring_bitmap_flip((roaring_bitmap_t *) r, range_start, range_end));
+}
+
+/**
+ * Create a new bitmap containing all the values in `r` that lie outside of the
+ * range `[min, max)`, along with all the values inside the range which are not
+ * in `r`. Areas outside the range are passed through unchanged.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_flip(void *r, uint64_t min, uint64_t max) {
+    return lib_live_track(LIB_LIVE_BITMAP, roaring64_bitmap_flip((roaring64_bitmap_t *) r, min, max));
+}
+
+/**
+ * Compute the negation of the bitmap in the interval [range_start, range_end).
+ * The number of negated values is range_end - range_start.
+ * Areas outside the range are passed through unchanged.
+ */
+void bp32_flip_inplace(void *r, uint64_t range_start, uint64_t range_end) {
+    if (range_end > (uint64_t) UINT32_MAX + 1) {
+        range_end = (uint64_t) UINT32_MAX + 1;
+    }
+    roaring_bitmap_flip_inplace((roaring_bitmap_t *) r, range_start, range_end);
+}
+
+/**
+ * In-place version of `bp64_flip()`, modifies `r`.
+ */
+void bp64_flip_inplace(void *r, uint64_t min, uint64_t max) {
+    roaring64_bitmap_flip_inplace((roaring64_bitmap_t *) r, min, max);
+}
+
+/**
+ * Check whether a bitmap and an open range intersect.
+ */
+bool bp32_intersect_with_range(void *r, uint64_t x, uint64_t y) {
+    return roaring_bitmap_intersect_with_range((roaring_bitmap_t *) r, x, y);
+}
+
+/**
+ * Check whether a bitmap intersects the range [min, max).
+ */
+bool bp64_intersect_with_range(void *r, uint64_t min, uint64_t max) {
+    return roaring64_bitmap_intersect_with_range((roaring64_bitmap_t *) r, min, max);
+}
+
+/**
+ * Adds the value 'offset' to each and every value in a bitmap, generating a
+ * new bitmap in the process. If offset + element is outside of the range
+ * [0,2^32), that the element will be dropped.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_add_offset(void *r, int64_t offset) {
+    return lib_live_track(LIB_LIVE_BITMAP, roaring_bitmap_add_offset((roaring_bitmap_t *) r, offset));
+}
+
+/**
+ * Adds `offset` to every value of the bitmap and returns a new bitmap, values
+ * that would fall outside [0, 2^64) are dropped. Whole containers are moved
+ * when the offset is a multiple of 65536, otherwise values are shifted within
+ * containers.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_add_offset(void *r, int64_t offset) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_add_offset64((roaring64_bitmap_t *) r, offset));
+}
+
+//----------------------------位数转换----------------------------
+/**
+ * Moves the containers of a 32-bit bitmap into a new 64-bit bitmap, see
+ * `roaring64_bitmap_move_from_roaring32()`. No container is copied, except
+ * the shared (copy on write) ones, and `r` is left empty.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp_move_32_to_64(void *r) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_move_to64((roaring_bitmap_t *) r));
+}
+
+/**
+ * Copies a 32-bit bitmap into a new 64-bit bitmap, container by container.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp_convert_32_to_64(void *r) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_convert(r, LIB_BIT_32, LIB_BIT_64));
+}
+
+/**
+ * Copies a 64-bit bitmap into a new 32-bit bitmap, container by container.
+ * Returns NULL if a value is greater than UINT32_MAX or in case of errors.
+ */
+void *bp_convert_64_to_32(void *r) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_convert(r, LIB_BIT_64, LIB_BIT_32));
+}
+
+/**
+ * Computes r1 AND r2 (op 0), r1 OR r2 (op 1), r1 ANDNOT r2 (op 2) or
+ * r1 XOR r2 (op 3) where r1 has width `bit1` (32 or 64) and r2 width `bit2`,
+ * by merging their containers by key without converting either bitmap.
+ * Returns a new bitmap as wide as r1 for and / andnot, and a new 64-bit
+ * bitmap for or / xor.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp_mixed_op(void *r1, uint32_t bit1, void *r2, uint32_t bit2, int op) {
+    if ((bit1 != LIB_BIT_32 && bit1 != LIB_BIT_64) || (bit2 != LIB_BIT_32 && bit2 != LIB_BIT_64) || op < 0 || op > 3) {
+        return NULL;
+    }
+    return lib_live_track(LIB_LIVE_BITMAP, lib_mixed_op(r1, (int) bit1, r2, (int) bit2, op));
+}
+
 //----------------------------迭代----------------------------
 /**
  * Create an iterator object that can be used to iterate through the values.
@@ -623,7 +948,7 @@ uint64_t bp64_andnot_cardinality(void *r1, void *r2) {
  * `it->has_value` is true.  The value is in `it->current_value`.
  */
 void *bp32_iterator_create(void *r) {
-    return roaring_iterator_create((roaring_bitmap_t *) r);
+    return lib_live_track(LIB_LIVE_ITERATOR, roaring_iterator_create((roaring_bitmap_t *) r));
 }
 
 /**
@@ -635,7 +960,7 @@ void *bp32_iterator_create(void *r) {
  * value can be retrieved with `roaring64_iterator_value()`.
  */
 void *bp64_iterator_create(void *r) {
-    return roaring64_iterator_create((roaring64_bitmap_t *) r);
+    return lib_live_track(LIB_LIVE_ITERATOR, roaring64_iterator_create((roaring64_bitmap_t *) r));
 }
 
 /**
@@ -650,7 +975,10 @@ void *bp64_iterator_create(void *r) {
  *  - after function returns, iterator is positioned at the next element
  */
 uint32_t bp32_iterator_read(void *r, uint32_t *buf, uint32_t count) {
-    return roaring_uint32_iterator_read((roaring_uint32_iterator_t *) r, buf, count);
+    uint64_t start = lib_stats_begin();
+    uint32_t read = roaring_uint32_iterator_read((roaring_uint32_iterator_t *) r, buf, count);
+    lib_stats_end(LIB_STAT_ITERATOR_READ, LIB_BIT_32, start, 0, read * sizeof(uint32_t));
+    return read;
 }
 
 /**
@@ -661,13 +989,17 @@ uint32_t bp32_iterator_read(void *r, uint32_t *buf, uint32_t count) {
  * This function can be used together with other iterator functions.
  */
 uint64_t bp64_iterator_read(void *r, uint64_t *buf, uint64_t count) {
-    return roaring64_iterator_read((roaring64_iterator_t *) r, buf, count);
+    uint64_t start = lib_stats_begin();
+    uint64_t read = roaring64_iterator_read((roaring64_iterator_t *) r, buf, count);
+    lib_stats_end(LIB_STAT_ITERATOR_READ, LIB_BIT_64, start, 0, read * sizeof(uint64_t));
+    return read;
 }
 
 /**
  * Free memory following `roaring_iterator_create()`
  */
 void bp32_iterator_free(void *r) {
+    lib_live_untrack(LIB_LIVE_ITERATOR, r);
     roaring_uint32_iterator_free((roaring_uint32_iterator_t *) r);
 }
 
@@ -675,6 +1007,7 @@ void bp32_iterator_free(void *r) {
  * Free the iterator.
  */
 void bp64_iterator_free(void *r) {
+    lib_live_untrack(LIB_LIVE_ITERATOR, r);
     roaring64_iterator_free((roaring64_iterator_t *) r);
 }
 //----------------------------序列化、反序列化、转数组----------------------------
@@ -718,7 +1051,10 @@ size_t bp64_portable_size_in_bytes(void *r) {
  * that you are recovering the correct data.
  */
 size_t bp32_portable_serialize(void *r, char *buf) {
-    return roaring_bitmap_portable_serialize((roaring_bitmap_t *) r, buf);
+    uint64_t start = lib_stats_begin();
+    size_t written = roaring_bitmap_portable_serialize((roaring_bitmap_t *) r, buf);
+    lib_stats_end(LIB_STAT_PORTABLE_SERIALIZE, LIB_BIT_32, start, 0, written);
+    return written;
 }
 
 /**
@@ -740,7 +1076,146 @@ size_t bp32_portable_serialize(void *r, char *buf) {
  * that you are recovering the correct data.
  */
 size_t bp64_portable_serialize(void *r, char *buf) {
-    return roaring64_bitmap_portable_serialize((roaring64_bitmap_t *) r, buf);
+    uint64_t start = lib_stats_begin();
+    size_t written = roaring64_bitmap_portable_serialize((roaring64_bitmap_t *) r, buf);
+    lib_stats_end(LIB_STAT_PORTABLE_SERIALIZE, LIB_BIT_64, start, 0, written);
+    return written;
+}
+
+/**
+ * Same as `bp32_portable_serialize()`, but the containers are written on up
+ * to `threads` threads straight to their final position in `buf`. The output
+ * is identical to the one of `bp32_portable_serialize()`.
+ *
+ * Returns how many bytes were written, 0 on allocation failure.
+ */
+size_t bp32_portable_serialize_parallel(void *r, char *buf, uint32_t threads) {
+    uint64_t start = lib_stats_begin();
+    size_t written = lib_portable_serialize_parallel(r, buf, LIB_BIT_32, threads);
+    lib_stats_end(LIB_STAT_PORTABLE_SERIALIZE_PARALLEL, LIB_BIT_32, start, 0, written);
+    return written;
+}
+
+/**
+ * Same as `bp64_portable_serialize()`, but the containers of all buckets are
+ * written on up to `threads` threads straight to their final position in
+ * `buf`. The output is identical to the one of `bp64_portable_serialize()`.
+ *
+ * Returns how many bytes were written, 0 on allocation failure.
+ */
+size_t bp64_portable_serialize_parallel(void *r, char *buf, uint32_t threads) {
+    uint64_t start = lib_stats_begin();
+    size_t written = lib_portable_serialize_parallel(r, buf, LIB_BIT_64, threads);
+    lib_stats_end(LIB_STAT_PORTABLE_SERIALIZE_PARALLEL, LIB_BIT_64, start, 0, written);
+    return written;
+}
+
+/**
+ * Creates a writer handing out the portable serialization of `r` in pieces,
+ * see `bp32_portable_writer_next()`. The bitmap must not be modified until
+ * the writer is freed.
+ * Caller is responsible for freeing the writer with `bp32_portable_writer_free()`.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_portable_writer_create(void *r) {
+    return lib_portable_writer_create(r, LIB_BIT_32);
+}
+
+/**
+ * Writes the next bytes of the portable serialization to `buf`, at most
+ * `capacity`. Returns the number of bytes written, 0 once the whole bitmap
+ * was written. The concatenation of all pieces is the output of
+ * `bp32_portable_serialize()`.
+ */
+size_t bp32_portable_writer_next(void *w, char *buf, size_t capacity) {
+    uint64_t start = lib_stats_begin();
+    size_t written = lib_portable_writer_next((lib_portable_writer_t *) w, buf, capacity);
+    lib_stats_end(LIB_STAT_PORTABLE_WRITER_NEXT, LIB_BIT_32, start, 0, written);
+    return written;
+}
+
+/**
+ * Frees a writer created by `bp32_portable_writer_create()`.
+ */
+void bp32_portable_writer_free(void *w) {
+    lib_portable_writer_free((lib_portable_writer_t *) w);
+}
+
+/**
+ * Writes the portable serialization of `r` to the file `path`, replacing its
+ * content. The containers are serialized one at a time through a bounded
+ * buffer and written with write(2), the whole serialized bitmap is never held
+ * in memory.
+ *
+ * Returns false on failure.
+ */
+bool bp32_portable_write_file(void *r, const char *path) {
+    return lib_portable_write_file(r, path, LIB_BIT_32);
+}
+
+/**
+ * Reads a bitmap written by `bp32_portable_write_file()` (or any portable
+ * serialization) from the file `path`, decoding it container by container
+ * through a bounded buffer.
+ *
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_portable_read_file(const char *path) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_portable_read_file(path, LIB_BIT_32));
+}
+
+/**
+ * Creates a writer handing out the portable serialization of `r` in pieces,
+ * see `bp64_portable_writer_next()`. The bitmap must not be modified until
+ * the writer is freed.
+ * Caller is responsible for freeing the writer with `bp64_portable_writer_free()`.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_portable_writer_create(void *r) {
+    return lib_portable_writer_create(r, LIB_BIT_64);
+}
+
+/**
+ * Writes the next bytes of the portable serialization to `buf`, at most
+ * `capacity`. Returns the number of bytes written, 0 once the whole bitmap
+ * was written. The concatenation of all pieces is the output of
+ * `bp64_portable_serialize()`.
+ */
+size_t bp64_portable_writer_next(void *w, char *buf, size_t capacity) {
+    uint64_t start = lib_stats_begin();
+    size_t written = lib_portable_writer_next((lib_portable_writer_t *) w, buf, capacity);
+    lib_stats_end(LIB_STAT_PORTABLE_WRITER_NEXT, LIB_BIT_64, start, 0, written);
+    return written;
+}
+
+/**
+ * Frees a writer created by `bp64_portable_writer_create()`.
+ */
+void bp64_portable_writer_free(void *w) {
+    lib_portable_writer_free((lib_portable_writer_t *) w);
+}
+
+/**
+ * Writes the portable serialization of `r` to the file `path`, replacing its
+ * content. The containers are serialized one at a time through a bounded
+ * buffer and written with write(2), the whole serialized bitmap is never held
+ * in memory.
+ *
+ * Returns false on failure.
+ */
+bool bp64_portable_write_file(void *r, const char *path) {
+    return lib_portable_write_file(r, path, LIB_BIT_64);
+}
+
+/**
+ * Reads a bitmap written by `bp64_portable_write_file()` (or any portable
+ * serialization) from the file `path`, decoding it container by container
+ * through a bounded buffer.
+ *
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_portable_read_file(const char *path) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_portable_read_file(path, LIB_BIT_64));
 }
 
 /**
@@ -779,7 +1254,10 @@ size_t bp64_portable_serialize(void *r, char *buf) {
  * The returned pointer may be NULL in case of errors.
  */
 void *bp32_portable_deserialize(char *buf, size_t maxbytes) {
-    return roaring_bitmap_portable_deserialize_safe(buf, maxbytes);
+    uint64_t start = lib_stats_begin();
+    void *r = roaring_bitmap_portable_deserialize_safe(buf, maxbytes);
+    lib_stats_end(LIB_STAT_PORTABLE_DESERIALIZE, LIB_BIT_32, start, maxbytes, 0);
+    return lib_live_track(LIB_LIVE_BITMAP, r);
 }
 
 /**
@@ -816,28 +1294,934 @@ void *bp32_portable_deserialize(char *buf, size_t maxbytes) {
  * compatible with little-endian systems.
  */
 void *bp64_portable_deserialize(char *buf, size_t maxbytes) {
-    return roaring64_bitmap_portable_deserialize_safe(buf, maxbytes);
+    uint64_t start = lib_stats_begin();
+    void *r = roaring64_bitmap_portable_deserialize_safe(buf, maxbytes);
+    lib_stats_end(LIB_STAT_PORTABLE_DESERIALIZE, LIB_BIT_64, start, maxbytes, 0);
+    return lib_live_track(LIB_LIVE_BITMAP, r);
 }
 
 /**
- * Convert the bitmap to a sorted array, output in `ans`.
+ * Same as `bp32_portable_deserialize()`, but the containers are decoded on up
+ * to `threads` threads. The header is scanned once to find where every
+ * container starts (reading up to maxbytes), then the containers are decoded
+ * independently. Keys must be strictly increasing, as in any serialized
+ * valid bitmap.
  *
- * Caller is responsible to ensure that there is enough memory allocated, e.g.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_portable_deserialize_parallel(char *buf, size_t maxbytes, uint32_t threads) {
+    uint64_t start = lib_stats_begin();
+    void *r = lib_portable_deserialize_parallel(buf, maxbytes, LIB_BIT_32, threads);
+    lib_stats_end(LIB_STAT_PORTABLE_DESERIALIZE_PARALLEL, LIB_BIT_32, start, maxbytes, 0);
+    return lib_live_track(LIB_LIVE_BITMAP, r);
+}
+
+/**
+ * Same as `bp64_portable_deserialize()`, but the containers of all buckets
+ * are decoded on up to `threads` threads. The header of every bucket is
+ * scanned once to find where every container starts (reading up to
+ * maxbytes), then the containers are decoded independently.
  *
- *     ans = malloc(roaring_bitmap_get_cardinality(bitmap) * sizeof(uint32_t));
+ * The returned pointer may be NULL in case of errors.
  */
-void bp32_to_uint_array(void *r, uint32_t *ans) {
-    roaring_bitmap_to_uint32_array((roaring_bitmap_t *) r, ans);
+void *bp64_portable_deserialize_parallel(char *buf, size_t maxbytes, uint32_t threads) {
+    uint64_t start = lib_stats_begin();
+    void *r = lib_portable_deserialize_parallel(buf, maxbytes, LIB_BIT_64, threads);
+    lib_stats_end(LIB_STAT_PORTABLE_DESERIALIZE_PARALLEL, LIB_BIT_64, start, maxbytes, 0);
+    return lib_live_track(LIB_LIVE_BITMAP, r);
 }
 
 /**
- * Convert the bitmap to a sorted array `out`.
+ * How many bytes `bp32_serialize()` writes: the size of the portable format,
+ * or of the cardinality and the values as uint32, whichever is smaller, plus
+ * one byte.
+ */
+size_t bp32_size_in_bytes(void *r) {
+    return roaring_bitmap_size_in_bytes((roaring_bitmap_t *) r);
+}
+
+/**
+ * Write a bitmap to a char buffer in the native format of
+ * `roaring_bitmap_serialize()`, which is smaller than the portable format for
+ * sparse bitmaps but is not compatible with other languages. The output
+ * buffer should refer to at least `bp32_size_in_bytes(r)` bytes.
  *
- * Caller is responsible to ensure that there is enough memory allocated, e.g.
- * ```
- * out = malloc(roaring64_bitmap_get_cardinality(bitmap) * sizeof(uint64_t));
- * ```
+ * Returns how many bytes were written.
  */
-void bp64_to_uint_array(void *r, uint64_t *ans) {
-    roaring64_bitmap_to_uint64_array((roaring64_bitmap_t *) r, ans);
+size_t bp32_serialize(void *r, char *buf) {
+    return roaring_bitmap_serialize((roaring_bitmap_t *) r, buf);
+}
+
+/**
+ * Read a bitmap written by `bp32_serialize()` (reading up to maxbytes).
+ *
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_deserialize(const char *buf, size_t maxbytes) {
+    return lib_live_track(LIB_LIVE_BITMAP, roaring_bitmap_deserialize_safe(buf, maxbytes));
+}
+
+/**
+ * How many bytes `bp32_frozen_serialize()` writes, 0 on allocation failure.
+ * The bitmap is not modified, shared (copy on write) containers stay shared.
+ */
+size_t bp32_frozen_size_in_bytes(void *r) {
+    return lib_frozen_size(r, LIB_BIT_32);
+}
+
+/**
+ * How many bytes `bp64_frozen_serialize()` writes, 0 on allocation failure.
+ * Side effect: the bitmap is shrunk with `roaring64_bitmap_shrink_to_fit()`
+ * first, the 64-bit frozen format requires it. Its values are unchanged.
+ */
+size_t bp64_frozen_size_in_bytes(void *r) {
+    return lib_frozen_size(r, LIB_BIT_64);
+}
+
+/**
+ * Write a bitmap to a char buffer in the frozen format, the layout of the
+ * containers in memory. The buffer need not be aligned and should refer to at
+ * least `bp32_frozen_size_in_bytes(r)` bytes.
+ *
+ * Returns how many bytes were written, 0 on failure.
+ *
+ * This function is endian-sensitive.
+ */
+size_t bp32_frozen_serialize(void *r, char *buf) {
+    return lib_frozen_serialize(r, buf, LIB_BIT_32);
+}
+
+/**
+ * Write a bitmap to a char buffer in the frozen format, the layout of the
+ * containers in memory. The buffer need not be aligned and should refer to at
+ * least `bp64_frozen_size_in_bytes(r)` bytes. The bitmap is shrunk first, as
+ * by `bp64_frozen_size_in_bytes()`.
+ *
+ * Returns how many bytes were written, 0 on failure.
+ *
+ * This function is endian-sensitive.
+ */
+size_t bp64_frozen_serialize(void *r, char *buf) {
+    return lib_frozen_serialize(r, buf, LIB_BIT_64);
+}
+
+/**
+ * Read a bitmap written by `bp32_frozen_serialize()`. The bytes are copied to
+ * an aligned buffer, so `buf` need not be aligned, and the bitmap is
+ * validated.
+ *
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_frozen_deserialize(const char *buf, size_t maxbytes) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_frozen_deserialize(buf, maxbytes, LIB_BIT_32));
+}
+
+/**
+ * Read a bitmap written by `bp64_frozen_serialize()`. The bytes are copied to
+ * an aligned buffer, so `buf` need not be aligned, and the bitmap is
+ * validated.
+ *
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_frozen_deserialize(const char *buf, size_t maxbytes) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_frozen_deserialize(buf, maxbytes, LIB_BIT_64));
+}
+
+/**
+ * The format of serialized 32-bit bitmap bytes: 0 portable, 1 native
+ * (`bp32_serialize()`), 2 frozen. Bytes of no known format are reported as
+ * portable, whose reader rejects them.
+ */
+int bp32_detect_format(const char *buf, size_t maxbytes) {
+    return lib_format_detect(buf, maxbytes, LIB_BIT_32);
+}
+
+/**
+ * The format of serialized 64-bit bitmap bytes: 0 portable, 2 frozen. Bytes
+ * of no known format are reported as portable, whose reader rejects them.
+ */
+int bp64_detect_format(const char *buf, size_t maxbytes) {
+    return lib_format_detect(buf, maxbytes, LIB_BIT_64);
+}
+
+/**
+ * Convert the bitmap to a sorted array, output in `ans`.
+ *
+ * Caller is responsible to ensure that there is enough memory allocated, e.g.
+ *
+ *     ans = malloc(roaring_bitmap_get_cardinality(bitmap) * sizeof(uint32_t));
+ */
+void bp32_to_uint_array(void *r, uint32_t *ans) {
+    uint64_t start = lib_stats_begin();
+    roaring_bitmap_to_uint32_array((roaring_bitmap_t *) r, ans);
+    lib_stats_end(LIB_STAT_TO_UINT_ARRAY, LIB_BIT_32, start, 0, start == 0 ? 0 : roaring_bitmap_get_cardinality((roaring_bitmap_t *) r) * sizeof(uint32_t));
+}
+
+/**
+ * Convert the bitmap to a sorted array `out`.
+ *
+ * Caller is responsible to ensure that there is enough memory allocated, e.g.
+ * ```
+ * out = malloc(roaring64_bitmap_get_cardinality(bitmap) * sizeof(uint64_t));
+ * ```
+ */
+void bp64_to_uint_array(void *r, uint64_t *ans) {
+    uint64_t start = lib_stats_begin();
+    roaring64_bitmap_to_uint64_array((roaring64_bitmap_t *) r, ans);
+    lib_stats_end(LIB_STAT_TO_UINT_ARRAY, LIB_BIT_64, start, 0, start == 0 ? 0 : roaring64_bitmap_get_cardinality((roaring64_bitmap_t *) r) * sizeof(uint64_t));
+}
+
+/**
+ * Returns the number of bytes of the dense bitset of the bitmap, where bit i
+ * is value i: maximum / 8 + 1, or 0 if the bitmap is empty.
+ */
+size_t bp32_dense_size_in_bytes(void *r) {
+    return lib_dense_size(r, LIB_BIT_32);
+}
+
+/**
+ * Returns the number of bytes of the dense bitset of the bitmap, where bit i
+ * is value i: maximum / 8 + 1, or 0 if the bitmap is empty. Returns SIZE_MAX
+ * if that does not fit in a size_t.
+ */
+size_t bp64_dense_size_in_bytes(void *r) {
+    return lib_dense_size(r, LIB_BIT_64);
+}
+
+/**
+ * Writes the dense bitset of the bitmap, `bp32_dense_size_in_bytes()` bytes,
+ * to `buf`. Bits are numbered from the least significant bit of each byte,
+ * as in the words of a `bitset_t`, or from the most significant one if `msb`
+ * is true, as in Redis SETBIT. Returns false on allocation failure.
+ */
+bool bp32_to_dense(void *r, char *buf, size_t size, bool msb) {
+    return lib_dense_export(r, buf, size, msb, LIB_BIT_32);
+}
+
+/**
+ * Writes the dense bitset of the bitmap, `bp64_dense_size_in_bytes()` bytes,
+ * to `buf`. Bits are numbered from the least significant bit of each byte,
+ * as in the words of a `bitset_t`, or from the most significant one if `msb`
+ * is true, as in Redis SETBIT. Returns false on allocation failure.
+ */
+bool bp64_to_dense(void *r, char *buf, size_t size, bool msb) {
+    return lib_dense_export(r, buf, size, msb, LIB_BIT_64);
+}
+
+/**
+ * Creates a bitmap from the `n` bytes of a dense bitset whose bit i is value
+ * `offset` + i, numbered as in `bp32_to_dense()`. Every 8 KB chunk becomes
+ * an array, bitset or run container directly, chunks are decoded on the
+ * thread pool.
+ * Returns NULL if a set bit is greater than UINT32_MAX or in case of errors.
+ */
+void *bp32_from_dense(const char *bits, size_t n, uint64_t offset, bool msb) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_dense_import(bits, n, offset, msb, LIB_BIT_32));
+}
+
+/**
+ * Creates a bitmap from the `n` bytes of a dense bitset whose bit i is value
+ * `offset` + i, numbered as in `bp64_to_dense()`. Every 8 KB chunk becomes
+ * an array, bitset or run container directly, chunks are decoded on the
+ * thread pool.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_from_dense(const char *bits, size_t n, uint64_t offset, bool msb) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_dense_import(bits, n, offset, msb, LIB_BIT_64));
+}
+
+//----------------------------多线程----------------------------
+
+/**
+ * Sets the number of threads used by the functions that can split their work
+ * (the `*_many` and `*_matrix` functions). The calling thread counts as one,
+ * so 1 (the default) disables the worker pool. Values are clamped to [1, 256].
+ * Functions taking an explicit `threads` argument ignore this setting.
+ */
+void bp_set_threads(uint32_t threads) {
+    lib_pool_set_threads(threads);
+}
+
+/**
+ * Returns the number of threads set by `bp_set_threads()`.
+ */
+uint32_t bp_get_threads(void) {
+    return lib_pool_get_threads();
+}
+
+//----------------------------多位图运算----------------------------
+
+/**
+ * Computes the union of `number` bitmaps and returns a new bitmap.
+ * The containers are merged key by key, keys are split over the worker pool.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_or_many(void **rs, size_t number) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_or_many(rs, number, LIB_BIT_32));
+}
+
+/**
+ * Computes the union of `number` bitmaps and returns a new bitmap.
+ * The containers are merged key by key, keys are split over the worker pool.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_or_many(void **rs, size_t number) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_or_many(rs, number, LIB_BIT_64));
+}
+
+/**
+ * Computes the symmetric difference (xor) of `number` bitmaps and returns a
+ * new bitmap. Keys are split over the worker pool.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_xor_many(void **rs, size_t number) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_xor_many(rs, number, LIB_BIT_32));
+}
+
+/**
+ * Computes the symmetric difference (xor) of `number` bitmaps and returns a
+ * new bitmap. Keys are split over the worker pool.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_xor_many(void **rs, size_t number) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_xor_many(rs, number, LIB_BIT_64));
+}
+
+/**
+ * Computes the intersection of `number` bitmaps and returns a new bitmap.
+ * The keys common to all bitmaps are found first, then the containers of
+ * every common key are intersected smallest first until the result is empty.
+ * Keys are split over the worker pool.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_and_many(void **rs, size_t number) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_and_many(rs, number, LIB_BIT_32));
+}
+
+/**
+ * Computes the intersection of `number` bitmaps and returns a new bitmap.
+ * The keys common to all bitmaps are found first, then the containers of
+ * every common key are intersected smallest first until the result is empty.
+ * Keys are split over the worker pool.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_and_many(void **rs, size_t number) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_and_many(rs, number, LIB_BIT_64));
+}
+
+/**
+ * Computes the size of the intersection of `number` bitmaps without building
+ * it and writes it to `cardinality`. Returns false in case of errors.
+ */
+bool bp32_and_many_cardinality(void **rs, size_t number, uint64_t *cardinality) {
+    return lib_and_many_cardinality(rs, number, LIB_BIT_32, cardinality);
+}
+
+/**
+ * Computes the size of the intersection of `number` bitmaps without building
+ * it and writes it to `cardinality`. Returns false in case of errors.
+ */
+bool bp64_and_many_cardinality(void **rs, size_t number, uint64_t *cardinality) {
+    return lib_and_many_cardinality(rs, number, LIB_BIT_64, cardinality);
+}
+
+/**
+ * Computes the values present in at least `t` of `number` bitmaps and returns
+ * a new bitmap. Keys present in fewer than `t` bitmaps are skipped, the others
+ * are counted with bit sliced counters. Keys are split over the worker pool.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_threshold(void **rs, size_t number, size_t t) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_threshold(rs, number, t, LIB_BIT_32));
+}
+
+/**
+ * Computes the values present in at least `t` of `number` bitmaps and returns
+ * a new bitmap. Keys present in fewer than `t` bitmaps are skipped, the others
+ * are counted with bit sliced counters. Keys are split over the worker pool.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_threshold(void **rs, size_t number, size_t t) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_threshold(rs, number, t, LIB_BIT_64));
+}
+
+/**
+ * Counts in how many of `number` bitmaps every value appears. With `top_k` 0
+ * the result holds every value of the union sorted by value, otherwise the
+ * `top_k` values with the highest counts, ties going to the smaller value.
+ * The counters cover one container key at a time, keys are split over the
+ * worker pool. Returns NULL in case of errors.
+ * The result is read with `bp_occurrences_size()` and `bp_occurrences_export()`.
+ */
+void *bp32_occurrence_counts(void **rs, size_t number, size_t top_k) {
+    return lib_occurrence_counts(rs, number, top_k, LIB_BIT_32);
+}
+
+/**
+ * Counts in how many of `number` bitmaps every value appears. With `top_k` 0
+ * the result holds every value of the union sorted by value, otherwise the
+ * `top_k` values with the highest counts, ties going to the smaller value.
+ * The counters cover one container key at a time, keys are split over the
+ * worker pool. Returns NULL in case of errors.
+ * The result is read with `bp_occurrences_size()` and `bp_occurrences_export()`.
+ */
+void *bp64_occurrence_counts(void **rs, size_t number, size_t top_k) {
+    return lib_occurrence_counts(rs, number, top_k, LIB_BIT_64);
+}
+
+/**
+ * Returns the number of values of a result of `bp32_occurrence_counts()` or
+ * `bp64_occurrence_counts()`.
+ */
+size_t bp_occurrences_size(void *occurrences) {
+    return ((lib_occurrences_t *) occurrences)->size;
+}
+
+/**
+ * Writes the values of a result of `bp32_occurrence_counts()` or
+ * `bp64_occurrence_counts()` to `values` and their counts to `counts`, then
+ * frees the result.
+ */
+void bp_occurrences_export(void *occurrences, uint64_t *values, uint64_t *counts) {
+    lib_occurrences_t *o = (lib_occurrences_t *) occurrences;
+    for (size_t i = 0; i < o->size; i++) {
+        values[i] = o->items[i].value;
+        counts[i] = o->items[i].count;
+    }
+    lib_occurrences_free(o);
+}
+
+/**
+ * Computes the size of the intersection of every pair (rs1[i], rs2[j]) and
+ * writes it to out[i * n2 + j]. `out` must hold n1 * n2 values.
+ * The pairs are split over the worker pool.
+ */
+void bp32_and_cardinality_matrix(void **rs1, size_t n1, void **rs2, size_t n2, uint64_t *out) {
+    uint64_t start = lib_stats_begin();
+    lib_and_cardinality_matrix(rs1, n1, rs2, n2, out, LIB_BIT_32);
+    lib_stats_end(LIB_STAT_AND_CARDINALITY_MATRIX, LIB_BIT_32, start, 0, n1 * n2 * sizeof(uint64_t));
+}
+
+/**
+ * Computes the size of the intersection of every pair (rs1[i], rs2[j]) and
+ * writes it to out[i * n2 + j]. `out` must hold n1 * n2 values.
+ * The pairs are split over the worker pool.
+ */
+void bp64_and_cardinality_matrix(void **rs1, size_t n1, void **rs2, size_t n2, uint64_t *out) {
+    uint64_t start = lib_stats_begin();
+    lib_and_cardinality_matrix(rs1, n1, rs2, n2, out, LIB_BIT_64);
+    lib_stats_end(LIB_STAT_AND_CARDINALITY_MATRIX, LIB_BIT_64, start, 0, n1 * n2 * sizeof(uint64_t));
+}
+
+/**
+ * Writes the portable size in bytes of every bitmap of `rs` to `sizes` and
+ * returns their sum, the size of the buffer needed by
+ * `bp32_portable_serialize_many()`.
+ */
+size_t bp32_portable_size_in_bytes_many(void **rs, size_t number, size_t *sizes) {
+    return lib_portable_size_many(rs, number, sizes, LIB_BIT_32);
+}
+
+/**
+ * Writes the portable size in bytes of every bitmap of `rs` to `sizes` and
+ * returns their sum, the size of the buffer needed by
+ * `bp64_portable_serialize_many()`.
+ */
+size_t bp64_portable_size_in_bytes_many(void **rs, size_t number, size_t *sizes) {
+    return lib_portable_size_many(rs, number, sizes, LIB_BIT_64);
+}
+
+/**
+ * Writes the portable serialization of every bitmap of `rs` back to back to
+ * `buf`. `sizes` must be the output of `bp32_portable_size_in_bytes_many()`.
+ * The bitmaps are split over the worker pool.
+ */
+void bp32_portable_serialize_many(void **rs, size_t number, size_t *sizes, char *buf) {
+    uint64_t start = lib_stats_begin();
+    lib_portable_serialize_many(rs, number, sizes, buf, LIB_BIT_32);
+    size_t written = 0;
+    for (size_t i = 0; start != 0 && i < number; i++) {
+        written += sizes[i];
+    }
+    lib_stats_end(LIB_STAT_PORTABLE_SERIALIZE_MANY, LIB_BIT_32, start, 0, written);
+}
+
+/**
+ * Writes the portable serialization of every bitmap of `rs` back to back to
+ * `buf`. `sizes` must be the output of `bp64_portable_size_in_bytes_many()`.
+ * The bitmaps are split over the worker pool.
+ */
+void bp64_portable_serialize_many(void **rs, size_t number, size_t *sizes, char *buf) {
+    uint64_t start = lib_stats_begin();
+    lib_portable_serialize_many(rs, number, sizes, buf, LIB_BIT_64);
+    size_t written = 0;
+    for (size_t i = 0; start != 0 && i < number; i++) {
+        written += sizes[i];
+    }
+    lib_stats_end(LIB_STAT_PORTABLE_SERIALIZE_MANY, LIB_BIT_64, start, 0, written);
+}
+
+/**
+ * Finds the `k` bitmaps of `candidates` most similar to `r` and writes their
+ * positions and scores to `indices` and `scores`, best first, ties going to
+ * the smaller position. `metric` is 0 for the Jaccard index, 1 for the overlap
+ * coefficient, the score is 0 when it is undefined. Candidates are visited by
+ * decreasing upper bound computed from the cardinalities and the search stops
+ * once no bound can reach the k-th score, intersections run on the worker pool.
+ * Returns the number of results, at most `k`, or SIZE_MAX in case of errors.
+ */
+size_t bp32_most_similar(void *r, void **candidates, size_t number, size_t k, int metric, uint64_t *indices, double *scores) {
+    return lib_most_similar(r, candidates, number, k, metric, indices, scores, LIB_BIT_32);
+}
+
+/**
+ * Finds the `k` bitmaps of `candidates` most similar to `r` and writes their
+ * positions and scores to `indices` and `scores`, best first, ties going to
+ * the smaller position. `metric` is 0 for the Jaccard index, 1 for the overlap
+ * coefficient, the score is 0 when it is undefined. Candidates are visited by
+ * decreasing upper bound computed from the cardinalities and the search stops
+ * once no bound can reach the k-th score, intersections run on the worker pool.
+ * Returns the number of results, at most `k`, or SIZE_MAX in case of errors.
+ */
+size_t bp64_most_similar(void *r, void **candidates, size_t number, size_t k, int metric, uint64_t *indices, double *scores) {
+    return lib_most_similar(r, candidates, number, k, metric, indices, scores, LIB_BIT_64);
+}
+
+//----------------------------位图仓库----------------------------
+
+/**
+ * Writes `number` bitmaps to a new store file at `path`, replacing it. The key
+ * of bitmap `i` is the next `key_lengths[i]` bytes of `keys` (the keys are
+ * concatenated). Keys must be distinct. Every bitmap is written in the frozen
+ * format at an aligned offset together with its CRC32C, followed by a table of
+ * contents sorted by key. 64-bit bitmaps are shrunk to fit first, which the
+ * frozen format requires and which does not change their content.
+ *
+ * Returns false on failure.
+ */
+bool bp32_store_write(const char *path, const char *keys, size_t *key_lengths, void **rs, size_t number) {
+    return lib_store_write(path, keys, key_lengths, rs, number, LIB_BIT_32);
+}
+
+/**
+ * See `bp32_store_write()`.
+ */
+bool bp64_store_write(const char *path, const char *keys, size_t *key_lengths, void **rs, size_t number) {
+    return lib_store_write(path, keys, key_lengths, rs, number, LIB_BIT_64);
+}
+
+/**
+ * Opens a store file written by `bp32_store_write()` or `bp64_store_write()`.
+ * The file is mapped into memory, only its header and table of contents are
+ * read and checked. The file must not be modified while it is open.
+ * Caller is responsible for closing the store with `bp_store_close()`.
+ * The returned pointer may be NULL if the file cannot be read or is corrupted.
+ */
+void *bp_store_open(const char *path) {
+    return lib_store_open(path);
+}
+
+/**
+ * Closes a store opened by `bp_store_open()`.
+ */
+void bp_store_close(void *s) {
+    lib_store_close((lib_store_t *) s);
+}
+
+/**
+ * Returns the width (32 or 64) of the bitmaps of the store.
+ */
+uint32_t bp_store_bit(void *s) {
+    return (uint32_t) ((lib_store_t *) s)->bit;
+}
+
+/**
+ * Returns the number of bitmaps of the store.
+ */
+uint64_t bp_store_count(void *s) {
+    return ((lib_store_t *) s)->count;
+}
+
+/**
+ * Returns the index of the bitmap stored under the `key_length` bytes at
+ * `key`, or -1. The table of contents is binary searched.
+ */
+int64_t bp_store_find(void *s, const char *key, size_t key_length) {
+    return lib_store_find((lib_store_t *) s, key, key_length);
+}
+
+/**
+ * Returns the key of bitmap `index` (the keys are sorted) and writes its
+ * length to `key_length`. The key is not null terminated and is valid until
+ * the store is closed.
+ */
+const char *bp_store_key(void *s, uint64_t index, size_t *key_length) {
+    const lib_store_t *store = (const lib_store_t *) s;
+    *key_length = store->entries[index].key_length;
+    return store->keys + store->entries[index].key_offset;
+}
+
+/**
+ * Returns a new bitmap holding a copy of bitmap `index`. Its CRC32C is
+ * checked first and only its own bytes of the file are read.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL if the checksum does not match or in case
+ * of errors.
+ */
+void *bp_store_get(void *s, uint64_t index) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_store_get((lib_store_t *) s, index));
+}
+
+/**
+ * Checks the CRC32C of every bitmap of the store, returns false if any of
+ * them does not match.
+ */
+bool bp_store_verify(void *s) {
+    return lib_store_verify((lib_store_t *) s);
+}
+
+//----------------------------硬件加速----------------------------
+
+/**
+ * Returns the SIMD container kernels compiled into the library as a bit set:
+ * 1 for AVX2, 2 for AVX-512. Always 0 outside x64.
+ */
+int bp_simd_compiled(void) {
+    return lib_simd_compiled();
+}
+
+/**
+ * Returns the SIMD container kernels dispatched to on this cpu, a subset of
+ * `bp_simd_compiled()` as reported by `croaring_hardware_support()`.
+ */
+int bp_simd_active(void) {
+    return lib_simd_active();
+}
+
+//----------------------------调用统计----------------------------
+
+/**
+ * Turns the call counters on or off, they are off by default. When on, the
+ * shims moving data across the FFI boundary (add_many, remove_many,
+ * iterator_read, to_uint_array, the portable (de)serializers and
+ * and_cardinality_matrix) count their calls, the time spent natively and the
+ * bytes read from and written to caller buffers.
+ */
+void bp_stats_enable(bool enabled) {
+    atomic_store(&lib_stats_enabled, enabled);
+}
+
+/**
+ * Returns true if the call counters are on.
+ */
+bool bp_stats_enabled(void) {
+    return atomic_load(&lib_stats_enabled);
+}
+
+/**
+ * Sets all call counters to 0.
+ */
+void bp_stats_reset(void) {
+    lib_stats_reset();
+}
+
+/**
+ * Returns the number of counted shims, per bit width.
+ */
+size_t bp_stats_size(void) {
+    return LIB_STAT_COUNT;
+}
+
+/**
+ * Returns the name of counted shim `i`, without the bp32_ or bp64_ prefix.
+ */
+const char *bp_stats_name(size_t i) {
+    return i < LIB_STAT_COUNT ? lib_stat_names[i] : NULL;
+}
+
+/**
+ * Writes the counters of the shims of the given width (32 or 64) to `out`,
+ * which must hold 4 * `bp_stats_size()` values: for shim `i`, out[4 * i] is the
+ * number of calls, then the nanoseconds spent, the bytes read from and the
+ * bytes written to caller buffers.
+ */
+void bp_stats_read(uint32_t bit, uint64_t *out) {
+    lib_stats_read((int) bit, out);
+}
+
+//----------------------------原生内存----------------------------
+
+/**
+ * Writes the native memory gauges to `out`, which must hold 5 values: the bytes
+ * currently allocated through CRoaring (usable sizes as reported by the
+ * allocator, excluding its bookkeeping), the highest value it reached (summed
+ * over the threads, an upper bound when several threads allocate), the number
+ * of allocated blocks, then the number of live bitmaps and iterators returned
+ * by the shims and not freed yet. The counters are process wide and cover
+ * every thread of the pool.
+ */
+void bp_memory_read(int64_t *out) {
+    lib_memory_sum(&out[0], &out[1], &out[2]);
+    out[3] = atomic_load_explicit(&lib_live[LIB_LIVE_BITMAP], memory_order_relaxed);
+    out[4] = atomic_load_explicit(&lib_live[LIB_LIVE_ITERATOR], memory_order_relaxed);
+}
+
+/**
+ * Sets the peak of the allocated bytes to the current value.
+ */
+void bp_memory_reset_peak(void) {
+    lib_memory_reset_peak();
+}
+
+//----------------------------位切片索引----------------------------
+
+/**
+ * Sets the value of `n` columns of the bit-sliced index made of `depth` slices
+ * (slice i holds the columns whose value has bit i set) and the existence
+ * bitmap `ebm`. When a column is given several times the last value wins.
+ * Returns false, without changing anything, if a value does not fit in
+ * `depth` bits, a column does not fit in 32 bits or on allocation failure.
+ */
+bool bp32_bsi_set_many(void **slices, size_t depth, void *ebm, const uint64_t *columns, const uint64_t *values, size_t n) {
+    return lib_bsi_set_many(slices, depth, ebm, columns, values, n, LIB_BIT_32);
+}
+
+/**
+ * Returns true if `column` has a value in the bit-sliced index and stores it
+ * into `value`.
+ */
+bool bp32_bsi_get(void **slices, size_t depth, void *ebm, uint64_t column, uint64_t *value) {
+    return lib_bsi_get(slices, depth, ebm, column, value, LIB_BIT_32);
+}
+
+/**
+ * Returns the columns of the bit-sliced index (restricted to `found` if not
+ * NULL) whose value compares to `value` according to `op`: 0 ==, 1 !=, 2 <,
+ * 3 <=, 4 >, 5 >=. Costs at most `depth` bitmap operations and stops as soon
+ * as no column is equal to `value` on the slices seen so far.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_bsi_compare(void **slices, size_t depth, void *ebm, void *found, int op, uint64_t value) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_bsi_compare(slices, depth, ebm, found, op, value, LIB_BIT_32));
+}
+
+/**
+ * Returns the columns of the bit-sliced index (restricted to `found` if not
+ * NULL) whose value is in [min, max].
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_bsi_between(void **slices, size_t depth, void *ebm, void *found, uint64_t min, uint64_t max) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_bsi_between(slices, depth, ebm, found, min, max, LIB_BIT_32));
+}
+
+/**
+ * Sums the values of the columns of the bit-sliced index (restricted to
+ * `found` if not NULL) into `sum` and counts them into `count`, using one
+ * intersection cardinality per slice. Returns false on allocation failure or
+ * if the sum does not fit in an int64_t.
+ */
+bool bp32_bsi_sum(void **slices, size_t depth, void *ebm, void *found, int64_t *sum, uint64_t *count) {
+    return lib_bsi_sum(slices, depth, ebm, found, sum, count, LIB_BIT_32);
+}
+
+/**
+ * Returns the `k` columns of the bit-sliced index (restricted to `found` if
+ * not NULL) with the largest values, or all of them if there are fewer. Among
+ * columns with equal values the smallest columns win.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_bsi_top_k(void **slices, size_t depth, void *ebm, void *found, uint64_t k) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_bsi_top_k(slices, depth, ebm, found, k, LIB_BIT_32));
+}
+
+/**
+ * Sets the value of `n` columns of the bit-sliced index made of `depth` slices
+ * (slice i holds the columns whose value has bit i set) and the existence
+ * bitmap `ebm`. When a column is given several times the last value wins.
+ * Returns false, without changing anything, if a value does not fit in
+ * `depth` bits or on allocation failure.
+ */
+bool bp64_bsi_set_many(void **slices, size_t depth, void *ebm, const uint64_t *columns, const uint64_t *values, size_t n) {
+    return lib_bsi_set_many(slices, depth, ebm, columns, values, n, LIB_BIT_64);
+}
+
+/**
+ * Returns true if `column` has a value in the bit-sliced index and stores it
+ * into `value`.
+ */
+bool bp64_bsi_get(void **slices, size_t depth, void *ebm, uint64_t column, uint64_t *value) {
+    return lib_bsi_get(slices, depth, ebm, column, value, LIB_BIT_64);
+}
+
+/**
+ * Returns the columns of the bit-sliced index (restricted to `found` if not
+ * NULL) whose value compares to `value` according to `op`: 0 ==, 1 !=, 2 <,
+ * 3 <=, 4 >, 5 >=. Costs at most `depth` bitmap operations and stops as soon
+ * as no column is equal to `value` on the slices seen so far.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_bsi_compare(void **slices, size_t depth, void *ebm, void *found, int op, uint64_t value) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_bsi_compare(slices, depth, ebm, found, op, value, LIB_BIT_64));
+}
+
+/**
+ * Returns the columns of the bit-sliced index (restricted to `found` if not
+ * NULL) whose value is in [min, max].
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_bsi_between(void **slices, size_t depth, void *ebm, void *found, uint64_t min, uint64_t max) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_bsi_between(slices, depth, ebm, found, min, max, LIB_BIT_64));
+}
+
+/**
+ * Sums the values of the columns of the bit-sliced index (restricted to
+ * `found` if not NULL) into `sum` and counts them into `count`, using one
+ * intersection cardinality per slice. Returns false on allocation failure or
+ * if the sum does not fit in an int64_t.
+ */
+bool bp64_bsi_sum(void **slices, size_t depth, void *ebm, void *found, int64_t *sum, uint64_t *count) {
+    return lib_bsi_sum(slices, depth, ebm, found, sum, count, LIB_BIT_64);
+}
+
+/**
+ * Returns the `k` columns of the bit-sliced index (restricted to `found` if
+ * not NULL) with the largest values, or all of them if there are fewer. Among
+ * columns with equal values the smallest columns win.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_bsi_top_k(void **slices, size_t depth, void *ebm, void *found, uint64_t k) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_bsi_top_k(slices, depth, ebm, found, k, LIB_BIT_64));
+}
+
+//----------------------------位图索引----------------------------
+
+/**
+ * Builds the bitmap index of `n` (row, value) pairs laid out as 2 * n int64 in
+ * machine byte order, in one pass: rows are grouped by value, then the bitmap
+ * of every distinct value is filled on the pool. With `encoding` 0 (equality)
+ * bitmap i holds the rows whose value is the i-th smallest value, with 1
+ * (range) the rows whose value is lower than or equal to it.
+ * Every row holds one value. Returns NULL on allocation failure, if a row
+ * repeats or if a row is negative or does not fit in 32 bits.
+ * The result is read with `bp_index_size()` and `bp_index_export()`.
+ */
+void *bp32_index_build(const char *pairs, size_t n, int encoding) {
+    return lib_index_build(pairs, n, encoding, LIB_BIT_32);
+}
+
+/**
+ * Returns the rows of the values at the sorted positions [runs[2 * i],
+ * runs[2 * i + 1]] of the `n` bitmaps of an index, for `number` sorted
+ * disjoint runs. Equality encoded bitmaps of all the runs are merged with one
+ * `bp32_or_many()`, range encoded ones cost one andnot per run first.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp32_index_union(void **bitmaps, size_t n, const uint64_t *runs, size_t number, int encoding) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_index_union(bitmaps, n, runs, number, encoding, LIB_BIT_32));
+}
+
+/**
+ * Builds the bitmap index of `n` (row, value) pairs laid out as 2 * n int64 in
+ * machine byte order, in one pass: rows are grouped by value, then the bitmap
+ * of every distinct value is filled on the pool. With `encoding` 0 (equality)
+ * bitmap i holds the rows whose value is the i-th smallest value, with 1
+ * (range) the rows whose value is lower than or equal to it.
+ * Every row holds one value. Returns NULL on allocation failure, if a row
+ * repeats or if a row is negative.
+ * The result is read with `bp_index_size()` and `bp_index_export()`.
+ */
+void *bp64_index_build(const char *pairs, size_t n, int encoding) {
+    return lib_index_build(pairs, n, encoding, LIB_BIT_64);
+}
+
+/**
+ * Returns the rows of the values at the sorted positions [runs[2 * i],
+ * runs[2 * i + 1]] of the `n` bitmaps of an index, for `number` sorted
+ * disjoint runs. Equality encoded bitmaps of all the runs are merged with one
+ * `bp64_or_many()`, range encoded ones cost one andnot per run first.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL in case of errors.
+ */
+void *bp64_index_union(void **bitmaps, size_t n, const uint64_t *runs, size_t number, int encoding) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_index_union(bitmaps, n, runs, number, encoding, LIB_BIT_64));
+}
+
+/**
+ * Returns the number of distinct values of an index built by
+ * `bp32_index_build()` or `bp64_index_build()`.
+ */
+size_t bp_index_size(void *index) {
+    return ((lib_index_t *) index)->size;
+}
+
+/**
+ * Writes the sorted distinct values of an index to `values` and their bitmaps
+ * to `bitmaps`, then frees the index. The caller owns the bitmaps.
+ */
+void bp_index_export(void *index, int64_t *values, void **bitmaps) {
+    lib_index_t *x = (lib_index_t *) index;
+    for (size_t i = 0; i < x->size; i++) {
+        values[i] = x->values[i];
+        bitmaps[i] = lib_live_track(LIB_LIVE_BITMAP, x->bitmaps[i]);
+    }
+    x->size = 0;
+    lib_index_free(x);
+}
+
+/**
+ * Frees an index that was not exported, with its bitmaps.
+ */
+void bp_index_free(void *index) {
+    lib_index_free((lib_index_t *) index);
+}
+
+//----------------------------表达式求值----------------------------
+
+/**
+ * Evaluates a boolean expression over `number` bitmaps and returns a new
+ * bitmap. `plan` holds `size` int32 in prefix order: 0 i is operands[i],
+ * 1 n ... is the intersection of the n following nodes, 2 n ... their union,
+ * 3 n ... their symmetric difference and 4 x is the complement of x, which is
+ * only allowed as a child of an intersection that has a child that is not a
+ * complement. The whole tree runs natively: intersections start from their
+ * smallest operands, work in place and stop at the first empty intermediate,
+ * unions and symmetric differences merge all their children at once.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL if the plan is malformed or in case of
+ * errors.
+ */
+void *bp32_evaluate(const int32_t *plan, size_t size, void **operands, size_t number) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_expr_evaluate(plan, size, operands, number, LIB_BIT_32));
+}
+
+/**
+ * Evaluates a boolean expression over `number` bitmaps and returns a new
+ * bitmap. `plan` holds `size` int32 in prefix order: 0 i is operands[i],
+ * 1 n ... is the intersection of the n following nodes, 2 n ... their union,
+ * 3 n ... their symmetric difference and 4 x is the complement of x, which is
+ * only allowed as a child of an intersection that has a child that is not a
+ * complement. The whole tree runs natively: intersections start from their
+ * smallest operands, work in place and stop at the first empty intermediate,
+ * unions and symmetric differences merge all their children at once.
+ * Caller is responsible for freeing the result.
+ * The returned pointer may be NULL if the plan is malformed or in case of
+ * errors.
+ */
+void *bp64_evaluate(const int32_t *plan, size_t size, void **operands, size_t number) {
+    return lib_live_track(LIB_LIVE_BITMAP, lib_expr_evaluate(plan, size, operands, number, LIB_BIT_64));
 }
\ No newline at end of file
@@ -0,0 +1,232 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Native memory gauges.
+ *
+ * A CRoaring memory hook is installed when the library is loaded. It adds
+ * nothing to the blocks: their size is read back from the allocator
+ * (`malloc_usable_size()`, `malloc_size()` or `_msize()`), so the gauges
+ * count the usable size of every block, which includes the rounding of the
+ * allocator but not its own bookkeeping. Aligned blocks come from
+ * `posix_memalign()`; on Windows, whose aligned blocks cannot be measured,
+ * they are over-allocated by the alignment with the address returned by
+ * malloc kept right below the aligned address, as `_aligned_malloc()` does.
+ *
+ * Every thread counts into its own cache line sized shard, which only it
+ * writes, so an allocation or a free costs one size lookup and a few relaxed
+ * loads and stores, without atomic read-modify-writes or contention between
+ * the pool threads. The threads past the first LIB_MEMORY_SHARDS - 1 share
+ * the last shard, with atomic adds. The shards are summed when read. Each
+ * shard keeps the peak of its own bytes and the reported peak is the sum of
+ * the shard peaks: an upper bound of the true peak, exact while a single
+ * thread allocates. On a loop that only creates and frees small containers
+ * this costs about 20% over the plain allocator; set operations and
+ * serialization, which do more work per block, barely notice it.
+ *
+ * Besides the bytes, the number of live objects handed out by the shims
+ * (bitmaps, iterators) is counted, which makes objects that are never freed
+ * visible.
+ */
+
+#if defined(_WIN32)
+#include <malloc.h>
+#define lib_memory_usable(p) _msize(p)
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define lib_memory_usable(p) malloc_size(p)
+#else
+#include <malloc.h>
+#define lib_memory_usable(p) malloc_usable_size(p)
+#endif
+
+#define LIB_MEMORY_SHARDS 64
+
+enum {
+    LIB_LIVE_BITMAP,
+    LIB_LIVE_ITERATOR,
+    LIB_LIVE_COUNT
+};
+
+typedef struct {
+    _Alignas(64) _Atomic int64_t bytes;  // one cache line per shard
+    _Atomic int64_t blocks;
+    _Atomic int64_t peak;  // highest value of bytes
+} lib_memory_shard_t;
+
+static lib_memory_shard_t lib_memory_shards[LIB_MEMORY_SHARDS];
+static _Atomic uint32_t lib_memory_next_shard;
+static _Thread_local lib_memory_shard_t *lib_memory_shard = NULL;
+static _Atomic int64_t lib_live[LIB_LIVE_COUNT];
+
+/**
+ * Adds to the shard of the calling thread. The shard of a single thread is
+ * only written by it, relaxed loads and stores keep it readable by others.
+ */
+static inline void lib_memory_add(int64_t bytes, int64_t blocks) {
+    lib_memory_shard_t *shard = lib_memory_shard;
+    if (shard == NULL) {
+        uint32_t i = atomic_fetch_add_explicit(&lib_memory_next_shard, 1, memory_order_relaxed);
+        shard = lib_memory_shard = &lib_memory_shards[i < LIB_MEMORY_SHARDS ? i : LIB_MEMORY_SHARDS - 1];
+    }
+    int64_t now;
+    if (shard != &lib_memory_shards[LIB_MEMORY_SHARDS - 1]) {
+        now = atomic_load_explicit(&shard->bytes, memory_order_relaxed) + bytes;
+        atomic_store_explicit(&shard->bytes, now, memory_order_relaxed);
+        atomic_store_explicit(&shard->blocks, atomic_load_explicit(&shard->blocks, memory_order_relaxed) + blocks,
+                              memory_order_relaxed);
+    } else {
+        now = atomic_fetch_add_explicit(&shard->bytes, bytes, memory_order_relaxed) + bytes;
+        atomic_fetch_add_explicit(&shard->blocks, blocks, memory_order_relaxed);
+    }
+    if (now > atomic_load_explicit(&shard->peak, memory_order_relaxed)) {
+        atomic_store_explicit(&shard->peak, now, memory_order_relaxed);
+    }
+}
+
+/**
+ * Sums the shards: the allocated bytes, the sum of the shard peaks and the
+ * allocated blocks.
+ */
+static void lib_memory_sum(int64_t *bytes, int64_t *peak, int64_t *blocks) {
+    *bytes = *peak = *blocks = 0;
+    for (size_t i = 0; i < LIB_MEMORY_SHARDS; i++) {
+        *bytes += atomic_load_explicit(&lib_memory_shards[i].bytes, memory_order_relaxed);
+        *peak += atomic_load_explicit(&lib_memory_shards[i].peak, memory_order_relaxed);
+        *blocks += atomic_load_explicit(&lib_memory_shards[i].blocks, memory_order_relaxed);
+    }
+}
+
+/**
+ * Sets the peak of every shard to its current bytes.
+ */
+static void lib_memory_reset_peak(void) {
+    for (size_t i = 0; i < LIB_MEMORY_SHARDS; i++) {
+        atomic_store_explicit(&lib_memory_shards[i].peak,
+                              atomic_load_explicit(&lib_memory_shards[i].bytes, memory_order_relaxed),
+                              memory_order_relaxed);
+    }
+}
+
+static void *lib_memory_malloc(size_t size) {
+    void *p = malloc(size);
+    if (p != NULL) {
+        lib_memory_add((int64_t) lib_memory_usable(p), 1);
+    }
+    return p;
+}
+
+static void *lib_memory_calloc(size_t n, size_t size) {
+    void *p = calloc(n, size);
+    if (p != NULL) {
+        lib_memory_add((int64_t) lib_memory_usable(p), 1);
+    }
+    return p;
+}
+
+static void *lib_memory_realloc(void *p, size_t size) {
+    if (p == NULL) {
+        return lib_memory_malloc(size);
+    }
+    int64_t old = (int64_t) lib_memory_usable(p);
+    void *q = realloc(p, size);
+    if (q != NULL) {
+        lib_memory_add((int64_t) lib_memory_usable(q) - old, 0);
+    } else if (size == 0) {
+        lib_memory_add(-old, -1);  // freed
+    }
+    return q;
+}
+
+static void lib_memory_free(void *p) {
+    if (p == NULL) {
+        return;
+    }
+    lib_memory_add(-(int64_t) lib_memory_usable(p), -1);
+    free(p);
+}
+
+#ifdef _WIN32
+/**
+ * The block is over-allocated by `alignment` bytes plus a pointer, the address
+ * returned by malloc is stored right below the returned address.
+ */
+static void *lib_memory_aligned_malloc(size_t alignment, size_t size) {
+    if (alignment < sizeof(void *) || size > SIZE_MAX - sizeof(void *) - alignment) {
+        return NULL;
+    }
+    char *base = (char *) lib_memory_malloc(size + sizeof(void *) + alignment);
+    if (base == NULL) {
+        return NULL;
+    }
+    uintptr_t p = ((uintptr_t) base + sizeof(void *) + alignment - 1) & ~(uintptr_t) (alignment - 1);
+    memcpy((char *) p - sizeof(void *), &base, sizeof(void *));
+    return (void *) p;
+}
+
+static void lib_memory_aligned_free(void *p) {
+    if (p == NULL) {
+        return;
+    }
+    void *base;
+    memcpy(&base, (char *) p - sizeof(void *), sizeof(void *));
+    lib_memory_free(base);
+}
+#else
+static void *lib_memory_aligned_malloc(size_t alignment, size_t size) {
+    void *p;
+    if (posix_memalign(&p, alignment, size) != 0) {
+        return NULL;
+    }
+    lib_memory_add((int64_t) lib_memory_usable(p), 1);
+    return p;
+}
+
+static void lib_memory_aligned_free(void *p) {
+    lib_memory_free(p);
+}
+#endif
+
+__attribute__((constructor)) static void lib_memory_init(void) {
+    roaring_memory_t hook = {
+        .malloc = lib_memory_malloc,
+        .realloc = lib_memory_realloc,
+        .calloc = lib_memory_calloc,
+        .free = lib_memory_free,
+        .aligned_malloc = lib_memory_aligned_malloc,
+        .aligned_free = lib_memory_aligned_free,
+    };
+    roaring_init_memory_hook(hook);
+}
+
+/**
+ * Counts a live object of the given kind, returns `p`. NULL is not counted.
+ */
+static inline void *lib_live_track(int kind, void *p) {
+    if (p != NULL) {
+        atomic_fetch_add_explicit(&lib_live[kind], 1, memory_order_relaxed);
+    }
+    return p;
+}
+
+/**
+ * Uncounts a live object of the given kind, before it is freed.
+ */
+static inline void lib_live_untrack(int kind, const void *p) {
+    if (p != NULL) {
+        atomic_fetch_sub_explicit(&lib_live[kind], 1, memory_order_relaxed);
+    }
+}
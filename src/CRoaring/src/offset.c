@@ -0,0 +1,129 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Adding a constant to every value of a 64-bit bitmap.
+ *
+ * CRoaring only has `roaring_bitmap_add_offset()` for 32-bit bitmaps, this is
+ * the same algorithm over the container list: when the offset is a multiple
+ * of 65536 every container is copied to its new key, otherwise the values of
+ * a container are shifted into the low part for the key plus the offset and
+ * the high part for the next key, which is merged with the low part of the
+ * following container.
+ */
+
+/**
+ * Appends `c` at `key`, unlike `lib_list_push()` it does not look at the
+ * cardinality: copies and shifted parts are never empty. `c` is consumed.
+ */
+static bool lib_offset_append(lib_list_t *list, uint64_t key, container_t *c, uint8_t typecode) {
+    if (!lib_list_reserve(list, list->size + 1)) {
+        container_free(c, typecode);
+        return false;
+    }
+    lib_entry_t *e = &list->entries[list->size++];
+    e->key = key;
+    e->container = c;
+    e->typecode = typecode;
+    return true;
+}
+
+/**
+ * Appends `c` at `key`, or merges it into the last container if it has the
+ * same key. `c` is consumed. Returns false on allocation failure, the last
+ * container is then left as it was.
+ */
+static bool lib_offset_merge(lib_list_t *list, uint64_t key, container_t *c, uint8_t typecode) {
+    if (list->size == 0 || list->entries[list->size - 1].key != key) {
+        return lib_offset_append(list, key, c, typecode);
+    }
+    lib_entry_t *last = &list->entries[list->size - 1];
+    uint8_t type;
+    container_t *merged = container_ior(last->container, last->typecode, c, typecode, &type);
+    if (merged == NULL) {
+        container_free(c, typecode);
+        return false;
+    }
+    if (merged != last->container) {
+        container_free(last->container, last->typecode);
+    }
+    last->container = merged;
+    last->typecode = type;
+    container_free(c, typecode);
+    return true;
+}
+
+/**
+ * Adds `offset` to every value of a 64-bit bitmap and returns a new bitmap.
+ * Values that would fall outside [0, 2^64) are dropped. Returns NULL on
+ * allocation failure.
+ */
+static void *lib_add_offset64(const roaring64_bitmap_t *r, int64_t offset) {
+    if (offset == 0) {
+        return roaring64_bitmap_copy(r);
+    }
+    const int64_t keys = INT64_C(1) << 48;
+    int64_t shift = offset >> 16;
+    uint16_t in = (uint16_t) (offset - shift * 65536);
+    lib_list_t list = {0};
+    lib_list_t out = {0};
+    bool ok = lib_list_view(&list, r, LIB_BIT_64);
+    for (size_t i = 0; ok && i < list.size; i++) {
+        const lib_entry_t *e = &list.entries[i];
+        int64_t key = (int64_t) e->key + shift;
+        if (in == 0) {
+            if (key >= 0 && key < keys) {
+                container_t *c = container_clone(e->container, e->typecode);
+                ok = c != NULL && lib_offset_append(&out, (uint64_t) key, c, e->typecode);
+            }
+            continue;
+        }
+        container_t *lo = NULL;
+        container_t *hi = NULL;
+        container_t **lo_ptr = key >= 0 && key < keys ? &lo : NULL;
+        container_t **hi_ptr = key + 1 >= 0 && key + 1 < keys ? &hi : NULL;
+        if (lo_ptr == NULL && hi_ptr == NULL) {
+            continue;
+        }
+        container_add_offset(e->container, e->typecode, lo_ptr, hi_ptr, in);
+        if (lo != NULL) {
+            ok = lib_offset_merge(&out, (uint64_t) key, lo, e->typecode);
+        }
+        if (hi != NULL && ok) {
+            ok = lib_offset_append(&out, (uint64_t) key + 1, hi, e->typecode);
+        } else if (hi != NULL) {
+            container_free(hi, e->typecode);
+        }
+    }
+    lib_list_free(&list);
+    if (!ok) {
+        lib_list_free_containers(&out);
+        return NULL;
+    }
+    // a shifted bitset counts its values but may hold too few of them to stay a bitset
+    for (size_t i = 0; in != 0 && i < out.size; i++) {
+        lib_entry_t *e = &out.entries[i];
+        e->container = container_repair_after_lazy(e->container, &e->typecode);
+        if (e->container == NULL) {
+            // the repair already freed the bitset
+            *e = out.entries[--out.size];
+            lib_list_free_containers(&out);
+            return NULL;
+        }
+    }
+    return lib_list_to_bitmap(&out, LIB_BIT_64);
+}
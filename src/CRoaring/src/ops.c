@@ -0,0 +1,175 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Bit width independent wrappers of the CRoaring bitmap functions, for the
+ * algorithms that work on whole bitmaps rather than on their containers.
+ * Values are passed as uint64_t for both widths, a 32-bit bitmap only looks at
+ * the low 32 bits.
+ */
+
+static void *lib_bitmap_create(int bit) {
+    if (bit == LIB_BIT_32) {
+        return roaring_bitmap_create();
+    }
+    return roaring64_bitmap_create();
+}
+
+static void *lib_bitmap_copy(const void *r, int bit) {
+    if (bit == LIB_BIT_32) {
+        return roaring_bitmap_copy((const roaring_bitmap_t *) r);
+    }
+    return roaring64_bitmap_copy((const roaring64_bitmap_t *) r);
+}
+
+static void lib_bitmap_free(void *r, int bit) {
+    if (r == NULL) {
+        return;
+    }
+    if (bit == LIB_BIT_32) {
+        roaring_bitmap_free((roaring_bitmap_t *) r);
+    } else {
+        roaring64_bitmap_free((roaring64_bitmap_t *) r);
+    }
+}
+
+static uint64_t lib_bitmap_cardinality(const void *r, int bit) {
+    if (bit == LIB_BIT_32) {
+        return roaring_bitmap_get_cardinality((const roaring_bitmap_t *) r);
+    }
+    return roaring64_bitmap_get_cardinality((const roaring64_bitmap_t *) r);
+}
+
+static bool lib_bitmap_is_empty(const void *r, int bit) {
+    if (bit == LIB_BIT_32) {
+        return roaring_bitmap_is_empty((const roaring_bitmap_t *) r);
+    }
+    return roaring64_bitmap_is_empty((const roaring64_bitmap_t *) r);
+}
+
+static bool lib_bitmap_contains(const void *r, uint64_t x, int bit) {
+    if (bit == LIB_BIT_32) {
+        return x <= UINT32_MAX && roaring_bitmap_contains((const roaring_bitmap_t *) r, (uint32_t) x);
+    }
+    return roaring64_bitmap_contains((const roaring64_bitmap_t *) r, x);
+}
+
+static void *lib_bitmap_and(const void *r1, const void *r2, int bit) {
+    if (bit == LIB_BIT_32) {
+        return roaring_bitmap_and((const roaring_bitmap_t *) r1, (const roaring_bitmap_t *) r2);
+    }
+    return roaring64_bitmap_and((const roaring64_bitmap_t *) r1, (const roaring64_bitmap_t *) r2);
+}
+
+static void *lib_bitmap_andnot(const void *r1, const void *r2, int bit) {
+    if (bit == LIB_BIT_32) {
+        return roaring_bitmap_andnot((const roaring_bitmap_t *) r1, (const roaring_bitmap_t *) r2);
+    }
+    return roaring64_bitmap_andnot((const roaring64_bitmap_t *) r1, (const roaring64_bitmap_t *) r2);
+}
+
+static void lib_bitmap_and_inplace(void *r1, const void *r2, int bit) {
+    if (bit == LIB_BIT_32) {
+        roaring_bitmap_and_inplace((roaring_bitmap_t *) r1, (const roaring_bitmap_t *) r2);
+    } else {
+        roaring64_bitmap_and_inplace((roaring64_bitmap_t *) r1, (const roaring64_bitmap_t *) r2);
+    }
+}
+
+static void lib_bitmap_andnot_inplace(void *r1, const void *r2, int bit) {
+    if (bit == LIB_BIT_32) {
+        roaring_bitmap_andnot_inplace((roaring_bitmap_t *) r1, (const roaring_bitmap_t *) r2);
+    } else {
+        roaring64_bitmap_andnot_inplace((roaring64_bitmap_t *) r1, (const roaring64_bitmap_t *) r2);
+    }
+}
+
+static void lib_bitmap_or_inplace(void *r1, const void *r2, int bit) {
+    if (bit == LIB_BIT_32) {
+        roaring_bitmap_or_inplace((roaring_bitmap_t *) r1, (const roaring_bitmap_t *) r2);
+    } else {
+        roaring64_bitmap_or_inplace((roaring64_bitmap_t *) r1, (const roaring64_bitmap_t *) r2);
+    }
+}
+
+static uint64_t lib_bitmap_and_cardinality(const void *r1, const void *r2, int bit) {
+    if (bit == LIB_BIT_32) {
+        return roaring_bitmap_and_cardinality((const roaring_bitmap_t *) r1, (const roaring_bitmap_t *) r2);
+    }
+    return roaring64_bitmap_and_cardinality((const roaring64_bitmap_t *) r1, (const roaring64_bitmap_t *) r2);
+}
+
+/**
+ * Adds `n` values, sorted input is the fast path.
+ */
+static void lib_bitmap_add_many(void *r, size_t n, const uint64_t *vals, int bit) {
+    if (bit == LIB_BIT_32) {
+        roaring_bulk_context_t context = {0};
+        for (size_t i = 0; i < n; i++) {
+            roaring_bitmap_add_bulk((roaring_bitmap_t *) r, &context, (uint32_t) vals[i]);
+        }
+        return;
+    }
+    roaring64_bulk_context_t context = {0};
+    for (size_t i = 0; i < n; i++) {
+        roaring64_bitmap_add_bulk((roaring64_bitmap_t *) r, &context, vals[i]);
+    }
+}
+
+/**
+ * Removes `n` values.
+ */
+static void lib_bitmap_remove_many(void *r, size_t n, const uint64_t *vals, int bit) {
+    if (bit == LIB_BIT_32) {
+        for (size_t i = 0; i < n; i++) {
+            roaring_bitmap_remove((roaring_bitmap_t *) r, (uint32_t) vals[i]);
+        }
+        return;
+    }
+    roaring64_bulk_context_t context = {0};
+    for (size_t i = 0; i < n; i++) {
+        roaring64_bitmap_remove_bulk((roaring64_bitmap_t *) r, &context, vals[i]);
+    }
+}
+
+/**
+ * Keeps the `n` smallest values of `r`.
+ */
+static void lib_bitmap_keep_first(void *r, uint64_t n, int bit) {
+    if (n == 0) {
+        if (bit == LIB_BIT_32) {
+            roaring_bitmap_clear((roaring_bitmap_t *) r);
+        } else {
+            roaring64_bitmap_clear((roaring64_bitmap_t *) r);
+        }
+        return;
+    }
+    // also keeps `n` from being narrowed to the 32-bit rank of roaring_bitmap_select()
+    if (n >= lib_bitmap_cardinality(r, bit)) {
+        return;
+    }
+    if (bit == LIB_BIT_32) {
+        uint32_t last;
+        if (roaring_bitmap_select((const roaring_bitmap_t *) r, (uint32_t) (n - 1), &last) && last < UINT32_MAX) {
+            roaring_bitmap_remove_range_closed((roaring_bitmap_t *) r, last + 1, UINT32_MAX);
+        }
+        return;
+    }
+    uint64_t last;
+    if (roaring64_bitmap_select((const roaring64_bitmap_t *) r, n - 1, &last) && last < UINT64_MAX) {
+        roaring64_bitmap_remove_range_closed((roaring64_bitmap_t *) r, last + 1, UINT64_MAX);
+    }
+}
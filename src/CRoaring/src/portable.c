@@ -0,0 +1,492 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Container level access to the portable serialization format
+ * (https://github.com/RoaringBitmap/RoaringFormatSpec).
+ *
+ * The header of a serialized bitmap gives the key, cardinality and kind of
+ * every container, so the position of every container in the buffer can be
+ * computed with one cheap pass over the header (run containers need their
+ * 2-byte run count read). After that each container is decoded independently
+ * of the others, which is what lets the work be split over the pool.
+ */
+
+typedef struct {
+    uint64_t key;      // value >> 16
+    const char *data;  // first byte of the serialized container
+    uint32_t cardinality;
+    uint8_t typecode;
+} lib_portable_container_t;
+
+typedef struct {
+    lib_portable_container_t *items;
+    size_t size;
+    size_t capacity;
+} lib_portable_index_t;
+
+static void lib_portable_index_free(lib_portable_index_t *index) {
+    roaring_free(index->items);
+    index->items = NULL;
+    index->size = 0;
+    index->capacity = 0;
+}
+
+static bool lib_portable_index_reserve(lib_portable_index_t *index, size_t capacity) {
+    if (capacity <= index->capacity) {
+        return true;
+    }
+    if (capacity < 2 * index->capacity) {
+        capacity = 2 * index->capacity;
+    }
+    lib_portable_container_t *items = (lib_portable_container_t *) roaring_realloc(
+        index->items, capacity * sizeof(lib_portable_container_t));
+    if (items == NULL) {
+        return false;
+    }
+    index->items = items;
+    index->capacity = capacity;
+    return true;
+}
+
+/**
+ * Indexes the containers of the 32-bit portable bitmap at `buf` without
+ * decoding them. `high` is added to every key (the high 32 bits of a 64-bit
+ * bucket, already shifted by 16). Keys must be strictly increasing. Nothing
+ * beyond `maxbytes` is read. Returns the size of the serialized bitmap, or 0
+ * if the data is invalid.
+ */
+static size_t lib_portable_index32(lib_portable_index_t *index, const char *buf, size_t maxbytes, uint64_t high) {
+    size_t read = sizeof(uint32_t);
+    if (read > maxbytes) {
+        return 0;
+    }
+    uint32_t cookie;
+    memcpy(&cookie, buf, sizeof(cookie));
+    bool hasrun = (cookie & 0xFFFF) == SERIAL_COOKIE;
+    if (!hasrun && cookie != SERIAL_COOKIE_NO_RUNCONTAINER) {
+        return 0;
+    }
+    uint32_t size;
+    if (hasrun) {
+        size = (cookie >> 16) + 1;
+    } else {
+        read += sizeof(uint32_t);
+        if (read > maxbytes) {
+            return 0;
+        }
+        memcpy(&size, buf + sizeof(uint32_t), sizeof(size));
+        if (size > (1 << 16)) {
+            return 0;
+        }
+    }
+    const char *runs = buf + read;
+    if (hasrun) {
+        read += (size + 7) / 8;
+    }
+    const char *keyscards = buf + read;
+    read += (size_t) size * 2 * sizeof(uint16_t);
+    if (hasrun == false || size >= NO_OFFSET_THRESHOLD) {
+        read += (size_t) size * sizeof(uint32_t);  // the offsets are recomputed below
+    }
+    if (read > maxbytes || !lib_portable_index_reserve(index, index->size + size)) {
+        return 0;
+    }
+    int32_t last = -1;
+    for (uint32_t k = 0; k < size; k++) {
+        uint16_t key;
+        uint16_t card;
+        memcpy(&key, keyscards + 4 * k, sizeof(key));
+        memcpy(&card, keyscards + 4 * k + 2, sizeof(card));
+        if ((int32_t) key <= last) {
+            return 0;
+        }
+        last = key;
+        lib_portable_container_t *item = &index->items[index->size + k];
+        item->key = high | key;
+        item->data = buf + read;
+        item->cardinality = (uint32_t) card + 1;
+        if (hasrun && (runs[k / 8] & (1 << (k % 8))) != 0) {
+            uint16_t n_runs;
+            if (read + sizeof(uint16_t) > maxbytes) {
+                return 0;
+            }
+            memcpy(&n_runs, buf + read, sizeof(n_runs));
+            item->typecode = RUN_CONTAINER_TYPE;
+            read += sizeof(uint16_t) + (size_t) n_runs * sizeof(rle16_t);
+        } else if (item->cardinality > DEFAULT_MAX_SIZE) {
+            item->typecode = BITSET_CONTAINER_TYPE;
+            read += BITSET_CONTAINER_SIZE_IN_WORDS * sizeof(uint64_t);
+        } else {
+            item->typecode = ARRAY_CONTAINER_TYPE;
+            read += (size_t) item->cardinality * sizeof(uint16_t);
+        }
+        if (read > maxbytes) {
+            return 0;
+        }
+    }
+    index->size += size;
+    return read;
+}
+
+/**
+ * Indexes the containers of a serialized bitmap of the given width, see
+ * `lib_portable_index32()`. Returns false if the data is invalid.
+ */
+static bool lib_portable_index(lib_portable_index_t *index, const char *buf, size_t maxbytes, int bit) {
+    if (buf == NULL) {
+        return false;
+    }
+    if (bit == LIB_BIT_32) {
+        return lib_portable_index32(index, buf, maxbytes, 0) != 0;
+    }
+    uint64_t buckets;
+    size_t read = sizeof(buckets);
+    if (read > maxbytes) {
+        return false;
+    }
+    memcpy(&buckets, buf, sizeof(buckets));
+    if (buckets > UINT32_MAX) {
+        return false;
+    }
+    int64_t previous = -1;
+    for (uint64_t bucket = 0; bucket < buckets; bucket++) {
+        uint32_t high32;
+        if (read + sizeof(high32) > maxbytes) {
+            return false;
+        }
+        memcpy(&high32, buf + read, sizeof(high32));
+        read += sizeof(high32);
+        if ((int64_t) high32 <= previous) {
+            return false;
+        }
+        previous = high32;
+        size_t size = lib_portable_index32(index, buf + read, maxbytes - read, (uint64_t) high32 << 16);
+        if (size == 0) {
+            return false;
+        }
+        read += size;
+    }
+    return true;
+}
+
+/**
+ * Decodes one indexed container, returns NULL on allocation failure.
+ */
+static container_t *lib_portable_decode(const lib_portable_container_t *item) {
+    if (item->typecode == BITSET_CONTAINER_TYPE) {
+        bitset_container_t *c = bitset_container_create();
+        if (c != NULL) {
+            bitset_container_read((int32_t) item->cardinality, c, item->data);
+        }
+        return c;
+    }
+    if (item->typecode == RUN_CONTAINER_TYPE) {
+        run_container_t *c = run_container_create();
+        if (c != NULL) {
+            run_container_read((int32_t) item->cardinality, c, item->data);
+        }
+        return c;
+    }
+    array_container_t *c = array_container_create_given_capacity((int32_t) item->cardinality);
+    if (c != NULL) {
+        array_container_read((int32_t) item->cardinality, c, item->data);
+    }
+    return c;
+}
+
+typedef struct {
+    const lib_portable_index_t *index;
+    container_t **containers;
+    size_t tasks;
+    bool *failed;
+} lib_portable_decode_t;
+
+static void lib_portable_decode_task(void *ctx, size_t task) {
+    lib_portable_decode_t *d = (lib_portable_decode_t *) ctx;
+    size_t begin = task * d->index->size / d->tasks;
+    size_t end = (task + 1) * d->index->size / d->tasks;
+    for (size_t i = begin; i < end; i++) {
+        d->containers[i] = lib_portable_decode(&d->index->items[i]);
+        if (d->containers[i] == NULL) {
+            d->failed[task] = true;
+        }
+    }
+}
+
+/**
+ * Reads a portable bitmap of the given width, decoding the containers on up
+ * to `threads` threads. Returns NULL if the data is invalid or on allocation
+ * failure.
+ */
+static void *lib_portable_deserialize_parallel(const char *buf, size_t maxbytes, int bit, uint32_t threads) {
+    void *result = NULL;
+    lib_portable_index_t index = {0};
+    if (!lib_portable_index(&index, buf, maxbytes, bit)) {
+        lib_portable_index_free(&index);
+        return NULL;
+    }
+    size_t tasks = lib_pool_tasks(threads, index.size);
+    container_t **containers = (container_t **) roaring_calloc(index.size == 0 ? 1 : index.size, sizeof(container_t *));
+    bool *failed = (bool *) roaring_calloc(tasks, sizeof(bool));
+    lib_list_t list = {0};
+    if (containers == NULL || failed == NULL || !lib_list_reserve(&list, index.size)) {
+        goto out;
+    }
+    lib_portable_decode_t d = {&index, containers, tasks, failed};
+    lib_pool_run_threads(threads, tasks, lib_portable_decode_task, &d);
+    bool ok = true;
+    for (size_t t = 0; t < tasks; t++) {
+        ok = ok && !failed[t];
+    }
+    if (ok) {
+        for (size_t i = 0; i < index.size; i++) {
+            lib_list_push(&list, index.items[i].key, containers[i], index.items[i].typecode);
+            containers[i] = NULL;
+        }
+        result = lib_list_to_bitmap(&list, bit);
+    }
+out:
+    if (containers != NULL) {
+        for (size_t i = 0; i < index.size; i++) {
+            if (containers[i] != NULL) {
+                container_free(containers[i], index.items[i].typecode);
+            }
+        }
+    }
+    lib_list_free(&list);
+    roaring_free(containers);
+    roaring_free(failed);
+    lib_portable_index_free(&index);
+    return result;
+}
+
+//----------------------------并行序列化----------------------------
+
+static bool lib_portable_hasrun32(const lib_entry_t *entries, size_t size) {
+    for (size_t k = 0; k < size; k++) {
+        if (entries[k].typecode == RUN_CONTAINER_TYPE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Size of the header of the 32-bit portable bitmap made of `entries[0, size)`,
+ * that is the offset of its first container.
+ */
+static size_t lib_portable_start32(const lib_entry_t *entries, size_t size) {
+    if (lib_portable_hasrun32(entries, size)) {
+        size_t s = (size + 7) / 8;
+        return size < NO_OFFSET_THRESHOLD ? 4 + 4 * size + s : 4 + 8 * size + s;
+    }
+    return 8 + 8 * size;
+}
+
+/**
+ * Writes the header of the 32-bit portable bitmap made of `entries[0, size)`
+ * at `buf` (nothing is written when `buf` is NULL) and stores in `offsets` the
+ * position of every container relative to `base`. Returns the size of the
+ * serialized bitmap. The layout is the one of `ra_portable_serialize()`.
+ */
+static size_t lib_portable_header32(const lib_entry_t *entries, size_t size, char *buf, size_t base, size_t *offsets) {
+    bool hasrun = lib_portable_hasrun32(entries, size);
+    size_t offset = lib_portable_start32(entries, size);
+    for (size_t k = 0; k < size; k++) {
+        offsets[k] = base + offset;
+        offset += (size_t) container_size_in_bytes(entries[k].container, entries[k].typecode);
+    }
+    if (buf == NULL) {
+        return offset;
+    }
+    char *p = buf;
+    if (hasrun) {
+        uint32_t cookie = SERIAL_COOKIE | ((uint32_t) (size - 1) << 16);
+        memcpy(p, &cookie, sizeof(cookie));
+        p += sizeof(cookie);
+        size_t s = (size + 7) / 8;
+        memset(p, 0, s);
+        for (size_t k = 0; k < size; k++) {
+            if (entries[k].typecode == RUN_CONTAINER_TYPE) {
+                p[k / 8] |= (char) (1 << (k % 8));
+            }
+        }
+        p += s;
+    } else {
+        uint32_t cookie = SERIAL_COOKIE_NO_RUNCONTAINER;
+        uint32_t n = (uint32_t) size;
+        memcpy(p, &cookie, sizeof(cookie));
+        memcpy(p + sizeof(cookie), &n, sizeof(n));
+        p += sizeof(cookie) + sizeof(n);
+    }
+    for (size_t k = 0; k < size; k++) {
+        uint16_t key = (uint16_t) entries[k].key;
+        uint16_t card = (uint16_t) (container_get_cardinality(entries[k].container, entries[k].typecode) - 1);
+        memcpy(p, &key, sizeof(key));
+        memcpy(p + sizeof(key), &card, sizeof(card));
+        p += sizeof(key) + sizeof(card);
+    }
+    if (!hasrun || size >= NO_OFFSET_THRESHOLD) {
+        for (size_t k = 0; k < size; k++) {
+            uint32_t o = (uint32_t) (offsets[k] - base);
+            memcpy(p, &o, sizeof(o));
+            p += sizeof(o);
+        }
+    }
+    return offset;
+}
+
+/**
+ * Lays out the portable serialization of the bitmap whose containers are in
+ * `list`: writes every header at `buf` (nothing is written when `buf` is NULL)
+ * and stores in `offsets` the position of every container. Returns the total
+ * size.
+ */
+static size_t lib_portable_layout(const lib_list_t *list, int bit, char *buf, size_t *offsets) {
+    if (bit == LIB_BIT_32) {
+        return lib_portable_header32(list->entries, list->size, buf, 0, offsets);
+    }
+    uint64_t buckets = 0;
+    for (size_t i = 0; i < list->size; i++) {
+        if (i == 0 || list->entries[i].key >> 16 != list->entries[i - 1].key >> 16) {
+            buckets++;
+        }
+    }
+    if (buf != NULL) {
+        memcpy(buf, &buckets, sizeof(buckets));
+    }
+    size_t offset = sizeof(buckets);
+    size_t begin = 0;
+    while (begin < list->size) {
+        uint64_t high = list->entries[begin].key >> 16;
+        size_t end = begin + 1;
+        while (end < list->size && list->entries[end].key >> 16 == high) {
+            end++;
+        }
+        if (buf != NULL) {
+            uint32_t high32 = (uint32_t) high;
+            memcpy(buf + offset, &high32, sizeof(high32));
+        }
+        offset += sizeof(uint32_t);
+        offset += lib_portable_header32(list->entries + begin, end - begin, buf == NULL ? NULL : buf + offset, offset,
+                                        offsets + begin);
+        begin = end;
+    }
+    return offset;
+}
+
+typedef struct {
+    const lib_list_t *list;
+    const size_t *offsets;
+    char *buf;
+    size_t tasks;
+} lib_portable_write_t;
+
+static void lib_portable_write_task(void *ctx, size_t task) {
+    lib_portable_write_t *w = (lib_portable_write_t *) ctx;
+    size_t begin = task * w->list->size / w->tasks;
+    size_t end = (task + 1) * w->list->size / w->tasks;
+    for (size_t i = begin; i < end; i++) {
+        const lib_entry_t *e = &w->list->entries[i];
+        container_write(e->container, e->typecode, w->buf + w->offsets[i]);
+    }
+}
+
+/**
+ * Writes the portable serialization of `r` to `buf`, which must hold the
+ * portable size in bytes of `r`. The headers are written first, then the
+ * containers are written on up to `threads` threads straight to their final
+ * position. The output is byte for byte the one of the CRoaring serializer.
+ * Returns the number of bytes written, or 0 on allocation failure.
+ */
+static size_t lib_portable_serialize_parallel(const void *r, char *buf, int bit, uint32_t threads) {
+    size_t written = 0;
+    lib_list_t list = {0};
+    size_t *offsets = NULL;
+    if (!lib_list_view(&list, r, bit)) {
+        goto out;
+    }
+    offsets = (size_t *) roaring_malloc((list.size == 0 ? 1 : list.size) * sizeof(size_t));
+    if (offsets == NULL) {
+        goto out;
+    }
+    written = lib_portable_layout(&list, bit, buf, offsets);
+    size_t tasks = lib_pool_tasks(threads, list.size);
+    lib_portable_write_t w = {&list, offsets, buf, tasks};
+    lib_pool_run_threads(threads, tasks, lib_portable_write_task, &w);
+out:
+    roaring_free(offsets);
+    lib_list_free(&list);
+    return written;
+}
+
+typedef struct {
+    void **rs;
+    const size_t *sizes;
+    char *buf;
+    int bit;
+    size_t tasks;
+    size_t number;
+} lib_portable_many_t;
+
+static void lib_portable_many_task(void *ctx, size_t task) {
+    lib_portable_many_t *m = (lib_portable_many_t *) ctx;
+    size_t begin = task * m->number / m->tasks;
+    size_t end = (task + 1) * m->number / m->tasks;
+    char *p = m->buf;
+    for (size_t i = 0; i < begin; i++) {
+        p += m->sizes[i];
+    }
+    for (size_t i = begin; i < end; i++) {
+        if (m->bit == LIB_BIT_32) {
+            roaring_bitmap_portable_serialize((const roaring_bitmap_t *) m->rs[i], p);
+        } else {
+            roaring64_bitmap_portable_serialize((const roaring64_bitmap_t *) m->rs[i], p);
+        }
+        p += m->sizes[i];
+    }
+}
+
+/**
+ * Stores in `sizes` the portable size in bytes of every bitmap of `rs` and
+ * returns their sum.
+ */
+static size_t lib_portable_size_many(void **rs, size_t number, size_t *sizes, int bit) {
+    size_t total = 0;
+    for (size_t i = 0; i < number; i++) {
+        if (bit == LIB_BIT_32) {
+            sizes[i] = roaring_bitmap_portable_size_in_bytes((const roaring_bitmap_t *) rs[i]);
+        } else {
+            sizes[i] = roaring64_bitmap_portable_size_in_bytes((const roaring64_bitmap_t *) rs[i]);
+        }
+        total += sizes[i];
+    }
+    return total;
+}
+
+/**
+ * Writes the portable serialization of every bitmap of `rs` back to back to
+ * `buf`, `sizes` being the output of `lib_portable_size_many()`. The bitmaps
+ * are split over the pool, each one is serialized by a single thread.
+ */
+static void lib_portable_serialize_many(void **rs, size_t number, const size_t *sizes, char *buf, int bit) {
+    lib_portable_many_t m = {rs, sizes, buf, bit, lib_pool_tasks(lib_pool_get_threads(), number), number};
+    if (number == 0) {
+        return;
+    }
+    lib_pool_run(m.tasks, lib_portable_many_task, &m);
+}
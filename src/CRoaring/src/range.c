@@ -0,0 +1,168 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Set operations between a bitmap and a range of values [min, max).
+ *
+ * The range is never materialized as a bitmap. The containers of the bitmap
+ * are walked in key order: the ones outside the keys of the range are cloned
+ * or skipped, the ones inside are kept, dropped or replaced by a full run,
+ * and only the two containers at the edges of the range are clipped.
+ */
+
+#define LIB_RANGE_AND 0
+#define LIB_RANGE_ANDNOT 1
+#define LIB_RANGE_OR 2
+
+/**
+ * Removes [lo, hi] from `c`, which is freed if replaced. Returns NULL when
+ * nothing is left or on allocation failure, which sets `failed`.
+ */
+static container_t *lib_range_remove(container_t *c, uint8_t *type, uint32_t lo, uint32_t hi, bool *failed) {
+    if (container_minimum(c, *type) >= lo && container_maximum(c, *type) <= hi) {
+        container_free(c, *type);
+        return NULL;
+    }
+    uint8_t t = *type;
+    container_t *r = container_remove_range(c, *type, lo, hi, &t);
+    if (r != c) {
+        container_free(c, *type);
+    }
+    *type = t;
+    *failed = r == NULL;
+    return r;
+}
+
+/**
+ * Adds [lo, hi] to `c`, which is freed if replaced. Returns NULL on
+ * allocation failure, which sets `failed`.
+ */
+static container_t *lib_range_add(container_t *c, uint8_t *type, uint32_t lo, uint32_t hi, bool *failed) {
+    uint8_t t = *type;
+    container_t *r = container_add_range(c, *type, lo, hi, &t);
+    if (r != c) {
+        container_free(c, *type);
+    }
+    *type = t;
+    *failed = r == NULL;
+    return r;
+}
+
+/**
+ * Copy of the entry with its values clipped to, or with [lo, hi] removed, or
+ * added, depending on `op`. Returns NULL when nothing is left, or on
+ * allocation failure, which sets `failed`.
+ */
+static container_t *lib_range_edge(const lib_entry_t *e, uint32_t lo, uint32_t hi, int op, uint8_t *type,
+                                   bool *failed) {
+    *type = e->typecode;
+    container_t *c = container_clone(e->container, e->typecode);
+    if (c == NULL) {
+        *failed = true;
+        return NULL;
+    }
+    if (op == LIB_RANGE_OR) {
+        return lib_range_add(c, type, lo, hi, failed);
+    }
+    if (op == LIB_RANGE_ANDNOT) {
+        return lib_range_remove(c, type, lo, hi, failed);
+    }
+    if (lo > 0) {
+        c = lib_range_remove(c, type, 0, lo - 1, failed);
+    }
+    if (c != NULL && hi < 0xFFFF) {
+        c = lib_range_remove(c, type, hi + 1, 0xFFFF, failed);
+    }
+    return c;
+}
+
+/**
+ * Pushes a clone of `e`, or the result of `lib_range_edge()`. Returns false
+ * on allocation failure.
+ */
+static bool lib_range_push(lib_list_t *out, const lib_entry_t *e, bool edge, uint32_t lo, uint32_t hi, int op) {
+    uint8_t type = e->typecode;
+    bool failed = false;
+    container_t *c = edge ? lib_range_edge(e, lo, hi, op, &type, &failed) : container_clone(e->container, e->typecode);
+    if (c == NULL) {
+        return edge && !failed;  // an edge may be left empty
+    }
+    return lib_list_push(out, e->key, c, type);
+}
+
+/**
+ * r AND [min, max), r ANDNOT [min, max) or r OR [min, max) depending on `op`,
+ * as a new bitmap. `max` is exclusive and clamped to the largest value of
+ * the width. Returns NULL on allocation failure.
+ */
+static void *lib_range_op(const void *r, uint64_t min, uint64_t max, int op, int bit) {
+    if (bit == LIB_BIT_32 && max > (uint64_t) UINT32_MAX + 1) {
+        max = (uint64_t) UINT32_MAX + 1;
+    }
+    if (min >= max) {
+        return op == LIB_RANGE_AND ? lib_bitmap_create(bit) : lib_bitmap_copy(r, bit);
+    }
+    lib_list_t in = {0};
+    lib_list_t out = {0};
+    if (!lib_list_view(&in, r, bit)) {
+        lib_list_free(&in);
+        return NULL;
+    }
+    uint64_t first = min >> 16;
+    uint64_t last = (max - 1) >> 16;
+    size_t i = op == LIB_RANGE_AND ? lib_list_lower_bound(&in, first) : 0;
+    bool ok = true;
+    // keys before the range
+    for (; ok && i < in.size && in.entries[i].key < first; i++) {
+        ok = lib_range_push(&out, &in.entries[i], false, 0, 0, op);
+    }
+    // keys of the range
+    for (uint64_t key = first; ok && key <= last; key++) {
+        uint32_t lo = key == first ? (uint32_t) (min & 0xFFFF) : 0;
+        uint32_t hi = key == last ? (uint32_t) ((max - 1) & 0xFFFF) : 0xFFFF;
+        bool present = i < in.size && in.entries[i].key == key;
+        bool whole = lo == 0 && hi == 0xFFFF;
+        if (present && !(whole && op == LIB_RANGE_ANDNOT)) {
+            ok = lib_range_push(&out, &in.entries[i], !(whole && op == LIB_RANGE_AND), lo, hi, op);
+        } else if (!present && op == LIB_RANGE_OR) {
+            container_t *c = run_container_create_range(lo, hi + 1);
+            ok = c != NULL && lib_list_push(&out, key, c, RUN_CONTAINER_TYPE);
+        }
+        if (present) {
+            i++;
+        }
+        if (op != LIB_RANGE_OR && i < in.size && in.entries[i].key > last) {
+            break;
+        }
+        if (op != LIB_RANGE_OR && i < in.size && in.entries[i].key > key + 1) {
+            key = in.entries[i].key - 1;
+        }
+        if (op != LIB_RANGE_OR && i == in.size) {
+            break;
+        }
+    }
+    // keys after the range
+    for (; ok && op != LIB_RANGE_AND && i < in.size; i++) {
+        ok = lib_range_push(&out, &in.entries[i], false, 0, 0, op);
+    }
+    lib_list_free(&in);
+    if (!ok) {
+        lib_list_free_containers(&out);
+        return NULL;
+    }
+    return lib_list_to_bitmap(&out, bit);
+}
@@ -0,0 +1,72 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * SIMD kernels of CRoaring.
+ *
+ * On x64 CRoaring compiles its AVX2 and AVX-512 container kernels with target
+ * attributes and picks one at run time with croaring_hardware_support(), so
+ * the library must not be built with -mavx2 or -march flags. The AVX-512
+ * kernels are only compiled when the compiler ships the VBMI2 intrinsics,
+ * which older compilers silently lack. Builds that must carry every kernel
+ * define LIB_REQUIRE_SIMD_DISPATCH (bin/build does on Linux x86_64) to turn
+ * that silent fallback into an error.
+ */
+
+#define LIB_SIMD_AVX2 1
+#define LIB_SIMD_AVX512 2
+
+#ifdef LIB_REQUIRE_SIMD_DISPATCH
+#if !CROARING_IS_X64 || !CROARING_COMPILER_SUPPORTS_AVX512
+#error "this compiler cannot build the AVX2 and AVX-512 kernels, use gcc >= 8 or clang >= 8"
+#endif
+#if defined(__AVX2__)
+#error "build without -mavx2 or -march so that the kernels are dispatched at run time"
+#endif
+#endif
+
+/**
+ * Kernels compiled into the library.
+ */
+static int lib_simd_compiled(void) {
+    int kernels = 0;
+#if CROARING_IS_X64
+    kernels |= LIB_SIMD_AVX2;
+#if CROARING_COMPILER_SUPPORTS_AVX512
+    kernels |= LIB_SIMD_AVX512;
+#endif
+#endif
+    return kernels;
+}
+
+/**
+ * Kernels used on this cpu, a subset of `lib_simd_compiled()`.
+ */
+static int lib_simd_active(void) {
+#if CROARING_IS_X64
+    int support = croaring_hardware_support();
+    int kernels = 0;
+    if (support & ROARING_SUPPORTS_AVX2) {
+        kernels |= LIB_SIMD_AVX2;
+    }
+    if (support & ROARING_SUPPORTS_AVX512) {
+        kernels |= LIB_SIMD_AVX512;
+    }
+    return kernels & lib_simd_compiled();
+#else
+    return 0;
+#endif
+}
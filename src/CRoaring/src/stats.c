@@ -0,0 +1,119 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Optional counters for the shims that move data across the FFI boundary.
+ *
+ * For each of them the number of calls, the time spent natively and the bytes
+ * read from and written to caller buffers are counted, per bit width. The
+ * counters are off by default; when off a shim only pays a relaxed load.
+ */
+
+#include <time.h>
+
+enum {
+    LIB_STAT_ADD_MANY,
+    LIB_STAT_REMOVE_MANY,
+    LIB_STAT_ITERATOR_READ,
+    LIB_STAT_TO_UINT_ARRAY,
+    LIB_STAT_PORTABLE_SERIALIZE,
+    LIB_STAT_PORTABLE_SERIALIZE_PARALLEL,
+    LIB_STAT_PORTABLE_SERIALIZE_MANY,
+    LIB_STAT_PORTABLE_WRITER_NEXT,
+    LIB_STAT_PORTABLE_DESERIALIZE,
+    LIB_STAT_PORTABLE_DESERIALIZE_PARALLEL,
+    LIB_STAT_AND_CARDINALITY_MATRIX,
+    LIB_STAT_COUNT
+};
+
+static const char *const lib_stat_names[LIB_STAT_COUNT] = {
+    "add_many",
+    "remove_many",
+    "iterator_read",
+    "to_uint_array",
+    "portable_serialize",
+    "portable_serialize_parallel",
+    "portable_serialize_many",
+    "portable_writer_next",
+    "portable_deserialize",
+    "portable_deserialize_parallel",
+    "and_cardinality_matrix",
+};
+
+typedef struct {
+    _Atomic uint64_t calls;
+    _Atomic uint64_t ns;
+    _Atomic uint64_t bytes_in;
+    _Atomic uint64_t bytes_out;
+} lib_stat_t;
+
+static lib_stat_t lib_stats[2][LIB_STAT_COUNT];  // [bit == 64][id]
+static atomic_bool lib_stats_enabled;
+
+static uint64_t lib_stats_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+/**
+ * Returns the start time of a call, 0 when the counters are off.
+ */
+static inline uint64_t lib_stats_begin(void) {
+    if (!atomic_load_explicit(&lib_stats_enabled, memory_order_relaxed)) {
+        return 0;
+    }
+    return lib_stats_clock();
+}
+
+/**
+ * Records a call started at `start` (the result of `lib_stats_begin()`).
+ */
+static inline void lib_stats_end(int id, int bit, uint64_t start, uint64_t bytes_in, uint64_t bytes_out) {
+    if (start == 0) {
+        return;
+    }
+    lib_stat_t *s = &lib_stats[bit == LIB_BIT_64][id];
+    atomic_fetch_add_explicit(&s->calls, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&s->ns, lib_stats_clock() - start, memory_order_relaxed);
+    atomic_fetch_add_explicit(&s->bytes_in, bytes_in, memory_order_relaxed);
+    atomic_fetch_add_explicit(&s->bytes_out, bytes_out, memory_order_relaxed);
+}
+
+static void lib_stats_reset(void) {
+    for (int b = 0; b < 2; b++) {
+        for (int id = 0; id < LIB_STAT_COUNT; id++) {
+            atomic_store_explicit(&lib_stats[b][id].calls, 0, memory_order_relaxed);
+            atomic_store_explicit(&lib_stats[b][id].ns, 0, memory_order_relaxed);
+            atomic_store_explicit(&lib_stats[b][id].bytes_in, 0, memory_order_relaxed);
+            atomic_store_explicit(&lib_stats[b][id].bytes_out, 0, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * Writes calls, ns, bytes in and bytes out of every counter of the given
+ * width to `out`, 4 values per counter.
+ */
+static void lib_stats_read(int bit, uint64_t *out) {
+    for (int id = 0; id < LIB_STAT_COUNT; id++) {
+        const lib_stat_t *s = &lib_stats[bit == LIB_BIT_64][id];
+        out[4 * id] = atomic_load_explicit(&s->calls, memory_order_relaxed);
+        out[4 * id + 1] = atomic_load_explicit(&s->ns, memory_order_relaxed);
+        out[4 * id + 2] = atomic_load_explicit(&s->bytes_in, memory_order_relaxed);
+        out[4 * id + 3] = atomic_load_explicit(&s->bytes_out, memory_order_relaxed);
+    }
+}
@@ -0,0 +1,394 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * A file holding many bitmaps of the same width, each one under a byte string
+ * key.
+ *
+ *   header   64 bytes, see lib_store_header_t
+ *   bitmaps  frozen serialization of every bitmap, each one starting at a
+ *            multiple of LIB_STORE_ALIGNMENT so it can be viewed in place
+ *   toc      one lib_store_entry_t per bitmap sorted by key, then the keys
+ *
+ * The header, the table of contents and every bitmap carry a CRC32C. Opening
+ * a store maps the file and checks the header and the table of contents only;
+ * a bitmap is checked when it is read, so a lookup is a binary search over the
+ * table of contents and touches no other bitmap. Like the frozen format the
+ * file uses the byte order of the machine that wrote it.
+ */
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+#include <sys/stat.h>
+
+#define LIB_STORE_MAGIC 0x53424D52  // "RMBS"
+#define LIB_STORE_VERSION 1
+#define LIB_STORE_ALIGNMENT 64      // >= the alignment needed by the frozen views
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t bit;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t toc_offset;
+    uint64_t toc_size;  // entries and keys
+    uint32_t toc_crc;
+    uint32_t header_crc;  // of the bytes above
+    char padding[16];
+} lib_store_header_t;
+
+typedef struct {
+    uint64_t offset;
+    uint64_t size;
+    uint64_t key_offset;  // from the start of the table of contents
+    uint32_t key_length;
+    uint32_t crc;
+} lib_store_entry_t;
+
+typedef struct {
+    const char *data;
+    size_t length;
+    bool mapped;
+    int bit;
+    uint64_t count;
+    const lib_store_entry_t *entries;
+    const char *keys;  // start of the table of contents
+    uint64_t toc_size;
+} lib_store_t;
+
+static int lib_store_key_compare(const char *a, size_t alen, const char *b, size_t blen) {
+    int c = memcmp(a, b, alen < blen ? alen : blen);
+    if (c != 0) {
+        return c;
+    }
+    return (alen > blen) - (alen < blen);
+}
+
+typedef struct {
+    const char *key;
+    size_t length;
+    void *r;
+} lib_store_item_t;
+
+static int lib_store_item_compare(const void *a, const void *b) {
+    const lib_store_item_t *x = (const lib_store_item_t *) a;
+    const lib_store_item_t *y = (const lib_store_item_t *) b;
+    return lib_store_key_compare(x->key, x->length, y->key, y->length);
+}
+
+static bool lib_write_zeros(int fd, size_t n) {
+    static const char zeros[LIB_STORE_ALIGNMENT] = {0};
+    while (n > 0) {
+        size_t k = n < sizeof(zeros) ? n : sizeof(zeros);
+        if (!lib_write_all(fd, zeros, k)) {
+            return false;
+        }
+        n -= k;
+    }
+    return true;
+}
+
+/**
+ * Writes the frozen serialization of `r` to `*buf`, growing it as needed.
+ * Like `lib_frozen_serialize()` it leaves a 32-bit bitmap and its shared
+ * containers untouched. Returns the size, or 0 on failure.
+ */
+static size_t lib_store_freeze(void *r, int bit, char **buf, size_t *capacity) {
+    size_t size = lib_frozen_size(r, bit);
+    if (size == 0) {
+        return 0;
+    }
+    if (size > *capacity) {
+        roaring_aligned_free(*buf);
+        *buf = (char *) roaring_aligned_malloc(LIB_STORE_ALIGNMENT, size);
+        *capacity = *buf == NULL ? 0 : size;
+        if (*buf == NULL) {
+            return 0;
+        }
+    }
+    return lib_frozen_serialize(r, *buf, bit);
+}
+
+/**
+ * Writes `number` bitmaps to a new store file at `path`. The key of bitmap `i`
+ * is the next `key_lengths[i]` bytes of `keys`. Keys must be distinct.
+ * Returns false on failure.
+ */
+static bool lib_store_write(const char *path, const char *keys, const size_t *key_lengths, void **rs, size_t number,
+                            int bit) {
+    bool ok = false;
+    int fd = -1;
+    char *buf = NULL;
+    size_t capacity = 0;
+    lib_store_item_t *items = (lib_store_item_t *) roaring_malloc((number == 0 ? 1 : number) * sizeof(lib_store_item_t));
+    lib_store_entry_t *entries = (lib_store_entry_t *) roaring_calloc(number == 0 ? 1 : number, sizeof(lib_store_entry_t));
+    if (items == NULL || entries == NULL) {
+        goto out;
+    }
+    size_t keys_size = 0;
+    for (size_t i = 0; i < number; i++) {
+        items[i].key = keys + keys_size;
+        items[i].length = key_lengths[i];
+        items[i].r = rs[i];
+        keys_size += key_lengths[i];
+        if (key_lengths[i] > UINT32_MAX) {
+            goto out;
+        }
+    }
+    qsort(items, number, sizeof(lib_store_item_t), lib_store_item_compare);
+    for (size_t i = 1; i < number; i++) {
+        if (lib_store_item_compare(&items[i - 1], &items[i]) == 0) {
+            goto out;
+        }
+    }
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+    if (fd < 0 || !lib_write_zeros(fd, sizeof(lib_store_header_t))) {
+        goto out;
+    }
+    uint64_t offset = sizeof(lib_store_header_t);
+    for (size_t i = 0; i < number; i++) {
+        size_t size = lib_store_freeze(items[i].r, bit, &buf, &capacity);
+        uint64_t start = (offset + LIB_STORE_ALIGNMENT - 1) & ~(uint64_t) (LIB_STORE_ALIGNMENT - 1);
+        if (size == 0 || !lib_write_zeros(fd, start - offset) || !lib_write_all(fd, buf, size)) {
+            goto out;
+        }
+        entries[i].offset = start;
+        entries[i].size = size;
+        entries[i].crc = lib_crc32c(buf, size);
+        offset = start + size;
+    }
+    uint64_t toc_offset = (offset + 7) & ~(uint64_t) 7;
+    uint64_t key_offset = number * sizeof(lib_store_entry_t);
+    for (size_t i = 0; i < number; i++) {
+        entries[i].key_offset = key_offset;
+        entries[i].key_length = (uint32_t) items[i].length;
+        key_offset += items[i].length;
+    }
+    uint64_t toc_size = key_offset;
+    char *toc = (char *) roaring_malloc(toc_size == 0 ? 1 : toc_size);
+    if (toc == NULL) {
+        goto out;
+    }
+    memcpy(toc, entries, number * sizeof(lib_store_entry_t));
+    for (size_t i = 0; i < number; i++) {
+        memcpy(toc + entries[i].key_offset, items[i].key, items[i].length);
+    }
+    lib_store_header_t header = {0};
+    header.magic = LIB_STORE_MAGIC;
+    header.version = LIB_STORE_VERSION;
+    header.bit = (uint32_t) bit;
+    header.count = number;
+    header.toc_offset = toc_offset;
+    header.toc_size = toc_size;
+    header.toc_crc = lib_crc32c(toc, toc_size);
+    header.header_crc = lib_crc32c(&header, offsetof(lib_store_header_t, header_crc));
+    ok = lib_write_zeros(fd, toc_offset - offset) && lib_write_all(fd, toc, toc_size) &&
+         lseek(fd, 0, SEEK_SET) == 0 && lib_write_all(fd, (const char *) &header, sizeof(header));
+    roaring_free(toc);
+out:
+    if (fd >= 0 && close(fd) != 0) {
+        ok = false;
+    }
+    roaring_aligned_free(buf);
+    roaring_free(items);
+    roaring_free(entries);
+    return ok;
+}
+
+static void lib_store_close(lib_store_t *s) {
+    if (s == NULL) {
+        return;
+    }
+#ifndef _WIN32
+    if (s->mapped) {
+        munmap((void *) s->data, s->length);
+    } else
+#endif
+    {
+        roaring_aligned_free((void *) s->data);
+    }
+    roaring_free(s);
+}
+
+/**
+ * Maps the file into memory. Where mmap is not available the file is read
+ * into an aligned buffer instead.
+ */
+static bool lib_store_load(lib_store_t *s, int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(lib_store_header_t)) {
+        return false;
+    }
+    s->length = (size_t) st.st_size;
+#ifndef _WIN32
+    void *data = mmap(NULL, s->length, PROT_READ, MAP_SHARED, fd, 0);
+    if (data != MAP_FAILED) {
+        s->data = (const char *) data;
+        s->mapped = true;
+        return true;
+    }
+#endif
+    char *data_copy = (char *) roaring_aligned_malloc(LIB_STORE_ALIGNMENT, s->length);
+    if (data_copy == NULL) {
+        return false;
+    }
+    s->data = data_copy;
+    size_t read_size = 0;
+    while (read_size < s->length) {
+        size_t want = s->length - read_size;
+        int got = (int) read(fd, data_copy + read_size, want > (1u << 30) ? (1u << 30) : (unsigned int) want);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        read_size += (size_t) got;
+    }
+    return true;
+}
+
+/**
+ * Checks the header and the table of contents of a loaded store.
+ */
+static bool lib_store_check(lib_store_t *s) {
+    lib_store_header_t header;
+    memcpy(&header, s->data, sizeof(header));
+    if (header.magic != LIB_STORE_MAGIC || header.version != LIB_STORE_VERSION ||
+        header.header_crc != lib_crc32c(&header, offsetof(lib_store_header_t, header_crc))) {
+        return false;
+    }
+    if ((header.bit != LIB_BIT_32 && header.bit != LIB_BIT_64) || header.toc_offset % 8 != 0 ||
+        header.toc_offset > s->length || header.toc_size > s->length - header.toc_offset ||
+        header.count > header.toc_size / sizeof(lib_store_entry_t)) {
+        return false;
+    }
+    const char *toc = s->data + header.toc_offset;
+    if (header.toc_crc != lib_crc32c(toc, header.toc_size)) {
+        return false;
+    }
+    s->bit = (int) header.bit;
+    s->count = header.count;
+    s->entries = (const lib_store_entry_t *) toc;
+    s->keys = toc;
+    s->toc_size = header.toc_size;
+    for (uint64_t i = 0; i < s->count; i++) {
+        const lib_store_entry_t *e = &s->entries[i];
+        if (e->offset % LIB_STORE_ALIGNMENT != 0 || e->offset > header.toc_offset ||
+            e->size > header.toc_offset - e->offset || e->key_offset > s->toc_size ||
+            e->key_length > s->toc_size - e->key_offset) {
+            return false;
+        }
+        if (i > 0) {
+            const lib_store_entry_t *p = &s->entries[i - 1];
+            if (lib_store_key_compare(toc + p->key_offset, p->key_length, toc + e->key_offset, e->key_length) >= 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Opens a store file. Returns NULL if the file cannot be read or if its
+ * header or table of contents is corrupted.
+ */
+static lib_store_t *lib_store_open(const char *path) {
+    lib_store_t *s = (lib_store_t *) roaring_calloc(1, sizeof(lib_store_t));
+    if (s == NULL) {
+        return NULL;
+    }
+    int fd = open(path, O_RDONLY | O_BINARY);
+    if (fd < 0) {
+        roaring_free(s);
+        return NULL;
+    }
+    bool ok = lib_store_load(s, fd) && lib_store_check(s);
+    close(fd);
+    if (!ok) {
+        lib_store_close(s);
+        return NULL;
+    }
+    return s;
+}
+
+/**
+ * Index of the bitmap stored under `key`, or -1.
+ */
+static int64_t lib_store_find(const lib_store_t *s, const char *key, size_t key_length) {
+    uint64_t lo = 0;
+    uint64_t hi = s->count;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        const lib_store_entry_t *e = &s->entries[mid];
+        int c = lib_store_key_compare(s->keys + e->key_offset, e->key_length, key, key_length);
+        if (c == 0) {
+            return (int64_t) mid;
+        }
+        if (c < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return -1;
+}
+
+static bool lib_store_verify_at(const lib_store_t *s, uint64_t index) {
+    const lib_store_entry_t *e = &s->entries[index];
+    return lib_crc32c(s->data + e->offset, e->size) == e->crc;
+}
+
+/**
+ * Checks the CRC32C of every bitmap.
+ */
+static bool lib_store_verify(const lib_store_t *s) {
+    for (uint64_t i = 0; i < s->count; i++) {
+        if (!lib_store_verify_at(s, i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Returns a copy of bitmap `index`, read through a frozen view of the file.
+ * Returns NULL if the checksum does not match or on allocation failure.
+ */
+static void *lib_store_get(const lib_store_t *s, uint64_t index) {
+    if (index >= s->count || !lib_store_verify_at(s, index)) {
+        return NULL;
+    }
+    const lib_store_entry_t *e = &s->entries[index];
+    if (s->bit == LIB_BIT_32) {
+        roaring_bitmap_t *view = (roaring_bitmap_t *) roaring_bitmap_frozen_view(s->data + e->offset, e->size);
+        if (view == NULL) {
+            return NULL;
+        }
+        roaring_bitmap_t *r = roaring_bitmap_copy(view);
+        roaring_bitmap_free(view);
+        return r;
+    }
+    roaring64_bitmap_t *view = roaring64_bitmap_frozen_view(s->data + e->offset, e->size);
+    if (view == NULL) {
+        return NULL;
+    }
+    roaring64_bitmap_t *r = roaring64_bitmap_copy(view);
+    roaring64_bitmap_free(view);
+    return r;
+}
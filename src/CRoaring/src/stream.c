@@ -0,0 +1,417 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Streaming of the portable format.
+ *
+ * The writer hands out the serialization of a bitmap in pieces of any size:
+ * headers are produced one 32-bit bucket at a time and containers are written
+ * straight to the caller's buffer, so the whole serialized bitmap never exists
+ * in memory. The reader decodes a file container by container through a
+ * small buffer that only grows up to the largest single container or header.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#define LIB_STREAM_BUFFER_SIZE 65536
+
+typedef struct {
+    lib_list_t list;  // view of the bitmap
+    int bit;
+    bool started;
+    size_t pos;       // next container to write
+    size_t end;       // end of the current 32-bit bucket
+    size_t *offsets;  // scratch for lib_portable_header32()
+    char *pending;    // bytes produced but not handed out yet
+    size_t pending_size;
+    size_t pending_pos;
+} lib_portable_writer_t;
+
+static void lib_portable_writer_free(lib_portable_writer_t *w) {
+    if (w == NULL) {
+        return;
+    }
+    lib_list_free(&w->list);
+    roaring_free(w->offsets);
+    roaring_free(w->pending);
+    roaring_free(w);
+}
+
+/**
+ * Creates a writer of the portable serialization of `r`. The bitmap must not
+ * be modified until the writer is freed. Returns NULL on allocation failure.
+ */
+static lib_portable_writer_t *lib_portable_writer_create(const void *r, int bit) {
+    lib_portable_writer_t *w = (lib_portable_writer_t *) roaring_calloc(1, sizeof(lib_portable_writer_t));
+    if (w == NULL) {
+        return NULL;
+    }
+    w->bit = bit;
+    if (!lib_list_view(&w->list, r, bit)) {
+        lib_portable_writer_free(w);
+        return NULL;
+    }
+    // the pending buffer must hold the largest header and the largest container
+    size_t capacity = sizeof(uint64_t);
+    size_t begin = 0;
+    do {
+        size_t end = begin;
+        if (bit == LIB_BIT_32) {
+            end = w->list.size;
+        } else if (begin < w->list.size) {
+            while (end < w->list.size && w->list.entries[end].key >> 16 == w->list.entries[begin].key >> 16) {
+                end++;
+            }
+        }
+        size_t header = sizeof(uint32_t) + lib_portable_start32(w->list.entries + begin, end - begin);
+        capacity = header > capacity ? header : capacity;
+        for (size_t i = begin; i < end; i++) {
+            const lib_entry_t *e = &w->list.entries[i];
+            size_t size = (size_t) container_size_in_bytes(e->container, e->typecode);
+            capacity = size > capacity ? size : capacity;
+        }
+        begin = end;
+    } while (begin < w->list.size);
+    w->offsets = (size_t *) roaring_malloc((w->list.size == 0 ? 1 : w->list.size) * sizeof(size_t));
+    w->pending = (char *) roaring_malloc(capacity);
+    if (w->offsets == NULL || w->pending == NULL) {
+        lib_portable_writer_free(w);
+        return NULL;
+    }
+    return w;
+}
+
+/**
+ * Puts the header of the next 32-bit bucket (preceded by its high 32 bits for
+ * a 64-bit bitmap) into the pending buffer.
+ */
+static void lib_portable_writer_bucket(lib_portable_writer_t *w) {
+    const lib_entry_t *entries = w->list.entries;
+    size_t begin = w->pos;
+    size_t end = w->list.size;
+    char *p = w->pending;
+    if (w->bit == LIB_BIT_64) {
+        end = begin + 1;
+        while (end < w->list.size && entries[end].key >> 16 == entries[begin].key >> 16) {
+            end++;
+        }
+        uint32_t high32 = (uint32_t) (entries[begin].key >> 16);
+        memcpy(p, &high32, sizeof(high32));
+        p += sizeof(high32);
+    }
+    lib_portable_header32(entries + begin, end - begin, p, 0, w->offsets + begin);
+    w->pending_size = (size_t) (p - w->pending) + lib_portable_start32(entries + begin, end - begin);
+    w->pending_pos = 0;
+    w->end = end;
+}
+
+/**
+ * Writes the next bytes of the serialization to `buf`, at most `capacity`.
+ * Returns the number of bytes written, 0 once everything was written.
+ */
+static size_t lib_portable_writer_next(lib_portable_writer_t *w, char *buf, size_t capacity) {
+    size_t filled = 0;
+    while (filled < capacity) {
+        if (w->pending_pos < w->pending_size) {
+            size_t n = w->pending_size - w->pending_pos;
+            n = n < capacity - filled ? n : capacity - filled;
+            memcpy(buf + filled, w->pending + w->pending_pos, n);
+            w->pending_pos += n;
+            filled += n;
+            continue;
+        }
+        if (!w->started) {
+            w->started = true;
+            if (w->bit == LIB_BIT_32) {
+                lib_portable_writer_bucket(w);
+            } else {
+                uint64_t buckets = 0;
+                for (size_t i = 0; i < w->list.size; i++) {
+                    if (i == 0 || w->list.entries[i].key >> 16 != w->list.entries[i - 1].key >> 16) {
+                        buckets++;
+                    }
+                }
+                memcpy(w->pending, &buckets, sizeof(buckets));
+                w->pending_size = sizeof(buckets);
+                w->pending_pos = 0;
+            }
+            continue;
+        }
+        if (w->pos == w->end) {
+            if (w->pos == w->list.size) {
+                break;
+            }
+            lib_portable_writer_bucket(w);
+            continue;
+        }
+        const lib_entry_t *e = &w->list.entries[w->pos++];
+        size_t size = (size_t) container_size_in_bytes(e->container, e->typecode);
+        if (size <= capacity - filled) {
+            container_write(e->container, e->typecode, buf + filled);
+            filled += size;
+        } else {
+            container_write(e->container, e->typecode, w->pending);
+            w->pending_size = size;
+            w->pending_pos = 0;
+        }
+    }
+    return filled;
+}
+
+static bool lib_write_all(int fd, const char *buf, size_t size) {
+    while (size > 0) {
+        unsigned int chunk = size > (1u << 30) ? (1u << 30) : (unsigned int) size;
+        int n = (int) write(fd, buf, chunk);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        buf += n;
+        size -= (size_t) n;
+    }
+    return true;
+}
+
+/**
+ * Writes the portable serialization of `r` to the file `path`, replacing its
+ * content, through a buffer of LIB_STREAM_BUFFER_SIZE bytes. Returns false on
+ * failure.
+ */
+static bool lib_portable_write_file(const void *r, const char *path, int bit) {
+    lib_portable_writer_t *w = lib_portable_writer_create(r, bit);
+    char *buf = (char *) roaring_malloc(LIB_STREAM_BUFFER_SIZE);
+    int fd = -1;
+    bool ok = false;
+    if (w == NULL || buf == NULL) {
+        goto out;
+    }
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+    if (fd < 0) {
+        goto out;
+    }
+    ok = true;
+    size_t n;
+    while (ok && (n = lib_portable_writer_next(w, buf, LIB_STREAM_BUFFER_SIZE)) > 0) {
+        ok = lib_write_all(fd, buf, n);
+    }
+out:
+    if (fd >= 0 && close(fd) != 0) {
+        ok = false;
+    }
+    roaring_free(buf);
+    lib_portable_writer_free(w);
+    return ok;
+}
+
+typedef struct {
+    int fd;
+    char *buf;
+    size_t start;  // first unread byte
+    size_t end;    // end of the bytes read from the file
+    size_t capacity;
+} lib_reader_t;
+
+/**
+ * Returns a pointer to the next `n` bytes of the file without consuming them,
+ * or NULL if the file is shorter or on failure. The pointer is valid until the
+ * next call.
+ */
+static const char *lib_reader_peek(lib_reader_t *r, size_t n) {
+    if (r->end - r->start >= n) {
+        return r->buf + r->start;
+    }
+    memmove(r->buf, r->buf + r->start, r->end - r->start);
+    r->end -= r->start;
+    r->start = 0;
+    if (n > r->capacity) {
+        char *buf = (char *) roaring_realloc(r->buf, n);
+        if (buf == NULL) {
+            return NULL;
+        }
+        r->buf = buf;
+        r->capacity = n;
+    }
+    while (r->end < n) {
+        size_t want = r->capacity - r->end;
+        int got = (int) read(r->fd, r->buf + r->end, want > (1u << 30) ? (1u << 30) : (unsigned int) want);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return NULL;
+        }
+        r->end += (size_t) got;
+    }
+    return r->buf;
+}
+
+/**
+ * Same as `lib_reader_peek()`, and the bytes are consumed.
+ */
+static const char *lib_reader_read(lib_reader_t *r, size_t n) {
+    const char *p = lib_reader_peek(r, n);
+    if (p != NULL) {
+        r->start += n;
+    }
+    return p;
+}
+
+/**
+ * Decodes the next 32-bit portable bitmap of the file into `list`, `high` is
+ * added to every key. Returns false if the data is invalid or on failure.
+ */
+static bool lib_reader_bitmap32(lib_reader_t *r, lib_list_t *list, uint64_t high) {
+    const char *p = lib_reader_read(r, sizeof(uint32_t));
+    if (p == NULL) {
+        return false;
+    }
+    uint32_t cookie;
+    memcpy(&cookie, p, sizeof(cookie));
+    bool hasrun = (cookie & 0xFFFF) == SERIAL_COOKIE;
+    if (!hasrun && cookie != SERIAL_COOKIE_NO_RUNCONTAINER) {
+        return false;
+    }
+    uint32_t size;
+    if (hasrun) {
+        size = (cookie >> 16) + 1;
+    } else {
+        if ((p = lib_reader_read(r, sizeof(uint32_t))) == NULL) {
+            return false;
+        }
+        memcpy(&size, p, sizeof(size));
+        if (size > (1 << 16)) {
+            return false;
+        }
+    }
+    uint8_t runs[(1 << 16) / 8] = {0};
+    if (hasrun) {
+        if ((p = lib_reader_read(r, (size + 7) / 8)) == NULL) {
+            return false;
+        }
+        memcpy(runs, p, (size + 7) / 8);
+    }
+    uint16_t *keyscards = (uint16_t *) roaring_malloc((size == 0 ? 1 : size) * 2 * sizeof(uint16_t));
+    if (keyscards == NULL || (p = lib_reader_read(r, (size_t) size * 2 * sizeof(uint16_t))) == NULL) {
+        roaring_free(keyscards);
+        return false;
+    }
+    memcpy(keyscards, p, (size_t) size * 2 * sizeof(uint16_t));
+    bool ok = true;
+    if (hasrun == false || size >= NO_OFFSET_THRESHOLD) {
+        ok = lib_reader_read(r, (size_t) size * sizeof(uint32_t)) != NULL;
+    }
+    int32_t last = -1;
+    for (uint32_t k = 0; ok && k < size; k++) {
+        lib_portable_container_t item;
+        item.key = high | keyscards[2 * k];
+        item.cardinality = (uint32_t) keyscards[2 * k + 1] + 1;
+        if ((int32_t) keyscards[2 * k] <= last) {
+            ok = false;
+            break;
+        }
+        last = keyscards[2 * k];
+        size_t bytes;
+        if (hasrun && (runs[k / 8] & (1 << (k % 8))) != 0) {
+            uint16_t n_runs;
+            if ((p = lib_reader_peek(r, sizeof(uint16_t))) == NULL) {
+                ok = false;
+                break;
+            }
+            memcpy(&n_runs, p, sizeof(n_runs));
+            item.typecode = RUN_CONTAINER_TYPE;
+            bytes = sizeof(uint16_t) + (size_t) n_runs * sizeof(rle16_t);
+        } else if (item.cardinality > DEFAULT_MAX_SIZE) {
+            item.typecode = BITSET_CONTAINER_TYPE;
+            bytes = BITSET_CONTAINER_SIZE_IN_WORDS * sizeof(uint64_t);
+        } else {
+            item.typecode = ARRAY_CONTAINER_TYPE;
+            bytes = (size_t) item.cardinality * sizeof(uint16_t);
+        }
+        if ((item.data = lib_reader_read(r, bytes)) == NULL) {
+            ok = false;
+            break;
+        }
+        container_t *c = lib_portable_decode(&item);
+        ok = c != NULL && lib_list_push(list, item.key, c, item.typecode);
+    }
+    roaring_free(keyscards);
+    return ok;
+}
+
+/**
+ * Reads a portable bitmap of the given width from the file `path` container
+ * by container. Returns NULL if the data is invalid or on failure.
+ */
+static void *lib_portable_read_file(const char *path, int bit) {
+    lib_reader_t r = {-1, NULL, 0, 0, LIB_STREAM_BUFFER_SIZE};
+    lib_list_t list = {0};
+    bool ok = false;
+    r.buf = (char *) roaring_malloc(r.capacity);
+    if (r.buf == NULL) {
+        return NULL;
+    }
+    r.fd = open(path, O_RDONLY | O_BINARY);
+    if (r.fd < 0) {
+        goto out;
+    }
+    if (bit == LIB_BIT_32) {
+        ok = lib_reader_bitmap32(&r, &list, 0);
+        goto out;
+    }
+    const char *p = lib_reader_read(&r, sizeof(uint64_t));
+    if (p == NULL) {
+        goto out;
+    }
+    uint64_t buckets;
+    memcpy(&buckets, p, sizeof(buckets));
+    if (buckets > UINT32_MAX) {
+        goto out;
+    }
+    ok = true;
+    int64_t previous = -1;
+    for (uint64_t bucket = 0; ok && bucket < buckets; bucket++) {
+        uint32_t high32;
+        if ((p = lib_reader_read(&r, sizeof(high32))) == NULL) {
+            ok = false;
+            break;
+        }
+        memcpy(&high32, p, sizeof(high32));
+        ok = (int64_t) high32 > previous && lib_reader_bitmap32(&r, &list, (uint64_t) high32 << 16);
+        previous = high32;
+    }
+out:
+    if (r.fd >= 0) {
+        close(r.fd);
+    }
+    roaring_free(r.buf);
+    if (!ok) {
+        lib_list_free_containers(&list);
+        return NULL;
+    }
+    return lib_list_to_bitmap(&list, bit);
+}
@@ -0,0 +1,221 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * A small persistent worker pool used by the library.c shims.
+ *
+ * The pool is disabled (one thread) by default. Work is submitted as a number
+ * of independent tasks; the calling thread takes part in the work, so with
+ * `threads = n` there are `n - 1` background workers. Only one job runs at a
+ * time, concurrent callers are serialized.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define LIB_POOL_MAX_THREADS 256
+
+typedef void (*lib_pool_task_fn)(void *ctx, size_t task);
+
+static struct {
+    pthread_mutex_t run_lock;  // serializes jobs
+    pthread_mutex_t lock;      // protects the fields below
+    pthread_cond_t start;
+    pthread_cond_t done;
+    pthread_t workers[LIB_POOL_MAX_THREADS];
+    uint32_t threads;  // configured size, including the caller
+    uint32_t started;  // number of running background workers
+    uintptr_t generation;
+    uint32_t active;
+    bool shutdown;
+    lib_pool_task_fn fn;
+    void *ctx;
+    size_t tasks;
+    atomic_size_t next;
+    atomic_int helpers;  // background workers still allowed to join the job
+} lib_pool = {
+    .run_lock = PTHREAD_MUTEX_INITIALIZER,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .start = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+    .threads = 1,
+};
+
+// Set while a thread executes pool tasks, nested jobs then run inline.
+static _Thread_local bool lib_pool_inside = false;
+
+static void lib_pool_drain(void) {
+    size_t task;
+    lib_pool_inside = true;
+    while ((task = atomic_fetch_add(&lib_pool.next, 1)) < lib_pool.tasks) {
+        lib_pool.fn(lib_pool.ctx, task);
+    }
+    lib_pool_inside = false;
+}
+
+// `arg` is the generation at spawn time, so a worker that is scheduled late
+// still picks up the job it was started for.
+static void *lib_pool_worker(void *arg) {
+    uintptr_t seen = (uintptr_t) arg;
+    pthread_mutex_lock(&lib_pool.lock);
+    while (true) {
+        while (!lib_pool.shutdown && seen == lib_pool.generation) {
+            pthread_cond_wait(&lib_pool.start, &lib_pool.lock);
+        }
+        if (lib_pool.shutdown) {
+            break;
+        }
+        seen = lib_pool.generation;
+        pthread_mutex_unlock(&lib_pool.lock);
+        if (atomic_fetch_sub(&lib_pool.helpers, 1) > 0) {
+            lib_pool_drain();
+        }
+        pthread_mutex_lock(&lib_pool.lock);
+        if (--lib_pool.active == 0) {
+            pthread_cond_signal(&lib_pool.done);
+        }
+    }
+    pthread_mutex_unlock(&lib_pool.lock);
+    return NULL;
+}
+
+// Joins all background workers. Caller holds run_lock.
+static void lib_pool_stop(void) {
+    pthread_mutex_lock(&lib_pool.lock);
+    lib_pool.shutdown = true;
+    pthread_cond_broadcast(&lib_pool.start);
+    pthread_mutex_unlock(&lib_pool.lock);
+    for (uint32_t i = 0; i < lib_pool.started; i++) {
+        pthread_join(lib_pool.workers[i], NULL);
+    }
+    lib_pool.started = 0;
+    lib_pool.shutdown = false;
+}
+
+// Starts background workers until `threads` threads can work on a job.
+// Caller holds run_lock.
+static void lib_pool_start(uint32_t threads) {
+    while (lib_pool.started + 1 < threads) {
+        if (pthread_create(&lib_pool.workers[lib_pool.started], NULL, lib_pool_worker,
+                           (void *) lib_pool.generation) != 0) {
+            break;  // run with whatever we have
+        }
+        lib_pool.started++;
+    }
+}
+
+#ifndef _WIN32
+// Threads do not survive fork(), a child (e.g. a php-fpm worker) starts over.
+static void lib_pool_atfork_child(void) {
+    pthread_mutex_init(&lib_pool.run_lock, NULL);
+    pthread_mutex_init(&lib_pool.lock, NULL);
+    pthread_cond_init(&lib_pool.start, NULL);
+    pthread_cond_init(&lib_pool.done, NULL);
+    lib_pool.started = 0;
+    lib_pool.active = 0;
+    lib_pool.shutdown = false;
+}
+
+static pthread_once_t lib_pool_once = PTHREAD_ONCE_INIT;
+
+static void lib_pool_register_atfork(void) {
+    pthread_atfork(NULL, NULL, lib_pool_atfork_child);
+}
+#endif
+
+static uint32_t lib_pool_get_threads(void) {
+    return lib_pool.threads;
+}
+
+static void lib_pool_set_threads(uint32_t threads) {
+    if (threads < 1) {
+        threads = 1;
+    } else if (threads > LIB_POOL_MAX_THREADS) {
+        threads = LIB_POOL_MAX_THREADS;
+    }
+    pthread_mutex_lock(&lib_pool.run_lock);
+    if (threads != lib_pool.threads) {
+        lib_pool_stop();
+        lib_pool.threads = threads;
+    }
+    pthread_mutex_unlock(&lib_pool.run_lock);
+}
+
+/**
+ * Runs `fn(ctx, 0) ... fn(ctx, tasks - 1)` on at most `threads` threads and
+ * returns when all of them are done. Workers are started on demand, so a
+ * call may use more threads than `bp_set_threads()` configured. Tasks are
+ * picked up in increasing order but may run concurrently, so every task must
+ * only write to its own slot of `ctx`.
+ */
+static void lib_pool_run_threads(uint32_t threads, size_t tasks, lib_pool_task_fn fn, void *ctx) {
+    if (threads > LIB_POOL_MAX_THREADS) {
+        threads = LIB_POOL_MAX_THREADS;
+    }
+    if (tasks == 0) {
+        return;
+    }
+    if (tasks == 1 || threads <= 1 || lib_pool_inside) {
+        for (size_t i = 0; i < tasks; i++) {
+            fn(ctx, i);
+        }
+        return;
+    }
+#ifndef _WIN32
+    pthread_once(&lib_pool_once, lib_pool_register_atfork);
+#endif
+    pthread_mutex_lock(&lib_pool.run_lock);
+    lib_pool_start(threads);
+    pthread_mutex_lock(&lib_pool.lock);
+    lib_pool.fn = fn;
+    lib_pool.ctx = ctx;
+    lib_pool.tasks = tasks;
+    atomic_store(&lib_pool.next, 0);
+    atomic_store(&lib_pool.helpers, (int) threads - 1);
+    lib_pool.active = lib_pool.started;
+    lib_pool.generation++;
+    pthread_cond_broadcast(&lib_pool.start);
+    pthread_mutex_unlock(&lib_pool.lock);
+
+    lib_pool_drain();
+
+    pthread_mutex_lock(&lib_pool.lock);
+    while (lib_pool.active > 0) {
+        pthread_cond_wait(&lib_pool.done, &lib_pool.lock);
+    }
+    pthread_mutex_unlock(&lib_pool.lock);
+    pthread_mutex_unlock(&lib_pool.run_lock);
+}
+
+/**
+ * Runs the tasks with the configured number of threads.
+ */
+static void lib_pool_run(size_t tasks, lib_pool_task_fn fn, void *ctx) {
+    lib_pool_run_threads(lib_pool.threads, tasks, fn, ctx);
+}
+
+/**
+ * Number of tasks to split a job of `items` units over `threads` threads
+ * into: a few per thread so that uneven tasks still balance, and never more
+ * than there is work.
+ */
+static size_t lib_pool_tasks(uint32_t threads, size_t items) {
+    size_t tasks = threads <= 1 ? 1 : (size_t) threads * 4;
+    if (tasks > items) {
+        tasks = items;
+    }
+    return tasks == 0 ? 1 : tasks;
+}
@@ -0,0 +1,159 @@
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Conversions between 32-bit and 64-bit bitmaps, and binary operations
+ * between a 32-bit and a 64-bit bitmap.
+ *
+ * Both widths use 65536-value containers and the container list keys them by
+ * `value >> 16`, so a 32-bit bitmap is a 64-bit bitmap whose keys are all
+ * below 65536. Conversions copy or move the containers under the same keys,
+ * and mixed operations merge the two container lists by key without
+ * converting either side.
+ */
+
+#define LIB_MIXED_AND 0
+#define LIB_MIXED_OR 1
+#define LIB_MIXED_ANDNOT 2
+#define LIB_MIXED_XOR 3
+
+/**
+ * Replaces the shared (copy on write) containers of `r` with private clones,
+ * for the code that only knows array, bitset and run containers. Returns
+ * false on allocation failure, the values of `r` are then unchanged.
+ */
+static bool lib_unshare(roaring_bitmap_t *r) {
+    roaring_array_t *ra = &r->high_low_container;
+    for (int32_t i = 0; i < ra->size; i++) {
+        if (ra->typecodes[i] != SHARED_CONTAINER_TYPE) {
+            continue;
+        }
+        uint8_t type = SHARED_CONTAINER_TYPE;
+        const container_t *shared = container_unwrap_shared(ra->containers[i], &type);
+        container_t *c = container_clone(shared, type);
+        if (c == NULL) {
+            return false;
+        }
+        container_free(ra->containers[i], SHARED_CONTAINER_TYPE);
+        ra->containers[i] = c;
+        ra->typecodes[i] = type;
+    }
+    return true;
+}
+
+/**
+ * Moves the containers of `r` into a new 64-bit bitmap with
+ * `roaring64_bitmap_move_from_roaring32()`, `r` is left empty. Shared
+ * containers are unshared first, 64-bit bitmaps do not share. Returns NULL
+ * on allocation failure, the values of `r` are then unchanged.
+ */
+static roaring64_bitmap_t *lib_move_to64(roaring_bitmap_t *r) {
+    if (!lib_unshare(r)) {
+        return NULL;
+    }
+    return roaring64_bitmap_move_from_roaring32(r);
+}
+
+/**
+ * Copies the containers of `r` into a new bitmap of width `to`. Returns NULL
+ * on allocation failure, or if `r` is a 64-bit bitmap with a value that does
+ * not fit in 32 bits and `to` is 32.
+ */
+static void *lib_convert(const void *r, int bit, int to) {
+    lib_list_t in = {0};
+    lib_list_t out = {0};
+    bool ok = lib_list_view(&in, r, bit);
+    ok = ok && !(to == LIB_BIT_32 && in.size > 0 && in.entries[in.size - 1].key > 0xFFFF);
+    ok = ok && lib_list_reserve(&out, in.size);
+    for (size_t i = 0; ok && i < in.size; i++) {
+        container_t *c = container_clone(in.entries[i].container, in.entries[i].typecode);
+        ok = c != NULL && lib_list_push(&out, in.entries[i].key, c, in.entries[i].typecode);
+    }
+    lib_list_free(&in);
+    if (!ok) {
+        lib_list_free_containers(&out);
+        return NULL;
+    }
+    return lib_list_to_bitmap(&out, to);
+}
+
+/**
+ * Pushes a clone of `e`.
+ */
+static bool lib_mixed_clone(lib_list_t *out, const lib_entry_t *e) {
+    container_t *c = container_clone(e->container, e->typecode);
+    return c != NULL && lib_list_push(out, e->key, c, e->typecode);
+}
+
+/**
+ * r1 AND r2, r1 OR r2, r1 ANDNOT r2 or r1 XOR r2 depending on `op`, where r1
+ * has width `bit1` and r2 width `bit2`. The result is a new bitmap as wide as
+ * r1 for and / andnot, whose values all come from r1, and a 64-bit bitmap for
+ * or / xor. Returns NULL on allocation failure.
+ */
+static void *lib_mixed_op(const void *r1, int bit1, const void *r2, int bit2, int op) {
+    int bit = op == LIB_MIXED_AND || op == LIB_MIXED_ANDNOT ? bit1 : LIB_BIT_64;
+    lib_list_t a = {0};
+    lib_list_t b = {0};
+    lib_list_t out = {0};
+    bool ok = lib_list_view(&a, r1, bit1) && lib_list_view(&b, r2, bit2);
+    size_t i = 0;
+    size_t j = 0;
+    while (ok && i < a.size && j < b.size) {
+        const lib_entry_t *x = &a.entries[i];
+        const lib_entry_t *y = &b.entries[j];
+        if (x->key < y->key) {
+            ok = op == LIB_MIXED_AND || lib_mixed_clone(&out, x);
+            i = op == LIB_MIXED_AND ? lib_list_gallop(&a, i, y->key) : i + 1;
+        } else if (x->key > y->key) {
+            ok = op == LIB_MIXED_AND || op == LIB_MIXED_ANDNOT || lib_mixed_clone(&out, y);
+            j = op == LIB_MIXED_AND || op == LIB_MIXED_ANDNOT ? lib_list_gallop(&b, j, x->key) : j + 1;
+        } else {
+            uint8_t type;
+            container_t *c;
+            switch (op) {
+                case LIB_MIXED_AND:
+                    c = container_and(x->container, x->typecode, y->container, y->typecode, &type);
+                    break;
+                case LIB_MIXED_OR:
+                    c = container_or(x->container, x->typecode, y->container, y->typecode, &type);
+                    break;
+                case LIB_MIXED_ANDNOT:
+                    c = container_andnot(x->container, x->typecode, y->container, y->typecode, &type);
+                    break;
+                default:
+                    c = container_xor(x->container, x->typecode, y->container, y->typecode, &type);
+                    break;
+            }
+            ok = c != NULL && lib_list_push(&out, x->key, c, type);
+            i++;
+            j++;
+        }
+    }
+    for (; ok && op != LIB_MIXED_AND && i < a.size; i++) {
+        ok = lib_mixed_clone(&out, &a.entries[i]);
+    }
+    for (; ok && (op == LIB_MIXED_OR || op == LIB_MIXED_XOR) && j < b.size; j++) {
+        ok = lib_mixed_clone(&out, &b.entries[j]);
+    }
+    lib_list_free(&a);
+    lib_list_free(&b);
+    if (!ok) {
+        lib_list_free_containers(&out);
+        return NULL;
+    }
+    return lib_list_to_bitmap(&out, bit);
+}
@@ -0,0 +1,303 @@
+<?php
+/**
+ * Copyright 2025 buexplain@qq.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+declare(strict_types=1);
+
+namespace Roaring;
+
+use FFI;
+use RuntimeException;
+
+/**
+ * 位图布尔表达式，例如 (A ∧ B) ∨ (C ∧ ¬D)
+ * 表达式解析后编译成执行计划，整棵树在原生库中求值，中间结果不会回到 php：
+ * 交集按基数从小到大计算并原地复用缓冲区，中间结果为空时立即结束；并集、异或一次合并所有子表达式
+ * 编译好的表达式可以重复使用
+ *
+ * 运算符，优先级从高到低：
+ * 非：¬ ! ~ NOT，只能出现在交集中，且该交集至少有一个不取非的操作数（位图没有全集，无法单独求补集）
+ * 交集：∧ & && AND
+ * 异或：⊕ ^ XOR
+ * 并集：∨ | || OR
+ * 操作数由字母、数字、下划线组成，关键字不区分大小写
+ */
+class Expression
+{
+    protected const OPERAND = 0;
+    protected const AND = 1;
+    protected const OR = 2;
+    protected const XOR = 3;
+    protected const NOT = 4;
+
+    /**
+     * 执行计划
+     * @var array|int[]
+     */
+    protected array $plan = [];
+
+    /**
+     * 操作数的名字，下标就是执行计划中操作数的下标
+     * @var array|string[]
+     */
+    protected array $operands = [];
+
+    /**
+     * 解析时的词法单元
+     * @var array
+     */
+    protected array $tokens = [];
+
+    /**
+     * 解析时的位置
+     * @var int
+     */
+    protected int $pos = 0;
+
+    /**
+     * 解析并编译表达式
+     * @param string $expr
+     */
+    public function __construct(string $expr)
+    {
+        $this->tokenize($expr);
+        $this->pos = 0;
+        $node = $this->parseOr();
+        if ($this->pos !== count($this->tokens)) {
+            throw new RuntimeException("unexpected token '{$this->tokens[$this->pos][1]}' in bitmap expression");
+        }
+        $node = $this->normalize($node);
+        $this->validate($node, false);
+        $positions = [];
+        $this->compile($node, $positions);
+        $this->tokens = [];
+    }
+
+    /**
+     * 获取表达式引用的操作数的名字
+     * @return array|string[]
+     */
+    public function getOperands(): array
+    {
+        return $this->operands;
+    }
+
+    /**
+     * 求值，返回新位图
+     * @param array|Bitmap[] $operands 键为操作数的名字，所有位图的位数必须一致
+     * @return Bitmap
+     */
+    public function evaluate(array $operands): Bitmap
+    {
+        $bitmaps = [];
+        foreach ($this->operands as $name) {
+            if (!isset($operands[$name])) {
+                throw new RuntimeException("bitmap expression operand $name not found");
+            }
+            $bitmaps[] = $operands[$name];
+        }
+        $bit = $bitmaps[0]->getBit();
+        $ptrs = Bitmap::newBitmapPtrs($bitmaps, $bit);
+        $size = count($this->plan);
+        $plan = Library::getFFI()->new("int32_t[$size]");
+        foreach ($this->plan as $i => $v) {
+            $plan[$i] = $v;
+        }
+        $ptr = Library::getInstance($bit)->evaluate(FFI::addr($plan[0]), $size, FFI::addr($ptrs[0]), count($bitmaps));
+        if (is_null($ptr)) {
+            throw new RuntimeException("bitmap evaluate failed");
+        }
+        return Bitmap::fromPointer($bit, $ptr);
+    }
+
+    /**
+     * @param string $expr
+     * @return void
+     */
+    protected function tokenize(string $expr): void
+    {
+        $pattern = '/\s*(?:(\()|(\))|(∧|&&?)|(∨|\|\|?)|(⊕|\^)|(¬|!|~)|(\w+))/Au';
+        $offset = 0;
+        $length = strlen($expr);
+        $this->tokens = [];
+        while ($offset < $length) {
+            if (!preg_match($pattern, $expr, $matches, 0, $offset)) {
+                if (trim(substr($expr, $offset)) === '') {
+                    break;
+                }
+                throw new RuntimeException("invalid bitmap expression near '" . substr($expr, $offset, 16) . "'");
+            }
+            $offset += strlen($matches[0]);
+            $group = count($matches) - 1;
+            $text = $matches[$group];
+            if ($group === 7) {
+                $group = match (strtoupper($text)) {
+                    'AND' => 3,
+                    'OR' => 4,
+                    'XOR' => 5,
+                    'NOT' => 6,
+                    default => 7,
+                };
+            }
+            $this->tokens[] = [$group, $text];
+        }
+        if (count($this->tokens) === 0) {
+            throw new RuntimeException("bitmap expression is empty");
+        }
+    }
+
+    /**
+     * @param int $group
+     * @return bool
+     */
+    protected function accept(int $group): bool
+    {
+        if (isset($this->tokens[$this->pos]) && $this->tokens[$this->pos][0] === $group) {
+            $this->pos++;
+            return true;
+        }
+        return false;
+    }
+
+    protected function parseOr(): array
+    {
+        $children = [$this->parseXor()];
+        while ($this->accept(4)) {
+            $children[] = $this->parseXor();
+        }
+        return count($children) === 1 ? $children[0] : [self::OR, $children];
+    }
+
+    protected function parseXor(): array
+    {
+        $children = [$this->parseAnd()];
+        while ($this->accept(5)) {
+            $children[] = $this->parseAnd();
+        }
+        return count($children) === 1 ? $children[0] : [self::XOR, $children];
+    }
+
+    protected function parseAnd(): array
+    {
+        $children = [$this->parseNot()];
+        while ($this->accept(3)) {
+            $children[] = $this->parseNot();
+        }
+        return count($children) === 1 ? $children[0] : [self::AND, $children];
+    }
+
+    protected function parseNot(): array
+    {
+        if ($this->accept(6)) {
+            return [self::NOT, $this->parseNot()];
+        }
+        if ($this->accept(1)) {
+            $node = $this->parseOr();
+            if (!$this->accept(2)) {
+                throw new RuntimeException("missing ')' in bitmap expression");
+            }
+            return $node;
+        }
+        if (isset($this->tokens[$this->pos]) && $this->tokens[$this->pos][0] === 7) {
+            return [self::OPERAND, $this->tokens[$this->pos++][1]];
+        }
+        $token = $this->tokens[$this->pos][1] ?? 'end';
+        throw new RuntimeException("unexpected token '$token' in bitmap expression");
+    }
+
+    /**
+     * 合并嵌套的同类运算，去掉双重否定
+     * @param array $node
+     * @return array
+     */
+    protected function normalize(array $node): array
+    {
+        if ($node[0] === self::OPERAND) {
+            return $node;
+        }
+        if ($node[0] === self::NOT) {
+            $child = $this->normalize($node[1]);
+            return $child[0] === self::NOT ? $child[1] : [self::NOT, $child];
+        }
+        $children = [];
+        foreach ($node[1] as $child) {
+            $child = $this->normalize($child);
+            if ($child[0] === $node[0]) {
+                array_push($children, ...$child[1]);
+            } else {
+                $children[] = $child;
+            }
+        }
+        return [$node[0], $children];
+    }
+
+    /**
+     * 检查非运算的位置
+     * @param array $node
+     * @param bool $inAnd
+     * @return void
+     */
+    protected function validate(array $node, bool $inAnd): void
+    {
+        if ($node[0] === self::OPERAND) {
+            return;
+        }
+        if ($node[0] === self::NOT) {
+            if (!$inAnd) {
+                throw new RuntimeException("NOT must be intersected with an operand that is not negated in bitmap expression");
+            }
+            $this->validate($node[1], false);
+            return;
+        }
+        $positive = false;
+        foreach ($node[1] as $child) {
+            $positive = $positive || $child[0] !== self::NOT;
+            $this->validate($child, $node[0] === self::AND);
+        }
+        if ($node[0] === self::AND && !$positive) {
+            throw new RuntimeException("NOT must be intersected with an operand that is not negated in bitmap expression");
+        }
+    }
+
+    /**
+     * 按前序输出执行计划
+     * @param array $node
+     * @param array $positions 操作数名字到下标的映射
+     * @return void
+     */
+    protected function compile(array $node, array &$positions): void
+    {
+        if ($node[0] === self::OPERAND) {
+            if (!isset($positions[$node[1]])) {
+                $positions[$node[1]] = count($this->operands);
+                $this->operands[] = $node[1];
+            }
+            $this->plan[] = self::OPERAND;
+            $this->plan[] = $positions[$node[1]];
+            return;
+        }
+        if ($node[0] === self::NOT) {
+            $this->plan[] = self::NOT;
+            $this->compile($node[1], $positions);
+            return;
+        }
+        $this->plan[] = $node[0];
+        $this->plan[] = count($node[1]);
+        foreach ($node[1] as $child) {
+            $this->compile($child, $positions);
+        }
+    }
+}
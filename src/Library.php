@@ -29,6 +29,8 @@ use RuntimeException;
  *
  * @method static CData create()                                         创建一个新的空位图，失败时返回 NULL。
  * @method static CData copy(CData $r)                                   复制一个位图，失败时返回 NULL。
+ * @method static bool  set_copy_on_write(CData $r, bool $cow)          设置写时复制，开启后复制出的位图共享容器，写入时才复制；64 位位图不支持开启，返回 false。
+ * @method static bool  get_copy_on_write(CData $r)                      是否开启了写时复制，64 位位图总是返回 false。
  * @method static bool  run_optimize(CData $r)                           优化存储结构（启用游程编码），至少有一个游程容器时返回 true。
  * @method static void  clear(CData $r)                                  清空位图内容，移除所有辅助分配。
  * @method static void  free(CData $r)                                   释放位图内存。
@@ -52,11 +54,16 @@ use RuntimeException;
  * @method static int   maximum(CData $r)                                返回位图中的最大值，位图为空时返回 0。
  * @method static bool  equals(CData $r1, CData $r2)                     比较两个位图是否包含相同元素。
  * @method static bool  intersect(CData $r1, CData $r2)                  检查两个位图是否有交集。
+ * @method static bool  is_subset(CData $r1, CData $r2)                  检查 r1 的所有元素是否都在 r2 中。
+ * @method static float jaccard_index(CData $r1, CData $r2)              计算两个位图的 Jaccard 相似度，两个位图都为空时无定义。
+ * @method static int   most_similar(CData $r, CData $candidates, int $number, int $k, int $metric, CData $indices, CData $scores) 找出与 r 最相似的 k 个候选位图，写入下标和相似度，返回结果个数，失败时返回 SIZE_MAX。
  * @method static bool  is_empty(CData $r)                               检查位图是否为空（基数为零）。
  *
  * @method static CData or (CData $r1, CData $r2)                         计算两个位图的并集，返回新位图，失败时返回 NULL。
  * @method static void  or_inplace(CData $r1, CData $r2)                 原地计算并集，修改 r1。
  * @method static int   or_cardinality(CData $r1, CData $r2)             计算两个位图并集的元素总数。
+ * @method static CData or_parallel(CData $r1, CData $r2, int $threads)  按容器key分片，最多用 threads 个线程计算并集，返回新位图，失败时返回 NULL。
+ * @method static bool  or_inplace_parallel(CData $r1, CData $r2, int $threads) 多线程原地计算并集，修改 r1，失败时返回 false 且 r1 不变。
  * @method static CData xor (CData $r1, CData $r2)                        计算两个位图的对称差集（异或），返回新位图，失败时返回 NULL。
  * @method static void  xor_inplace(CData $r1, CData $r2)                原地计算异或，修改 r1。
  * @method static int   xor_cardinality(CData $r1, CData $r2)            计算两个位图对称差集的元素总数。
@@ -66,6 +73,13 @@ use RuntimeException;
  * @method static CData andnot(CData $r1, CData $r2)                     计算两个位图的差集（r1 - r2），返回新位图，失败时返回 NULL。
  * @method static void  andnot_inplace(CData $r1, CData $r2)             原地计算差集，修改 r1。
  * @method static int   andnot_cardinality(CData $r1, CData $r2)         计算两个位图差集的元素总数。
+ * @method static CData and_range(CData $r, int $min, int $max)        计算位图与范围 [min, max) 的交集，不构建范围位图，返回新位图，失败时返回 NULL。
+ * @method static CData andnot_range(CData $r, int $min, int $max)     计算位图与范围 [min, max) 的差集，不构建范围位图，返回新位图，失败时返回 NULL。
+ * @method static CData or_range(CData $r, int $min, int $max)         计算位图与范围 [min, max) 的并集，不构建范围位图，返回新位图，失败时返回 NULL。
+ * @method static CData flip(CData $r, int $min, int $max)             翻转范围 [min, max) 内的值，返回新位图，失败时返回 NULL。
+ * @method static void  flip_inplace(CData $r, int $min, int $max)     原地翻转范围 [min, max) 内的值。
+ * @method static bool  intersect_with_range(CData $r, int $min, int $max) 检查位图与范围 [min, max) 是否有交集。
+ * @method static CData add_offset(CData $r, int $offset)                给所有元素加上 offset，超出取值范围的元素被丢弃，返回新位图，失败时返回 NULL。
  *
  * @method static CData iterator_create(CData $r)                        创建迭代器对象，用于遍历位图中的值。
  * @method static int   iterator_read(CData $it, CData $buf, int $count) 从迭代器读取最多 count 个值到 buf，返回实际读取的元素数。
@@ -73,16 +87,47 @@ use RuntimeException;
  *
  * @method static int   portable_size_in_bytes(CData $r)                 获取序列化位图所需的字节数。
  * @method static int   portable_serialize(CData $r, CData $buf)         将位图序列化到缓冲区，返回写入的字节数。
+ * @method static int   portable_serialize_parallel(CData $r, CData $buf, int $threads) 将位图序列化到缓冲区，容器分给最多 threads 个线程写入，返回写入的字节数，失败时返回 0。
+ * @method static int   portable_size_in_bytes_many(CData $rs, int $number, CData $sizes) 获取一组位图各自序列化所需的字节数写入 sizes，返回总字节数。
+ * @method static void  portable_serialize_many(CData $rs, int $number, CData $sizes, CData $buf) 将一组位图依次序列化到同一块缓冲区，各个位图分到线程池并行写入。
+ * @method static CData portable_writer_create(CData $r)                 创建分段输出位图字节码的写入器，失败时返回 NULL。
+ * @method static int   portable_writer_next(CData $w, CData $buf, int $capacity) 把接下来最多 capacity 个字节的字节码写入 buf，返回写入的字节数，全部写完后返回 0。
+ * @method static void  portable_writer_free(CData $w)                   释放写入器内存。
+ * @method static bool  portable_write_file(CData $r, string $path)      将位图字节码经有限大小的缓冲区写入文件，失败时返回 false。
+ * @method static CData portable_read_file(string $path)                 从文件逐个容器读取位图，失败时返回 NULL。
  * @method static CData portable_deserialize(CData $buf, int $maxbytes)                 从缓冲区反序列化位图，失败时返回 NULL。
+ * @method static CData portable_deserialize_parallel(CData $buf, int $maxbytes, int $threads) 从缓冲区反序列化位图，容器分给最多 threads 个线程并行解码，失败时返回 NULL。
+ * @method static int   size_in_bytes(CData $r)                          获取以 native 格式序列化 32 位位图所需的字节数。
+ * @method static int   serialize(CData $r, CData $buf)                  将 32 位位图以 native 格式序列化到缓冲区，返回写入的字节数。
+ * @method static CData deserialize(CData $buf, int $maxbytes)           从 native 格式的缓冲区反序列化 32 位位图，失败时返回 NULL。
+ * @method static int   frozen_size_in_bytes(CData $r)                   获取以 frozen 格式序列化位图所需的字节数，失败时返回 0，64 位位图会先收缩内存。
+ * @method static int   frozen_serialize(CData $r, CData $buf)           将位图以 frozen 格式序列化到缓冲区，返回写入的字节数，失败时返回 0。
+ * @method static CData frozen_deserialize(CData $buf, int $maxbytes)    从 frozen 格式的缓冲区反序列化位图，失败时返回 NULL。
+ * @method static int   detect_format(CData $buf, int $maxbytes)         识别字节码的格式，0 为 portable，1 为 native，2 为 frozen，无法识别时返回 0。
  * @method static void  to_uint_array(CData $r, CData $ans)            将位图中所有元素导出为有序数组。
+ * @method static int   dense_size_in_bytes(CData $r)                    稠密位串的字节数，即 最大值 / 8 + 1，空位图返回 0。
+ * @method static bool  to_dense(CData $r, CData $buf, int $size, bool $msb) 把稠密位串写入缓冲区，msb 为 true 时从每个字节的最高位开始编号，内存分配失败时返回 false。
+ * @method static CData from_dense(string $bits, int $n, int $offset, bool $msb) 用稠密位串创建位图，第 i 位表示元素 offset + i，元素超出位数或失败时返回 NULL。
+ *
+ * @method static CData or_many(CData $rs, int $number)                  计算多个位图的并集，按容器key分片到线程池，返回新位图，失败时返回 NULL。
+ * @method static CData xor_many(CData $rs, int $number)                 计算多个位图的对称差集，按容器key分片到线程池，返回新位图，失败时返回 NULL。
+ * @method static CData and_many(CData $rs, int $number)                 计算多个位图的交集，先求公共的容器key，再按基数从小到大求每个key的交集，返回新位图，失败时返回 NULL。
+ * @method static bool  and_many_cardinality(CData $rs, int $number, CData $cardinality) 计算多个位图交集的元素个数，不生成结果位图，失败时返回 false。
+ * @method static CData threshold(CData $rs, int $number, int $t)       计算至少出现在 t 个位图中的元素，按容器key分片到线程池，返回新位图，失败时返回 NULL。
+ * @method static CData occurrence_counts(CData $rs, int $number, int $topK) 统计每个元素出现在多少个位图中，topK 为 0 时返回全部，结果用 bp_occurrences_size、bp_occurrences_export 读取，失败时返回 NULL。
+ * @method static void  and_cardinality_matrix(CData $rs1, int $n1, CData $rs2, int $n2, CData $out) 计算两组位图两两交集的元素个数，写入 out[i * n2 + j]。
+ * @method static bool  store_write(string $path, string $keys, CData $key_lengths, CData $rs, int $number) 将一组位图按键写入仓库文件（带 CRC32C 校验和的 frozen 格式），失败时返回 false。
  */
 class Library
 {
     public const BIT_32 = 32;
     public const BIT_64 = 64;
     protected static FFI|null $ffi = null;
+    protected static array $functions = [];
     protected string $bit = '';
     protected static array $instance = [];
+    protected static bool $statsEnabled = false;
+    protected static array $stats = [];
 
     protected function __construct(int $bit)
     {
@@ -133,11 +178,43 @@ class Library
         if (!file_exists($library)) {
             throw new RuntimeException("Library not found: $library");
         }
-        $header = file_get_contents(__DIR__ . '/CRoaring/shared/library.h');
+        // 尚未用当前源码重新构建的库带有自己的头文件，只声明它导出的函数，否则 FFI::cdef 会因为找不到符号而失败
+        $header = __DIR__ . "/CRoaring/shared/library-$os-$arch.h";
+        if (!file_exists($header)) {
+            $header = __DIR__ . '/CRoaring/shared/library.h';
+        }
+        $header = file_get_contents($header);
         self::$ffi = FFI::cdef($header, $library);
+        //头文件里声明的函数，注释行以空白、/ 或 * 开头
+        preg_match_all('/^[^\s\/*].*?\b(bp\w+)\(/m', $header, $matches);
+        self::$functions = array_fill_keys($matches[1], true);
         return self::$ffi;
     }
 
+    /**
+     * 加载的原生库是否导出了该函数，例如 bp_set_threads、bp32_or_many
+     * windows、darwin 的预编译库尚未用当前源码重新构建，只导出了最初的基本操作
+     * @param string $function
+     * @return bool
+     */
+    public static function supports(string $function): bool
+    {
+        self::getFFI();
+        return isset(self::$functions[$function]);
+    }
+
+    /**
+     * 加载的原生库没有导出该函数时抛出异常
+     * @param string $function
+     * @return void
+     */
+    public static function ensureSupported(string $function): void
+    {
+        if (!self::supports($function)) {
+            throw new RuntimeException("$function is not supported by this prebuilt library, build the library from source, see README");
+        }
+    }
+
     public static function getInstance(int $bit): Library
     {
         if (isset(self::$instance[$bit])) {
@@ -149,9 +226,153 @@ class Library
         return $obj;
     }
 
+    /**
+     * 设置原生库线程池的线程数（包含调用线程），1 表示不启用线程池，默认为 1
+     * 作用于 orMany、xOrMany、andCardinalityMatrix 等可以分片计算的操作
+     * @param int $threads
+     * @return void
+     */
+    public static function setThreads(int $threads): void
+    {
+        if ($threads < 1) {
+            throw new RuntimeException("threads must be greater than 0");
+        }
+        self::ensureSupported('bp_set_threads');
+        self::getFFI()->bp_set_threads($threads);
+    }
+
+    /**
+     * 获取原生库线程池的线程数
+     * @return int
+     */
+    public static function getThreads(): int
+    {
+        self::ensureSupported('bp_get_threads');
+        return self::getFFI()->bp_get_threads();
+    }
+
+    /**
+     * 获取原生库的 SIMD 容器内核信息
+     * compiled 表示编译进原生库的内核，active 表示当前 cpu 上实际使用的内核（由 croaring_hardware_support() 在运行时选择）
+     * @return array{compiled: array{avx2: bool, avx512: bool}, active: array{avx2: bool, avx512: bool}}
+     */
+    public static function hardwareSupport(): array
+    {
+        self::ensureSupported('bp_simd_compiled');
+        $compiled = self::getFFI()->bp_simd_compiled();
+        $active = self::getFFI()->bp_simd_active();
+        return [
+            'compiled' => ['avx2' => ($compiled & 1) !== 0, 'avx512' => ($compiled & 2) !== 0],
+            'active' => ['avx2' => ($active & 1) !== 0, 'avx512' => ($active & 2) !== 0],
+        ];
+    }
+
+    /**
+     * 获取原生库的内存使用情况，原生内存不计入 memory_get_usage()，常驻进程可以据此监控泄漏
+     * bytes 为经 CRoaring 分配且尚未释放的字节数（按分配器报告的可用大小计算，含对齐的取整，不含分配器自身的簿记），
+     * peak_bytes 为其峰值（各线程峰值之和，多个线程同时分配时是上界），blocks 为当前分配的内存块数；
+     * bitmaps、iterators 为原生库创建后尚未释放的位图和迭代器个数
+     * 统计不给内存块增加任何额外空间，每次分配、释放只多一次查询块大小和对调用线程自己的计数器的几次读写
+     * @param bool $resetPeak 读取后把 peak_bytes 重置为当前值
+     * @return array{bytes: int, peak_bytes: int, blocks: int, bitmaps: int, iterators: int}
+     */
+    public static function nativeMemory(bool $resetPeak = false): array
+    {
+        self::ensureSupported('bp_memory_read');
+        $ffi = self::getFFI();
+        $out = $ffi->new('int64_t[5]');
+        $ffi->bp_memory_read($out);
+        if ($resetPeak) {
+            $ffi->bp_memory_reset_peak();
+        }
+        return [
+            'bytes' => $out[0],
+            'peak_bytes' => $out[1],
+            'blocks' => $out[2],
+            'bitmaps' => $out[3],
+            'iterators' => $out[4],
+        ];
+    }
+
+    /**
+     * 开启或关闭调用统计，默认关闭
+     * 开启后每次经由本类调用原生函数都会记录调用次数和耗时（含 FFI 调用开销），
+     * 原生库同时记录 add_many、iterator_read、to_uint_array、序列化与反序列化等搬运数据的函数的原生耗时和读写的字节数
+     * @param bool $enabled
+     * @return void
+     */
+    public static function enableStats(bool $enabled = true): void
+    {
+        self::ensureSupported('bp_stats_enable');
+        self::getFFI()->bp_stats_enable($enabled);
+        self::$statsEnabled = $enabled;
+    }
+
+    /**
+     * 获取调用统计，键为原生函数名，例如 bp32_add_many
+     * calls 为调用次数，ns 为含 FFI 开销的总耗时（纳秒）；
+     * native_ns、bytes_in、bytes_out 为原生库记录的原生耗时、从调用方缓冲区读取和写入调用方缓冲区的字节数，原生库不记录的函数这三项为 0
+     * @return array<string, array{calls: int, ns: int, native_ns: int, bytes_in: int, bytes_out: int}>
+     */
+    public static function stats(): array
+    {
+        self::ensureSupported('bp_stats_read');
+        $ffi = self::getFFI();
+        $ret = [];
+        foreach (self::$stats as $name => $stat) {
+            $ret[$name] = ['calls' => $stat[0], 'ns' => $stat[1], 'native_ns' => 0, 'bytes_in' => 0, 'bytes_out' => 0];
+        }
+        $size = $ffi->bp_stats_size();
+        $out = $ffi->new('uint64_t[' . ($size * 4) . ']');
+        foreach ([self::BIT_32, self::BIT_64] as $bit) {
+            $ffi->bp_stats_read($bit, $out);
+            for ($i = 0; $i < $size; $i++) {
+                if ($out[$i * 4] === 0) {
+                    continue;
+                }
+                $name = sprintf('bp%d_', $bit) . FFI::string($ffi->bp_stats_name($i));
+                if (!isset($ret[$name])) {
+                    //没有经由本类调用的原生函数，例如 portable_serialize_many 内部调用的部分，以原生库的记录为准
+                    $ret[$name] = ['calls' => $out[$i * 4], 'ns' => $out[$i * 4 + 1], 'native_ns' => 0, 'bytes_in' => 0, 'bytes_out' => 0];
+                }
+                $ret[$name]['native_ns'] = $out[$i * 4 + 1];
+                $ret[$name]['bytes_in'] = $out[$i * 4 + 2];
+                $ret[$name]['bytes_out'] = $out[$i * 4 + 3];
+            }
+        }
+        ksort($ret);
+        return $ret;
+    }
+
+    /**
+     * 清零调用统计
+     * @return void
+     */
+    public static function resetStats(): void
+    {
+        self::ensureSupported('bp_stats_reset');
+        self::getFFI()->bp_stats_reset();
+        self::$stats = [];
+    }
+
     public function __call($name, $arguments)
     {
         $name = $this->bit . $name;
-        return self::$ffi->$name(...$arguments);
+        if (!isset(self::$functions[$name])) {
+            self::ensureSupported($name);
+        }
+        if (!self::$statsEnabled) {
+            return self::$ffi->$name(...$arguments);
+        }
+        $start = hrtime(true);
+        $ret = self::$ffi->$name(...$arguments);
+        $ns = hrtime(true) - $start;
+        if (isset(self::$stats[$name])) {
+            self::$stats[$name][0]++;
+            self::$stats[$name][1] += $ns;
+        } else {
+            self::$stats[$name] = [1, $ns];
+        }
+        return $ret;
     }
 }
\ No newline at end of file
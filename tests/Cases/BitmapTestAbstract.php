@@ -20,7 +20,13 @@ declare(strict_types=1);
 namespace RoaringTest\Cases;
 
 use PHPUnit\Framework\TestCase;
+use Roaring\BitSlicedIndex;
 use Roaring\Bitmap;
+use Roaring\BitmapIndex;
+use Roaring\BitmapStore;
+use Roaring\Expression;
+use Roaring\Library;
+use RuntimeException;
 
 abstract class BitmapTestAbstract extends TestCase
 {
@@ -41,6 +47,177 @@ abstract class BitmapTestAbstract extends TestCase
         $this->assertEquals($bStr, $b2str, '反序列化失败');
     }
 
+    /**
+     * composer test -- --filter=testDeserializeParallel
+     * @return void
+     */
+    public function testDeserializeParallel()
+    {
+        $b = $this->newBp();
+        $b->addRange(0, 200000);
+        $b->addMany([300000, 400000, 500000]);
+        $b->runOptimize();
+        $b->addRange(600000, 700000);
+        $b2 = new Bitmap($b->getBit(), $b->toBytes(), threads: 4);
+        $this->assertTrue($b->equals($b2));
+        $b3 = new Bitmap($b->getBit(), $this->newBp()->toBytes(), threads: 4);
+        $this->assertTrue($b3->isEmpty());
+    }
+
+    /**
+     * composer test -- --filter=testSerializeParallel
+     * @return void
+     */
+    public function testSerializeParallel()
+    {
+        $b = $this->newBp();
+        $b->addRange(0, 200000);
+        $b->addMany([300000, 400000, 500000]);
+        $b->runOptimize();
+        $b->addRange(600000, 700000);
+        $this->assertEquals($b->toBytes(), $b->toBytes(4));
+        $this->assertEquals($this->newBp()->toBytes(), $this->newBp()->toBytes(4));
+        $c = $this->newBp();
+        $c->addMany([1, 2, 3]);
+        Library::setThreads(4);
+        try {
+            $ret = Bitmap::serializeMany(['b' => $b, 'e' => $this->newBp(), 'c' => $c]);
+        } finally {
+            Library::setThreads(1);
+        }
+        $this->assertEquals(['b' => $b->toBytes(), 'e' => $this->newBp()->toBytes(), 'c' => $c->toBytes()], $ret);
+        $this->assertEquals([], Bitmap::serializeMany([]));
+    }
+
+    /**
+     * composer test -- --filter=testSerializeFormat
+     * @return void
+     */
+    public function testSerializeFormat()
+    {
+        $b = $this->newBp();
+        $b->addRange(0, 200000);
+        $b->addMany([300000, 400000, 500000]);
+        $b->runOptimize();
+        $sparse = $this->newBp();
+        $sparse->addMany([1, 70000, 140000, 4000000000]);
+        $formats = $b->getBit() === Library::BIT_32 ? ['auto', 'portable', 'native', 'frozen'] : ['auto', 'portable', 'frozen'];
+        foreach ([$b, $sparse, $this->newBp()] as $bitmap) {
+            foreach ($formats as $format) {
+                $bytes = $bitmap->toBytes(format: $format);
+                $this->assertTrue($bitmap->equals(new Bitmap($bitmap->getBit(), $bytes)), $format);
+                $this->assertTrue($bitmap->equals(new Bitmap($bitmap->getBit(), $bytes, threads: 4)), $format);
+            }
+            $this->assertLessThanOrEqual(strlen($bitmap->toBytes()), strlen($bitmap->toBytes(format: 'auto')));
+        }
+        if ($b->getBit() === Library::BIT_32) {
+            $this->assertLessThan(strlen($sparse->toBytes()), strlen($sparse->toBytes(format: 'auto')));
+            $this->assertEquals($sparse->toBytes(format: 'native'), $sparse->toBytes(format: 'auto'));
+        } else {
+            $this->assertEquals($sparse->toBytes(), $sparse->toBytes(format: 'auto'));
+            $this->expectException(RuntimeException::class);
+            $sparse->toBytes(format: 'native');
+        }
+    }
+
+    /**
+     * composer test -- --filter=testWriteTo
+     * @return void
+     */
+    public function testWriteTo()
+    {
+        $b = $this->newBp();
+        $b->addRange(0, 200000);
+        $b->addMany([300000, 400000, 500000]);
+        $b->runOptimize();
+        $b->addRange(600000, 700000);
+        $path = tempnam(sys_get_temp_dir(), 'bitmap');
+        try {
+            $b->writeTo($path);
+            $this->assertEquals($b->toBytes(), file_get_contents($path));
+            $this->assertTrue($b->equals(Bitmap::readFrom($path, $b->getBit())));
+            $stream = fopen($path, 'wb');
+            $b->writeToStream($stream, 100);
+            fclose($stream);
+            $this->assertEquals($b->toBytes(), file_get_contents($path));
+            $this->newBp()->writeTo($path);
+            $this->assertTrue(Bitmap::readFrom($path, $b->getBit())->isEmpty());
+            file_put_contents($path, substr($b->toBytes(), 0, 100));
+            $this->expectException(RuntimeException::class);
+            Bitmap::readFrom($path, $b->getBit());
+        } finally {
+            unlink($path);
+        }
+    }
+
+    /**
+     * composer test -- --filter=testStore
+     * @return void
+     */
+    public function testStore()
+    {
+        $bitmaps = [];
+        for ($i = 0; $i < 20; $i++) {
+            $b = $this->newBp();
+            $b->addRange($i * 70000, $i * 70000 + $i * 1000);
+            $b->addMany([$i, $i * 3, 1000000 + $i]);
+            $bitmaps["k$i"] = $b;
+        }
+        $bitmaps[7] = $this->newBp();
+        $path = tempnam(sys_get_temp_dir(), 'bitmap');
+        try {
+            BitmapStore::write($path, $bitmaps, $this->newBp()->getBit());
+            $store = new BitmapStore($path);
+            $this->assertEquals($this->newBp()->getBit(), $store->getBit());
+            $this->assertCount(21, $store);
+            $this->assertTrue($store->verify());
+            foreach ($bitmaps as $key => $b) {
+                $this->assertTrue($store->has($key));
+                $this->assertTrue($b->equals($store->get($key)));
+            }
+            $this->assertFalse($store->has('none'));
+            $keys = array_map('strval', array_keys($bitmaps));
+            sort($keys, SORT_STRING);
+            $this->assertEquals($keys, $store->keys());
+            $store->close();
+            $this->expectException(RuntimeException::class);
+            $store->get('k1');
+        } finally {
+            unlink($path);
+        }
+    }
+
+    /**
+     * composer test -- --filter=testDenseBitset
+     * @return void
+     */
+    public function testDenseBitset()
+    {
+        $a = $this->newBp();
+        $a->addMany([0, 3, 8, 70000])->addRange(100000, 100020);
+        $bits = $a->toDenseBitset();
+        $this->assertEquals(intdiv(100019, 8) + 1, strlen($bits));
+        $this->assertEquals([9, 1], [ord($bits[0]), ord($bits[1])]);
+        $this->assertTrue($a->equals(Bitmap::fromDenseBitset($bits, 0, $a->getBit())));
+        $msb = $a->toDenseBitset(true);
+        $this->assertEquals([0x90, 0x80], [ord($msb[0]), ord($msb[1])]);
+        $this->assertTrue($a->equals(Bitmap::fromDenseBitset($msb, 0, $a->getBit(), true)));
+        $this->assertEquals([10, 12], Bitmap::fromDenseBitset("\x05", 10, $a->getBit())->toArray());
+        $this->assertEquals([0, 15], Bitmap::fromDenseBitset("\x80\x01", 0, $a->getBit(), true)->toArray());
+        $this->assertEquals('', $this->newBp()->toDenseBitset());
+        $this->assertTrue(Bitmap::fromDenseBitset('', 0, $a->getBit())->isEmpty());
+        $b = $this->newBp()->addRange(0, 1000000)->addMany([3000000, 3000007]);
+        Library::setThreads(4);
+        try {
+            $this->assertTrue($b->equals(Bitmap::fromDenseBitset($b->toDenseBitset(), 0, $b->getBit())));
+        } finally {
+            Library::setThreads(1);
+        }
+        $this->assertEquals([5000000000], Bitmap::fromDenseBitset("\x01", 5000000000, Library::BIT_64)->toArray());
+        $this->expectException(RuntimeException::class);
+        Bitmap::fromDenseBitset("\x01", 4294967296, Library::BIT_32);
+    }
+
     /**
      * composer test -- --filter=testClone
      * @return void
@@ -52,6 +229,52 @@ abstract class BitmapTestAbstract extends TestCase
         $this->assertEquals(serialize($b), serialize($b2));
     }
 
+    /**
+     * composer test -- --filter=testCopyOnWrite
+     * @return void
+     */
+    public function testCopyOnWrite()
+    {
+        $b = $this->newBp();
+        $this->assertFalse($b->isCopyOnWrite());
+        $b->setCopyOnWrite(false);
+        $this->assertFalse($b->isCopyOnWrite());
+        if ($b->getBit() === Library::BIT_64) {
+            $this->expectException(RuntimeException::class);
+            $b->setCopyOnWrite();
+            return;
+        }
+        $b->setCopyOnWrite()->addRange(0, 200000);
+        $b->add(300000);
+        $this->assertTrue($b->isCopyOnWrite());
+        $b2 = clone $b;
+        $this->assertTrue($b2->isCopyOnWrite());
+        $b2->add(300001);
+        $b2->removeRange(0, 100);
+        $this->assertFalse($b->contains(300001));
+        $this->assertTrue($b->contains(50));
+        $this->assertEquals(200001, $b->getCardinality());
+        $this->assertEquals(200001 - 100 + 1, $b2->getCardinality());
+        //克隆出的位图与原位图共享容器，写入仓库前要先取消共享
+        $b4 = clone $b;
+        $path = tempnam(sys_get_temp_dir(), 'bitmap');
+        try {
+            BitmapStore::write($path, ['b' => $b, 'clone' => $b4], $b->getBit());
+            $store = new BitmapStore($path);
+            $this->assertTrue($b4->equals($store->get('clone')));
+            $this->assertTrue($b->equals($store->get('b')));
+            $store->close();
+        } finally {
+            unlink($path);
+        }
+        $this->assertTrue($b4->equals($b));
+        $b->setCopyOnWrite(false);
+        $b3 = clone $b;
+        $this->assertFalse($b3->isCopyOnWrite());
+        $this->assertTrue($b3->equals($b));
+        $this->assertTrue($b->or($b2)->equals($b2->or($b)));
+    }
+
     /**
      * composer test -- --filter=testRunOptimize
      * @return void
@@ -307,6 +530,36 @@ abstract class BitmapTestAbstract extends TestCase
         $this->assertTrue($a->intersect($b));
     }
 
+    /**
+     * composer test -- --filter=testSimilarity
+     * @return void
+     */
+    public function testSimilarity()
+    {
+        $seed = $this->newBp()->addRange(0, 100);
+        $a = $this->newBp()->addRange(0, 50);
+        $b = $this->newBp()->addRange(50, 200);
+        $c = $this->newBp()->addRange(0, 100);
+        $d = $this->newBp()->addRange(1000, 2000);
+        $this->assertTrue($a->isSubset($seed));
+        $this->assertFalse($b->isSubset($seed));
+        $this->assertEqualsWithDelta(0.5, $a->jaccardIndex($seed), 1e-9);
+        $this->assertEqualsWithDelta(0.25, $b->jaccardIndex($seed), 1e-9);
+        $candidates = ['a' => $a, 'b' => $b, 'c' => $c, 'd' => $d];
+        $this->assertSame(['c' => 1.0, 'a' => 0.5], $seed->mostSimilar($candidates, 2));
+        $this->assertSame(['c' => 1.0, 'a' => 0.5, 'b' => 0.25, 'd' => 0.0], $seed->mostSimilar($candidates, 10, 'jaccard'));
+        $this->assertSame(['a' => 1.0, 'c' => 1.0, 'b' => 0.5], $seed->mostSimilar($candidates, 3, 'overlap'));
+        Library::setThreads(4);
+        try {
+            $this->assertSame(['c' => 1.0, 'a' => 0.5], $seed->mostSimilar($candidates, 2));
+        } finally {
+            Library::setThreads(1);
+        }
+        $this->assertSame([], $seed->mostSimilar([], 3));
+        $this->expectException(RuntimeException::class);
+        $seed->mostSimilar($candidates, 1, 'cosine');
+    }
+
     /**
      * composer test -- --filter=testIsEmpty
      * @return void
@@ -353,6 +606,24 @@ abstract class BitmapTestAbstract extends TestCase
         $this->assertEquals([1, 2, 3], $a->toArray());
     }
 
+    /**
+     * composer test -- --filter=testOrParallel
+     * @return void
+     */
+    public function testOrParallel()
+    {
+        $a = $this->newBp();
+        $b = $this->newBp();
+        $a->addRange(0, 300000);
+        $a->addMany([400000, 500000]);
+        $b->addRange(250000, 600000);
+        $expected = $a->or($b)->toArray();
+        $this->assertEquals($expected, $a->or($b, threads: 4)->toArray());
+        $this->assertEquals($a->toArray(), $a->or($this->newBp(), threads: 4)->toArray());
+        $a->orInPlace($b, threads: 4);
+        $this->assertEquals($expected, $a->toArray());
+    }
+
     /**
      * composer test -- --filter=testOrCardinality
      * @return void
@@ -519,6 +790,243 @@ abstract class BitmapTestAbstract extends TestCase
         $this->assertEquals(count([2]), $a->andNotCardinality($b));
     }
 
+    /**
+     * composer test -- --filter=testRangeOperations
+     * @return void
+     */
+    public function testRangeOperations()
+    {
+        $a = $this->newBp();
+        $a->addMany([1, 5, 65535, 65536, 70000]);
+        $a->addRange(200000, 300000);
+        $range = $this->newBp()->addRange(4, 250000);
+        $this->assertEquals($a->and($range)->toArray(), $a->andRange(4, 250000)->toArray());
+        $this->assertEquals($a->andNot($range)->toArray(), $a->andNotRange(4, 250000)->toArray());
+        $this->assertEquals($a->or($range)->toArray(), $a->orRange(4, 250000)->toArray());
+        $this->assertEquals([5, 65535], $a->andRange(2, 65536)->toArray());
+        $this->assertEquals([], $a->andRange(10, 10)->toArray());
+        $this->assertEquals($a->toArray(), $a->andNotRange(10, 10)->toArray());
+        $this->assertEquals([0, 2, 3, 4, 6], $a->flip(0, 7)->andRange(0, 7)->toArray());
+        $this->assertEquals(100008, $a->flip(0, 7)->getCardinality());
+        $b = $this->newBp()->addMany([1, 3]);
+        $this->assertEquals([0, 2, 4], $b->flipInPlace(0, 5)->toArray());
+        $this->assertTrue($a->intersectWithRange(69000, 70001));
+        $this->assertFalse($a->intersectWithRange(70001, 200000));
+    }
+
+    /**
+     * composer test -- --filter=testShift
+     * @return void
+     */
+    public function testShift()
+    {
+        $a = $this->newBp();
+        $a->addMany([0, 1, 65535, 65536, 200000]);
+        $this->assertEquals([10, 11, 65545, 65546, 200010], $a->shift(10)->toArray());
+        $this->assertEquals([65536, 65537, 131071, 131072, 265536], $a->shift(65536)->toArray());
+        $this->assertEquals([0, 134464], $a->shift(-65536)->toArray());
+        $this->assertEquals([0, 1, 65535, 65536, 200000], $a->shift(0)->toArray());
+        $this->assertEquals([], $this->newBp()->shift(100)->toArray());
+        $b = $this->newBp()->addRange(100, 200000);
+        $this->assertEquals($b->getCardinality(), $b->shift(12345)->getCardinality());
+        $this->assertEquals(100 + 12345, $b->shift(12345)->minimum());
+    }
+
+    /**
+     * composer test -- --filter=testMixedWidth
+     * @return void
+     */
+    public function testMixedWidth()
+    {
+        $a = $this->newBp();
+        $a->addMany([1, 2, 70000])->addRange(100000, 100003);
+        $otherBit = $a->getBit() === Library::BIT_32 ? Library::BIT_64 : Library::BIT_32;
+        $b = new Bitmap($otherBit);
+        $b->addMany([2, 3, 70000, 80000, 100001]);
+        $big = $otherBit === Library::BIT_64 ? $b : $a;
+        $big->add(5000000000);
+        $extra = $otherBit === Library::BIT_64 ? [5000000000] : [];
+        $c = $a->and($b);
+        $this->assertEquals($a->getBit(), $c->getBit());
+        $this->assertEquals([2, 70000, 100001], $c->toArray());
+        $c = $a->andNot($b);
+        $this->assertEquals($a->getBit(), $c->getBit());
+        $this->assertEquals(array_merge([1, 100000, 100002], $otherBit === Library::BIT_32 ? [5000000000] : []), $c->toArray());
+        $c = $a->or($b);
+        $this->assertEquals(Library::BIT_64, $c->getBit());
+        $this->assertEquals(array_merge([1, 2, 3, 70000, 80000, 100000, 100001, 100002], [5000000000]), $c->toArray());
+        $c = $a->xOr($b);
+        $this->assertEquals(Library::BIT_64, $c->getBit());
+        $this->assertEquals(array_merge([1, 3, 80000, 100000, 100002], [5000000000]), $c->toArray());
+        $this->assertTrue($b->or($a)->equals($c->or($a->and($b)->to64())));
+        $this->assertEquals($extra, $b->andNot($a)->andNot((new Bitmap($otherBit))->addMany([3, 80000]))->toArray());
+        //位数转换
+        $small = $otherBit === Library::BIT_32 ? $b : $a->andNot($big);
+        $this->assertEquals($small->toArray(), $small->to64()->toArray());
+        $this->assertEquals(Library::BIT_64, $small->to64()->getBit());
+        $this->assertEquals($small->toArray(), $small->to64()->to32()->toArray());
+        $this->assertEquals(Library::BIT_32, $small->to64()->to32()->getBit());
+        $moved = $small->to32();
+        $values = $moved->toArray();
+        $this->assertEquals($values, $moved->to64(true)->toArray());
+        $this->assertTrue($moved->isEmpty());
+        $this->expectException(RuntimeException::class);
+        $big->to32();
+    }
+
+    /**
+     * composer test -- --filter=testOrMany
+     * @return void
+     */
+    public function testOrMany()
+    {
+        $a = $this->newBp();
+        $b = $this->newBp();
+        $c = $this->newBp();
+        $a->addMany([1, 2, 3]);
+        $b->addMany([3, 4, 5]);
+        $c->addRange(65530, 131080);
+        $expected = $a->or($b)->or($c)->toArray();
+        $this->assertEquals($expected, Bitmap::orMany($a, $b, $c)->toArray());
+        Library::setThreads(4);
+        try {
+            $this->assertEquals($expected, Bitmap::orMany($a, $b, $c)->toArray());
+        } finally {
+            Library::setThreads(1);
+        }
+        $this->assertEquals([1, 2, 3], Bitmap::orMany($a)->toArray());
+    }
+
+    /**
+     * composer test -- --filter=testXorMany
+     * @return void
+     */
+    public function testXorMany()
+    {
+        $a = $this->newBp();
+        $b = $this->newBp();
+        $c = $this->newBp();
+        $a->addMany([1, 2, 3]);
+        $b->addMany([3, 4, 5]);
+        $c->addMany([1, 5, 70000]);
+        $this->assertEquals([2, 3, 4, 70000], Bitmap::xOrMany($a, $b, $c)->toArray());
+        Library::setThreads(4);
+        try {
+            $this->assertEquals([2, 3, 4, 70000], Bitmap::xOrMany($a, $b, $c)->toArray());
+        } finally {
+            Library::setThreads(1);
+        }
+    }
+
+    /**
+     * composer test -- --filter=testAndMany
+     * @return void
+     */
+    public function testAndMany()
+    {
+        $a = $this->newBp();
+        $b = $this->newBp();
+        $c = $this->newBp();
+        $a->addRange(0, 200000);
+        $b->addMany([1, 2, 3, 70000, 70001, 150000, 300000]);
+        $c->addRange(65536, 300001);
+        $expected = [70000, 70001, 150000];
+        $this->assertEquals($expected, Bitmap::andMany($a, $b, $c)->toArray());
+        $this->assertEquals(3, Bitmap::andManyCardinality($a, $b, $c));
+        Library::setThreads(4);
+        try {
+            $this->assertEquals($expected, Bitmap::andMany($c, $b, $a)->toArray());
+            $this->assertEquals(3, Bitmap::andManyCardinality($c, $b, $a));
+        } finally {
+            Library::setThreads(1);
+        }
+        $this->assertEquals([1, 2, 3, 70000, 70001, 150000, 300000], Bitmap::andMany($b)->toArray());
+        $this->assertEquals(200000, Bitmap::andManyCardinality($a));
+        $this->assertEquals([], Bitmap::andMany($a, $b, $this->newBp())->toArray());
+        $this->assertEquals(0, Bitmap::andManyCardinality($a, $this->newBp(), $c));
+    }
+
+    /**
+     * composer test -- --filter=testThreshold
+     * @return void
+     */
+    public function testThreshold()
+    {
+        $a = $this->newBp();
+        $b = $this->newBp();
+        $c = $this->newBp();
+        $d = $this->newBp();
+        $a->addMany([1, 2, 3, 70000]);
+        $b->addMany([2, 3, 4, 70000]);
+        $c->addMany([3, 4, 5]);
+        $d->addRange(0, 10000);
+        $this->assertEquals([1, 2, 3, 4, 5, 70000], Bitmap::threshold([$a, $b, $c, $d], 2)->toArray());
+        $this->assertEquals([2, 3, 4], Bitmap::threshold([$a, $b, $c, $d], 3)->toArray());
+        $this->assertEquals([3], Bitmap::threshold([$a, $b, $c, $d], 4)->toArray());
+        $this->assertEquals([], Bitmap::threshold([$a, $b, $c, $d], 5)->toArray());
+        $this->assertEquals(10001, Bitmap::threshold([$a, $b, $c, $d], 1)->getCardinality());
+        Library::setThreads(4);
+        try {
+            $this->assertEquals([2, 3, 4], Bitmap::threshold(['x' => $d, 'y' => $c, 'z' => $b, 'w' => $a], 3)->toArray());
+        } finally {
+            Library::setThreads(1);
+        }
+        $this->expectException(RuntimeException::class);
+        Bitmap::threshold([$a, $b], 0);
+    }
+
+    /**
+     * composer test -- --filter=testOccurrenceCounts
+     * @return void
+     */
+    public function testOccurrenceCounts()
+    {
+        $a = $this->newBp();
+        $b = $this->newBp();
+        $c = $this->newBp();
+        $a->addMany([1, 2, 3, 70000]);
+        $b->addMany([2, 3, 70000]);
+        $c->addMany([3, 5]);
+        $c->addRange(100000, 110000);
+        $all = Bitmap::occurrenceCounts([$a, $b, $c]);
+        $this->assertCount(10005, $all);
+        $this->assertEquals([1 => 1, 2 => 2, 3 => 3, 5 => 1, 70000 => 2], array_slice($all, 0, 5, true));
+        $this->assertEquals(1, $all[109999]);
+        $this->assertSame([3 => 3, 2 => 2, 70000 => 2, 1 => 1], Bitmap::occurrenceCounts([$a, $b, $c], 4));
+        Library::setThreads(4);
+        try {
+            $this->assertSame([3 => 3, 2 => 2, 70000 => 2, 1 => 1], Bitmap::occurrenceCounts([$c, $b, $a], 4));
+            $this->assertEquals($all, Bitmap::occurrenceCounts([$c, $b, $a]));
+        } finally {
+            Library::setThreads(1);
+        }
+        $this->assertSame([], Bitmap::occurrenceCounts([$this->newBp()], 3));
+    }
+
+    /**
+     * composer test -- --filter=testAndCardinalityMatrix
+     * @return void
+     */
+    public function testAndCardinalityMatrix()
+    {
+        $a = $this->newBp();
+        $b = $this->newBp();
+        $a->addMany([1, 2, 3]);
+        $b->addMany([2, 3, 4, 5]);
+        $expected = [
+            'a' => ['a' => 3, 'b' => 2],
+            'b' => ['a' => 2, 'b' => 4],
+        ];
+        $this->assertEquals($expected, Bitmap::andCardinalityMatrix(['a' => $a, 'b' => $b], ['a' => $a, 'b' => $b]));
+        Library::setThreads(3);
+        try {
+            $this->assertEquals($expected, Bitmap::andCardinalityMatrix(['a' => $a, 'b' => $b], ['a' => $a, 'b' => $b]));
+        } finally {
+            Library::setThreads(1);
+        }
+        $this->assertEquals([], Bitmap::andCardinalityMatrix([], [$a]));
+    }
+
     /**
      * composer test -- --filter=testIterate
      * @return void
@@ -532,4 +1040,222 @@ abstract class BitmapTestAbstract extends TestCase
             $this->assertCount(10, $v);
         }
     }
+
+    /**
+     * composer test -- --filter=testHardwareSupport
+     * @return void
+     */
+    public function testHardwareSupport()
+    {
+        $support = Library::hardwareSupport();
+        foreach (['avx2', 'avx512'] as $kernel) {
+            $this->assertIsBool($support['compiled'][$kernel]);
+            $this->assertTrue(!$support['active'][$kernel] || $support['compiled'][$kernel]);
+        }
+    }
+
+    /**
+     * composer test -- --filter=testStats
+     * @return void
+     */
+    public function testStats()
+    {
+        $a = $this->newBp();
+        $width = $a->getBit() / 8;
+        $prefix = sprintf('bp%d_', $a->getBit());
+        Library::resetStats();
+        Library::enableStats();
+        try {
+            $a->add(1, 2, 3, 4);
+            $a->add(5);
+            $bytes = $a->toBytes();
+        } finally {
+            Library::enableStats(false);
+        }
+        $a->add(6, 7);
+        $stats = Library::stats();
+        $this->assertSame(1, $stats[$prefix . 'add_many']['calls']);
+        $this->assertSame(4 * $width, $stats[$prefix . 'add_many']['bytes_in']);
+        $this->assertSame(1, $stats[$prefix . 'add']['calls']);
+        $this->assertSame(0, $stats[$prefix . 'add']['native_ns']);
+        $this->assertSame(strlen($bytes), $stats[$prefix . 'portable_serialize']['bytes_out']);
+        $this->assertGreaterThanOrEqual($stats[$prefix . 'portable_serialize']['native_ns'], $stats[$prefix . 'portable_serialize']['ns']);
+        Library::resetStats();
+        $this->assertSame([], Library::stats());
+    }
+
+    /**
+     * composer test -- --filter=testSupports
+     * @return void
+     */
+    public function testSupports()
+    {
+        $this->assertTrue(Library::supports('bp32_create'));
+        $this->assertTrue(Library::supports('bp64_create'));
+        $this->assertFalse(Library::supports('bp32_not_exists'));
+        try {
+            Library::ensureSupported('bp32_not_exists');
+            $this->fail('expected RuntimeException');
+        } catch (RuntimeException $e) {
+            $this->assertStringContainsString('not supported by this prebuilt library', $e->getMessage());
+        }
+    }
+
+    /**
+     * composer test -- --filter=testNativeMemory
+     * @return void
+     */
+    public function testNativeMemory()
+    {
+        $before = Library::nativeMemory();
+        $a = $this->newBp();
+        $a->addRange(0, 100000);
+        $b = clone $a;
+        $generator = $a->iterate(10);
+        $generator->current();
+        $during = Library::nativeMemory();
+        $this->assertSame($before['bitmaps'] + 2, $during['bitmaps']);
+        $this->assertSame($before['iterators'] + 1, $during['iterators']);
+        $this->assertGreaterThan($before['bytes'], $during['bytes']);
+        $this->assertGreaterThan($before['blocks'], $during['blocks']);
+        $this->assertGreaterThanOrEqual($during['bytes'], $during['peak_bytes']);
+        unset($generator, $a, $b);
+        $after = Library::nativeMemory(true);
+        $this->assertSame($before['bitmaps'], $after['bitmaps']);
+        $this->assertSame($before['iterators'], $after['iterators']);
+        $this->assertSame($before['bytes'], $after['bytes']);
+        $this->assertSame($before['blocks'], $after['blocks']);
+        $this->assertSame($after['bytes'], Library::nativeMemory()['peak_bytes']);
+    }
+
+    /**
+     * composer test -- --filter=testBitSlicedIndex
+     * @return void
+     */
+    public function testBitSlicedIndex()
+    {
+        $bit = $this->newBp()->getBit();
+        $values = [];
+        for ($column = 0; $column < 1000; $column += 3) {
+            $values[$column] = ($column * 7) % 101;
+        }
+        $bsi = new BitSlicedIndex($bit);
+        $bsi->setValues($values);
+        $bsi->setValue(999, 500);
+        $values[999] = 500;
+        $this->assertSame(9, $bsi->getBitDepth());
+        $this->assertSame(count($values), $bsi->getCardinality());
+        $this->assertSame(500, $bsi->getValue(999));
+        $this->assertSame($values[3], $bsi->getValue(3));
+        $this->assertNull($bsi->getValue(1));
+        $filter = fn(callable $fn) => array_keys(array_filter($values, $fn));
+        $this->assertSame($filter(fn($v) => $v === 50), $bsi->equal(50)->toArray());
+        $this->assertSame($filter(fn($v) => $v !== 50), $bsi->notEqual(50)->toArray());
+        $this->assertSame($filter(fn($v) => $v < 50), $bsi->lessThan(50)->toArray());
+        $this->assertSame($filter(fn($v) => $v <= 50), $bsi->lessThanOrEqual(50)->toArray());
+        $this->assertSame($filter(fn($v) => $v > 50), $bsi->greaterThan(50)->toArray());
+        $this->assertSame($filter(fn($v) => $v >= 50), $bsi->greaterThanOrEqual(50)->toArray());
+        $this->assertSame($filter(fn($v) => $v >= 20 && $v <= 30), $bsi->between(20, 30)->toArray());
+        $this->assertSame(array_keys($values), $bsi->greaterThan(-1)->toArray());
+        $this->assertTrue($bsi->lessThan(0)->isEmpty());
+        $this->assertSame([], $bsi->greaterThan(10000)->toArray());
+        $this->assertSame(array_sum($values), $bsi->sum());
+        //只在 foundSet 中计算
+        $segment = $this->newBp();
+        $segment->addRange(0, 500);
+        $inSegment = array_filter($values, fn($column) => $column < 500, ARRAY_FILTER_USE_KEY);
+        $this->assertSame(array_keys(array_filter($inSegment, fn($v) => $v > 50)), $bsi->greaterThan(50, $segment)->toArray());
+        $this->assertSame(array_sum($inSegment), $bsi->sum($segment));
+        $top = $bsi->topK(5, $segment)->toArray();
+        $this->assertCount(5, $top);
+        $rest = array_diff_key($inSegment, array_flip($top));
+        $this->assertGreaterThanOrEqual(max($rest), min(array_intersect_key($inSegment, array_flip($top))));
+        $this->assertSame([999], $bsi->topK(1)->toArray());
+        //k 不小于元素个数时返回全部，超过 32 位的 k 也不会被截断
+        $zeros = count(array_filter($values, fn($v) => $v === 0));
+        $this->assertSame(array_keys($values), $bsi->topK(count($values) + 1)->toArray());
+        $this->assertSame(array_keys($values), $bsi->topK(2 ** 32 + 1 + count($values) - $zeros)->toArray());
+        //覆盖已有的值
+        $bsi->setValue(999, 1);
+        $this->assertSame(1, $bsi->getValue(999));
+        $this->assertSame([], $bsi->equal(500)->toArray());
+        $copy = BitSlicedIndex::fromSlices($bsi->getExistenceBitmap(), $bsi->getSlices());
+        $this->assertSame(1, $copy->getValue(999));
+        $this->expectException(RuntimeException::class);
+        $bsi->setValue(1, -1);
+    }
+
+    /**
+     * composer test -- --filter=testBitmapIndex
+     * @return void
+     */
+    public function testBitmapIndex()
+    {
+        $bit = $this->newBp()->getBit();
+        $column = [];
+        for ($row = 0; $row < 2000; $row++) {
+            $column[$row * 5] = ($row * 13) % 11 - 3;
+        }
+        $filter = fn(callable $fn) => array_keys(array_filter($column, $fn));
+        foreach ([BitmapIndex::EQUALITY, BitmapIndex::RANGE] as $encoding) {
+            $index = BitmapIndex::fromArray($column, $bit, $encoding);
+            $this->assertSame(range(-3, 7), $index->getValues());
+            $this->assertCount(11, $index);
+            $this->assertSame($filter(fn($v) => $v === 2), $index->equal(2)->toArray());
+            $this->assertSame([], $index->equal(100)->toArray());
+            $this->assertSame($filter(fn($v) => in_array($v, [-3, -2, 0, 5, 6], true)), $index->in([6, -3, 0, -2, 5, 100])->toArray());
+            $this->assertSame($filter(fn($v) => $v >= -1 && $v <= 3), $index->between(-1, 3)->toArray());
+            $this->assertSame($filter(fn($v) => $v < 0), $index->lessThan(0)->toArray());
+            $this->assertSame($filter(fn($v) => $v <= 0), $index->lessThanOrEqual(0)->toArray());
+            $this->assertSame($filter(fn($v) => $v > 4), $index->greaterThan(4)->toArray());
+            $this->assertSame($filter(fn($v) => $v >= 4), $index->greaterThanOrEqual(4)->toArray());
+            $this->assertSame(array_keys($column), $index->greaterThan(PHP_INT_MIN)->toArray());
+            $this->assertTrue($index->between(3, 2)->isEmpty());
+        }
+        $index = BitmapIndex::fromPairs(pack('q*', 1, 10, 2, 20, 3, 10), $bit);
+        $this->assertSame([1, 3], $index->equal(10)->toArray());
+        foreach ([BitmapIndex::EQUALITY, BitmapIndex::RANGE] as $encoding) {
+            try {
+                BitmapIndex::fromPairs(pack('q*', 1, 10, 2, 20, 1, 30), $bit, $encoding);
+                $this->fail('a row given two values must be rejected');
+            } catch (RuntimeException) {
+            }
+        }
+        $this->assertCount(0, BitmapIndex::fromArray([], $bit));
+        $this->expectException(RuntimeException::class);
+        BitmapIndex::fromArray([-1 => 1], $bit);
+    }
+
+    /**
+     * composer test -- --filter=testEvaluate
+     * @return void
+     */
+    public function testEvaluate()
+    {
+        $a = $this->newBp()->addRange(0, 100);
+        $b = $this->newBp()->addRange(50, 150);
+        $c = $this->newBp()->addRange(100, 200);
+        $d = $this->newBp()->addRange(120, 130);
+        $e = $this->newBp();
+        $operands = ['A' => $a, 'B' => $b, 'C' => $c, 'D' => $d, 'E' => $e];
+        $expected = $a->and($b)->or($c->andNot($d))->toArray();
+        $this->assertSame($expected, Bitmap::evaluate('(A ∧ B) ∨ (C ∧ ¬D)', $operands)->toArray());
+        $this->assertSame($expected, Bitmap::evaluate('A & B | C & !D', $operands)->toArray());
+        $this->assertSame($expected, Bitmap::evaluate('(a and b) or (c and not d)', array_change_key_case($operands))->toArray());
+        $this->assertSame($a->xOr($b)->and($c)->toArray(), Bitmap::evaluate('(A ^ B) & C', $operands)->toArray());
+        $this->assertSame($c->andNot($a)->andNot($d)->toArray(), Bitmap::evaluate('¬A ∧ C ∧ ¬D', $operands)->toArray());
+        $this->assertSame($a->toArray(), Bitmap::evaluate('A', $operands)->toArray());
+        $this->assertSame($a->toArray(), Bitmap::evaluate('!!A', $operands)->toArray());
+        $this->assertTrue(Bitmap::evaluate('A & E & (B | C)', $operands)->isEmpty());
+        $expression = new Expression('A ∧ (B ∨ E)');
+        $this->assertSame(['A', 'B', 'E'], $expression->getOperands());
+        $this->assertSame($a->and($b)->toArray(), $expression->evaluate($operands)->toArray());
+        foreach (['', 'A &', '(A | B', 'A B', '!A', 'A | !B', 'A & Z'] as $invalid) {
+            try {
+                Bitmap::evaluate($invalid, $operands);
+                $this->fail("expression '$invalid' should be rejected");
+            } catch (RuntimeException) {
+            }
+        }
+    }
 }
\ No newline at end of file